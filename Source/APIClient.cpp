@@ -0,0 +1,322 @@
+/*
+  ==============================================================================
+
+    APIClient.cpp
+    Created: 19 Oct 2026 6:37:34am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#include "APIClient.h"
+
+APIClient::APIClient(const juce::String& host, int port, int numWorkers)
+    : host(host), port(port), registry(std::make_shared<Registry>()),
+      workers(juce::ThreadPoolOptions{}.withThreadName("AV API Worker").withNumberOfThreads(numWorkers)) {
+}
+
+APIClient::~APIClient() {
+    cancelAll();
+    workers.removeAllJobs(true, -1); // Cancelled jobs stop within a poll slice, or a connect.
+    const juce::ScopedLock lock(connectionsLock);
+    for (auto& connection : idleConnections)
+        connection->close();
+}
+
+int APIClient::request(const APIRequest& request, Callback callback) {
+    auto job = std::make_shared<Pending>();
+    job->request = request;
+    job->callback = std::move(callback);
+    {
+        const juce::ScopedLock lock(registry->lock);
+        job->id = registry->nextRequestId++;
+        registry->pending[job->id] = job;
+    }
+    workers.addJob([this, job]() {
+        perform(job);
+    });
+    return job->id;
+}
+
+void APIClient::post(int requestId, std::function<void()> function) {
+    std::shared_ptr<Registry> shared = registry;
+    juce::MessageManager::callAsync([shared, requestId, function]() {
+        {
+            const juce::ScopedLock lock(shared->lock);
+            if (shared->pending.find(requestId) == shared->pending.end())
+                return;
+        }
+        function();
+    });
+}
+
+void APIClient::cancel(int requestId) {
+    const juce::ScopedLock lock(registry->lock);
+    auto it = registry->pending.find(requestId);
+    if (it == registry->pending.end())
+        return;
+    it->second->cancelled.store(true);
+    registry->pending.erase(it);
+}
+
+void APIClient::cancelAll() {
+    const juce::ScopedLock lock(registry->lock);
+    for (auto& entry : registry->pending)
+        entry.second->cancelled.store(true);
+    registry->pending.clear();
+}
+
+void APIClient::perform(std::shared_ptr<Pending> job) {
+    if (job->cancelled.load())
+        return;
+    juce::uint32 deadline = juce::Time::getMillisecondCounter() + (juce::uint32) job->request.timeoutMs;
+
+    APIResponse response;
+    // A kept alive connection may have been closed by the server while it sat idle, which only shows once the
+    // request has been sent. One retry on a fresh connection covers that.
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int remainingMs = (int) (juce::int32) (deadline - juce::Time::getMillisecondCounter());
+        if (remainingMs <= 0)
+            break;
+        response = {};
+        bool reused = false;
+        auto connection = takeConnection(reused, remainingMs);
+        if (connection == nullptr) {
+            DBG("Could not connect to the API at " << host << ":" << port << " for " << job->request.path);
+            break;
+        }
+        bool keepAlive = false, receivedNothing = false;
+        if (exchange(*connection, *job, deadline, response, keepAlive, receivedNothing)) {
+            if (keepAlive)
+                returnConnection(std::move(connection));
+            break;
+        }
+        connection->close();
+        response = { 0, response.sent }; // Nothing of the response is kept, but whether the request went out is.
+        if (!reused || !receivedNothing || job->cancelled.load())
+            break;
+        DBG("Kept alive API connection was closed by the server, retrying " << job->request.path);
+    }
+    finish(job, std::move(response));
+}
+
+void APIClient::finish(std::shared_ptr<Pending> job, APIResponse response) {
+    if (job->cancelled.load())
+        return;
+    if (response.statusCode == 0)
+        DBG("API request " << job->request.method << " " << job->request.path << " failed or timed out.");
+    // Doesn't capture this, so a client destroyed before the message thread gets here is fine.
+    std::shared_ptr<Registry> shared = registry;
+    juce::MessageManager::callAsync([shared, job, response]() {
+        {
+            const juce::ScopedLock lock(shared->lock);
+            if (job->cancelled.load())
+                return;
+            shared->pending.erase(job->id);
+        }
+        if (job->callback)
+            job->callback(response);
+    });
+}
+
+std::unique_ptr<juce::StreamingSocket> APIClient::takeConnection(bool& reused, int timeoutMs) {
+    {
+        const juce::ScopedLock lock(connectionsLock);
+        if (!idleConnections.empty()) {
+            auto connection = std::move(idleConnections.back());
+            idleConnections.pop_back();
+            reused = true;
+            return connection;
+        }
+    }
+    reused = false;
+    auto connection = std::make_unique<juce::StreamingSocket>();
+    if (!connection->connect(host, port, juce::jmin(timeoutMs, API_CONNECT_TIMEOUT_MS)))
+        return nullptr;
+    return connection;
+}
+
+void APIClient::returnConnection(std::unique_ptr<juce::StreamingSocket> connection) {
+    const juce::ScopedLock lock(connectionsLock);
+    // No more connections are kept than there are workers to use them.
+    if ((int) idleConnections.size() < workers.getNumThreads())
+        idleConnections.push_back(std::move(connection));
+    else
+        connection->close();
+}
+
+// Writes in pieces no bigger than a read, each once the socket can take more, so a server that stops reading
+// can't hold the worker past its deadline or a cancel.
+bool APIClient::writeAll(juce::StreamingSocket& connection, const Pending& job, juce::uint32 deadline, const char* data, int size) {
+    int written = 0;
+    while (written < size && !job.cancelled.load()) {
+        juce::uint32 now = juce::Time::getMillisecondCounter();
+        if ((juce::int32) (deadline - now) <= 0)
+            return false;
+        int ready = connection.waitUntilReady(false, juce::jmin(API_POLL_SLICE_MS, (int) (deadline - now)));
+        if (ready < 0)
+            return false;
+        if (ready == 0)
+            continue;
+        int chunk = juce::jmin(size - written, API_READ_SIZE);
+        if (connection.write(data + written, chunk) != chunk)
+            return false;
+        written += chunk;
+    }
+    return written == size;
+}
+
+int APIClient::readSome(juce::StreamingSocket& connection, const Pending& job, juce::uint32 deadline, char* buffer, int size) {
+    while (!job.cancelled.load()) {
+        juce::uint32 now = juce::Time::getMillisecondCounter();
+        if ((juce::int32) (deadline - now) <= 0)
+            return -1;
+        int wait = juce::jmin(API_POLL_SLICE_MS, (int) (deadline - now));
+        int ready = connection.waitUntilReady(true, wait);
+        if (ready < 0)
+            return -1;
+        if (ready > 0)
+            return connection.read(buffer, size, false);
+    }
+    return -1;
+}
+
+bool APIClient::exchange(juce::StreamingSocket& connection, const Pending& job, juce::uint32 deadline, APIResponse& response, bool& keepAlive, bool& receivedNothing) {
+    const APIRequest& request = job.request;
+    juce::MemoryBlock body(request.body.toRawUTF8(), request.body.getNumBytesAsUTF8());
+
+    juce::String head = request.method + " " + request.path + " HTTP/1.1\r\n"
+        + "Host: " + host + ":" + juce::String(port) + "\r\n"
+        + "Connection: keep-alive\r\n";
+    if (request.contentType.isNotEmpty())
+        head += "Content-Type: " + request.contentType + "\r\n";
+    if (body.getSize() > 0 || request.method != "GET")
+        head += "Content-Length: " + juce::String((int) body.getSize()) + "\r\n";
+    head += request.headers + "\r\n";
+
+    juce::MemoryBlock message(head.toRawUTF8(), head.getNumBytesAsUTF8());
+    message.append(body.getData(), body.getSize());
+    receivedNothing = true;
+    response.sent = true;
+    if (!writeAll(connection, job, deadline, (const char*) message.getData(), (int) message.getSize()))
+        return false;
+
+    std::vector<char> data;
+    char buffer[API_READ_SIZE];
+    bool closed = false;
+    // Reads until at least needed bytes have arrived.
+    auto fill = [&](size_t needed) {
+        while (!closed && data.size() < needed) {
+            int bytesRead = readSome(connection, job, deadline, buffer, API_READ_SIZE);
+            if (bytesRead < 0)
+                return false;
+            if (bytesRead == 0) {
+                closed = true;
+                break;
+            }
+            receivedNothing = false;
+            data.insert(data.end(), buffer, buffer + bytesRead);
+        }
+        return data.size() >= needed;
+    };
+    auto findLineEnd = [&](size_t from) -> size_t {
+        const char* end = "\r\n";
+        while (true) {
+            auto it = std::search(data.begin() + (std::ptrdiff_t) from, data.end(), end, end + 2);
+            if (it != data.end())
+                return (size_t) (it - data.begin());
+            if (data.size() - from > API_MAX_HEADER_SIZE || !fill(data.size() + 1))
+                return std::string::npos;
+        }
+    };
+
+    // Status line and headers.
+    size_t headerEnd = 0;
+    while (true) {
+        const char* end = "\r\n\r\n";
+        auto it = std::search(data.begin(), data.end(), end, end + 4);
+        if (it != data.end()) {
+            headerEnd = (size_t) (it - data.begin()) + 4;
+            break;
+        }
+        if (data.size() > API_MAX_HEADER_SIZE || !fill(data.size() + 1))
+            return false;
+    }
+    juce::StringArray lines;
+    lines.addTokens(juce::String::fromUTF8(data.data(), (int) headerEnd), "\r\n", "");
+    lines.removeEmptyStrings();
+    if (lines.isEmpty() || !lines[0].startsWith("HTTP/1."))
+        return false;
+    response.statusCode = lines[0].fromFirstOccurrenceOf(" ", false, false).getIntValue();
+    for (int i = 1; i < lines.size(); i++)
+        response.headers.set(lines[i].upToFirstOccurrenceOf(":", false, false).trim(), lines[i].fromFirstOccurrenceOf(":", false, false).trim());
+    keepAlive = !lines[0].startsWith("HTTP/1.0") && !response.headers["Connection"].equalsIgnoreCase("close");
+
+    // Body. Bytes are passed on as they arrive and dropped from data, so a streamed body is never held whole.
+    data.erase(data.begin(), data.begin() + (std::ptrdiff_t) headerEnd);
+    bool streaming = request.onBodyData != nullptr && response.isSuccess();
+    std::vector<char> body;
+    auto consume = [&](size_t size) {
+        if (streaming)
+            request.onBodyData(job.id, data.data(), (int) size);
+        else
+            body.insert(body.end(), data.begin(), data.begin() + (std::ptrdiff_t) size);
+        data.erase(data.begin(), data.begin() + (std::ptrdiff_t) size);
+    };
+    auto consumeExactly = [&](size_t size) {
+        while (size > 0) {
+            if (data.empty() && !fill(1))
+                return false;
+            size_t available = juce::jmin(size, data.size());
+            consume(available);
+            size -= available;
+        }
+        return true;
+    };
+
+    bool noBody = request.method == "HEAD" || response.statusCode == 204 || response.statusCode == 304 || response.statusCode / 100 == 1;
+    if (noBody) {
+        data.clear();
+    } else if (response.headers["Transfer-Encoding"].containsIgnoreCase("chunked")) {
+        while (true) {
+            size_t lineEnd = findLineEnd(0);
+            if (lineEnd == std::string::npos)
+                return false;
+            juce::String sizeLine = juce::String::fromUTF8(data.data(), (int) lineEnd);
+            size_t chunkSize = (size_t) sizeLine.upToFirstOccurrenceOf(";", false, false).trim().getHexValue64();
+            data.erase(data.begin(), data.begin() + (std::ptrdiff_t) (lineEnd + 2));
+            if (chunkSize == 0)
+                break;
+            if (!consumeExactly(chunkSize) || !fill(2))
+                return false;
+            data.erase(data.begin(), data.begin() + 2);
+        }
+        // Skip any trailers up to the blank line that ends the message.
+        while (true) {
+            size_t lineEnd = findLineEnd(0);
+            if (lineEnd == std::string::npos)
+                return false;
+            data.erase(data.begin(), data.begin() + (std::ptrdiff_t) (lineEnd + 2));
+            if (lineEnd == 0)
+                break;
+        }
+    } else if (response.headers.containsKey("Content-Length")) {
+        if (!consumeExactly((size_t) response.headers["Content-Length"].getLargeIntValue()))
+            return false;
+    } else {
+        // Without a length the body runs until the server closes the connection.
+        while (true) {
+            consume(data.size());
+            if (closed)
+                break;
+            if (!fill(1) && !closed)
+                return false;
+        }
+        keepAlive = false;
+    }
+    if (closed)
+        keepAlive = false;
+
+    response.body = juce::String::fromUTF8(body.data(), (int) body.size());
+    return true;
+}
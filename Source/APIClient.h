@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    APIClient.h
+    Created: 19 Oct 2026 6:37:34am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#define API_HOST "localhost"
+#define API_PORT 8080
+#define API_CLIENT_WORKERS 2
+#define API_DEFAULT_TIMEOUT_MS 10000
+#define API_PROMPT_TIMEOUT_MS 120000 // Prompts wait on the model, so they get far longer than everything else.
+#define API_POLL_SLICE_MS 50 // How often a waiting request checks whether it has been cancelled.
+#define API_CONNECT_TIMEOUT_MS 3000 // A connect can't be interrupted, so this is as long as a cancel can wait.
+#define API_MAX_HEADER_SIZE 16384
+#define API_READ_SIZE 8192
+
+struct APIRequest {
+    juce::String method = "GET";
+    juce::String path; // With any query string, e.g. "/renderState/get?id=3".
+    juce::String headers; // Extra header lines, each ending in \r\n.
+    juce::String contentType;
+    juce::String body;
+    int timeoutMs = API_DEFAULT_TIMEOUT_MS;
+    // Called on a worker thread with the body of a successful response as it arrives, chunked bodies already
+    // decoded. The body is then left out of APIResponse::body. Use APIClient::post() to hand results over.
+    std::function<void(int requestId, const char* data, int size)> onBodyData;
+};
+
+struct APIResponse {
+    int statusCode = 0; // 0 if the request failed before a response arrived.
+    bool sent = false; // Set once the request has started to be written, so a failure may still have reached the server.
+    juce::StringPairArray headers; // Names are matched ignoring case.
+    juce::String body;
+
+    bool isSuccess() const {
+        return statusCode >= 200 && statusCode < 300;
+    }
+};
+
+/*
+    Talks HTTP/1.1 to the backend from a small pool of worker threads.
+
+    Requests are queued and answered through a callback on the message thread, so nothing on the UI or GL
+    threads ever waits on the network. Connections are kept alive and handed back to an idle pool after each
+    response, so after the first request to the backend most requests skip the TCP connect. If a reused
+    connection turns out to have been closed by the server before any of the response arrived, the request is
+    sent once more on a fresh connection.
+
+    Every request has its own timeout covering the connect and the whole exchange. Sending and receiving poll
+    every API_POLL_SLICE_MS, so a cancelled request stops at its next poll. A connect can't be interrupted, so
+    it is given at most API_CONNECT_TIMEOUT_MS, and a request cancelled during one stops once it returns. Either
+    way its callback is never called, so an owner can cancel in its destructor and be sure nothing calls back
+    into it. The client's destructor waits for its workers to stop, which takes at most as long as a connect.
+    Use one instance through juce::SharedResourcePointer.
+*/
+class APIClient {
+public:
+    using Callback = std::function<void(const APIResponse&)>;
+
+    APIClient(const juce::String& host = API_HOST, int port = API_PORT, int numWorkers = API_CLIENT_WORKERS);
+    ~APIClient();
+
+    // Queues a request. The callback is called on the message thread unless the request is cancelled first.
+    // Returns an id for cancel().
+    int request(const APIRequest& request, Callback callback);
+
+    // Runs a function on the message thread unless the request has been cancelled by then. Functions posted
+    // from onBodyData run in order and before the request's callback.
+    void post(int requestId, std::function<void()> function);
+
+    // Must be called on the message thread to guarantee the callback won't be called.
+    void cancel(int requestId);
+    void cancelAll();
+
+private:
+    struct Pending {
+        int id;
+        APIRequest request;
+        Callback callback;
+        std::atomic<bool> cancelled{ false };
+    };
+
+    // Shared with callbacks waiting on the message thread, which may outlive the client.
+    struct Registry {
+        juce::CriticalSection lock;
+        std::unordered_map<int, std::shared_ptr<Pending>> pending;
+        int nextRequestId = 1;
+    };
+
+    juce::String host;
+    int port;
+    std::shared_ptr<Registry> registry;
+
+    juce::CriticalSection connectionsLock;
+    std::vector<std::unique_ptr<juce::StreamingSocket>> idleConnections;
+
+    juce::ThreadPool workers; // Last, so the destructor waits for the workers while the connections still exist.
+
+    void perform(std::shared_ptr<Pending> job);
+    void finish(std::shared_ptr<Pending> job, APIResponse response);
+
+    std::unique_ptr<juce::StreamingSocket> takeConnection(bool& reused, int timeoutMs);
+    void returnConnection(std::unique_ptr<juce::StreamingSocket> connection);
+
+    // Returns false if the connection failed or the request was cancelled. receivedNothing is set if the failure
+    // came before any of the response arrived, which is when a stale kept alive connection is worth retrying.
+    bool exchange(juce::StreamingSocket& connection, const Pending& job, juce::uint32 deadline, APIResponse& response, bool& keepAlive, bool& receivedNothing);
+    int readSome(juce::StreamingSocket& connection, const Pending& job, juce::uint32 deadline, char* buffer, int size);
+    bool writeAll(juce::StreamingSocket& connection, const Pending& job, juce::uint32 deadline, const char* data, int size);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(APIClient)
+};
@@ -13,6 +13,10 @@
 #include <JuceHeader.h>
 #include <vector>
 
+#include "APIClient.h"
+#include "JSONArrayStream.h"
+#include "PromptStream.h"
+
 #define REGISTER_API_ERROR -1
 #define REGISTER_SUCCESS 0
 #define REGISTER_INVALID_USERNAME_NULL 1
@@ -26,30 +30,30 @@ struct RenderStateStruct {
     int id;
     juce::String name;
     juce::String renderState;
+    juce::String version; // Changes whenever the render state does. Empty if the server doesn't send one.
 };
 
-// Blocking operation.
-inline juce::String postPromptResponse(const juce::String& jwt, const juce::String& prompt) {
-    juce::URL url("http://localhost:8080/prompt");
-    url = url.withPOSTData("prompt=" + prompt);
-
-    int statusCode = 0;
+#define API_FORM_CONTENT_TYPE "application/x-www-form-urlencoded"
 
-    auto options = juce::URL::InputStreamOptions(
-        juce::URL::ParameterHandling::inAddress)
-        .withHttpRequestCmd("POST")
-        .withConnectionTimeoutMs(120000)
-        .withExtraHeaders("Content-Type: application/x-www-form-urlencoded\r\nAuthorization: Bearer " + jwt)
-        .withStatusCode(&statusCode);
+inline juce::String bearer(const juce::String& jwt) {
+    return "Authorization: Bearer " + jwt + "\r\n";
+}
 
-    auto stream = url.createInputStream(options);
-    if (stream == nullptr) { // Stream may timeout or the service may be unreachable.
-        DBG("URL stream is null trying to input api prompt payload!");
-        return "";
-    }
+// The user a JWT was issued to, from the "sub" claim of its payload. Empty if the token can't be read.
+inline juce::String getJWTSubject(const juce::String& jwt) {
+    juce::String payload = jwt.fromFirstOccurrenceOf(".", false, false).upToFirstOccurrenceOf(".", false, false);
+    payload = payload.replaceCharacter('-', '+').replaceCharacter('_', '/');
+    while (payload.length() % 4 != 0)
+        payload += "=";
+    juce::MemoryOutputStream decoded;
+    if (payload.isEmpty() || !juce::Base64::convertFromBase64(decoded, payload))
+        return {};
+    return juce::JSON::parse(decoded.toString())["sub"].toString();
+}
 
-    juce::String response = stream->readEntireStreamAsString();
-    
+inline juce::String parsePromptResponse(const APIResponse& apiResponse) {
+    int statusCode = apiResponse.statusCode;
+    const juce::String& response = apiResponse.body;
     if (response.length() == 0) {
         DBG("Failed to receive an API JSON Prompt Response! Status code: " << statusCode);
         return "";
@@ -82,63 +86,87 @@ inline juce::String postPromptResponse(const juce::String& jwt, const juce::Stri
     return parsedResponse;
 }
 
-inline juce::String api_login(const juce::String& username, const juce::String& password) {
-    juce::URL url("http://localhost:8080/auth/token");
+// Calls back on the message thread with the new fragment shader, or an empty string if it failed.
+inline int postPromptResponse(APIClient& client, const juce::String& jwt, const juce::String& prompt, std::function<void(const juce::String&)> onResponse) {
+    APIRequest request;
+    request.method = "POST";
+    request.path = "/prompt";
+    request.contentType = API_FORM_CONTENT_TYPE;
+    request.headers = bearer(jwt);
+    request.body = "prompt=" + juce::URL::addEscapeChars(prompt, true);
+    request.timeoutMs = API_PROMPT_TIMEOUT_MS;
+    return client.request(request, [onResponse](const APIResponse& response) {
+        onResponse(parsePromptResponse(response));
+    });
+}
 
+/*
+    Like postPromptResponse, but asks for the shader to be streamed and calls onPartial on the message thread
+    with the text so far each time more of it arrives, so the caller can show progress and try to compile early.
+    onDone is called last with the whole shader, or an empty string if it failed or the backend refused it.
+    Servers that only answer with JSON get no partials. Cancelling the request stops both callbacks.
+*/
+inline int postPromptStream(APIClient& client, const juce::String& jwt, const juce::String& prompt, std::function<void(const juce::String&)> onPartial, std::function<void(const juce::String&)> onDone) {
+    APIRequest request;
+    request.method = "POST";
+    request.path = "/prompt";
+    request.contentType = API_FORM_CONTENT_TYPE;
+    request.headers = bearer(jwt) + "Accept: text/event-stream, text/plain;q=0.9, application/json;q=0.8\r\n";
+    request.body = "prompt=" + juce::URL::addEscapeChars(prompt, true);
+    request.timeoutMs = API_PROMPT_TIMEOUT_MS;
+    auto stream = std::make_shared<PromptStream>();
+    APIClient* owner = &client; // For posting partials. onBodyData only runs on the client's workers.
+    request.onBodyData = [stream, owner, onPartial, postedLength = 0](int requestId, const char* data, int size) mutable {
+        stream->feed(data, size);
+        if (stream->isJSON())
+            return;
+        juce::String shader = stream->getShader();
+        if (shader.length() == postedLength)
+            return; // Only framing or a fence arrived.
+        postedLength = shader.length();
+        owner->post(requestId, [onPartial, shader]() { onPartial(shader); });
+    };
+    return client.request(request, [stream, onDone](const APIResponse& response) {
+        if (!response.isSuccess()) {
+            // The body of a failure is never streamed, so it is in the response.
+            DBG("Failed to receive a streamed prompt response! Status code: " << response.statusCode);
+            onDone("");
+            return;
+        }
+        stream->finish();
+        if (stream->isJSON()) {
+            APIResponse whole = response;
+            whole.body = stream->getBody();
+            onDone(parsePromptResponse(whole));
+            return;
+        }
+        onDone(stream->getShader());
+    });
+}
+
+// Calls back on the message thread with the JWT, or an empty string if the login failed.
+inline int api_login(APIClient& client, const juce::String& username, const juce::String& password, std::function<void(const juce::String&)> onToken) {
     juce::String credentials = username + ":" + password;
     juce::String encoded = juce::Base64::toBase64(credentials.toRawUTF8(),
         credentials.getNumBytesAsUTF8());
 
-    juce::String headers = "Authorization: Basic " + encoded + "\r\n";
-
-    int statusCode = 0;
-
-    auto options = juce::URL::InputStreamOptions(
-        juce::URL::ParameterHandling::inAddress)
-        .withHttpRequestCmd("POST")
-        .withExtraHeaders(headers)
-        .withStatusCode(&statusCode);
-
-    auto stream = url.createInputStream(options);
-    // Stream may timeout or the service may be unreachable.
-    if (stream == nullptr) {
-        DBG("URL stream is null trying to input api login payload!");
-        return "";
-    }
-    DBG("login payload complete. Status code: " << statusCode);
-
-    return stream->readEntireStreamAsString();
+    APIRequest request;
+    request.method = "POST";
+    request.path = "/auth/token";
+    request.headers = "Authorization: Basic " + encoded + "\r\n";
+    return client.request(request, [onToken](const APIResponse& response) {
+        DBG("login payload complete. Status code: " << response.statusCode);
+        onToken(response.isSuccess() ? response.body : juce::String());
+    });
 }
 
 /*
     Returns:
         REGISTER_API_ERROR if error with API call or validation.
 */
-inline int api_register(const juce::String& username, const juce::String& password) {
-    juce::URL url("http://localhost:8080/auth/register");
-
-    juce::String credentials = "username=" + juce::URL::addEscapeChars(username, true) + "&password=" + juce::URL::addEscapeChars(password, true);
-
-    url = url.withPOSTData(credentials);
-
-    juce::String headers = "Content-Type: application/x-www-form-urlencoded\r\n";
-
-    int statusCode = 0;
-
-    auto options = juce::URL::InputStreamOptions(
-        juce::URL::ParameterHandling::inPostData)
-        .withHttpRequestCmd("POST")
-        .withExtraHeaders(headers)
-        .withStatusCode(&statusCode);
-
-    auto stream = url.createInputStream(options);
-
-    if (stream == nullptr) {
-        DBG("Register request failed: stream is null");
-        return REGISTER_API_ERROR;
-    }
-
-    juce::String response = stream->readEntireStreamAsString();
+inline int parseRegisterResponse(const APIResponse& apiResponse) {
+    int statusCode = apiResponse.statusCode;
+    const juce::String& response = apiResponse.body;
     DBG(response);
 
     if (response.length() == 0) {
@@ -170,252 +198,197 @@ inline int api_register(const juce::String& username, const juce::String& passwo
     return success;
 }
 
-// Blocking operation.
-// Returns uuid for the new render state if successful, otherwise returns an empty string.
-inline juce::String postAddRenderState(const juce::String& jwt, const juce::String& name, const juce::String& renderState) {
+// Calls back on the message thread with one of the REGISTER_ statuses.
+inline int api_register(APIClient& client, const juce::String& username, const juce::String& password, std::function<void(int)> onStatus) {
+    APIRequest request;
+    request.method = "POST";
+    request.path = "/auth/register";
+    request.contentType = API_FORM_CONTENT_TYPE;
+    request.body = "username=" + juce::URL::addEscapeChars(username, true) + "&password=" + juce::URL::addEscapeChars(password, true);
+    return client.request(request, [onStatus](const APIResponse& response) {
+        onStatus(parseRegisterResponse(response));
+    });
+}
+
+// Calls back on the message thread with the status code, whether the request was sent, and the id of the new
+// render state, or an empty string if it failed. A save that was sent but got no response may have been made.
+inline int postAddRenderState(APIClient& client, const juce::String& jwt, const juce::String& name, const juce::String& renderState, std::function<void(int, bool, const juce::String&)> onId) {
     juce::var postBodyJson = new juce::DynamicObject();
     postBodyJson.getDynamicObject()->setProperty("name", name);
     postBodyJson.getDynamicObject()->setProperty("renderState", renderState);
 
-    juce::URL url("http://localhost:8080/renderState/add");
-
-    url = url.withPOSTData("jsonrsbody=" + juce::URL::addEscapeChars(juce::JSON::toString(postBodyJson, true), true));
-
-    int statusCode = 0;
-
-    auto options = juce::URL::InputStreamOptions(
-        juce::URL::ParameterHandling::inPostData)
-        .withHttpRequestCmd("POST")
-        .withConnectionTimeoutMs(120000)
-        .withExtraHeaders("Content-Type: application/x-www-form-urlencoded\r\nAuthorization: Bearer " + jwt)
-        .withStatusCode(&statusCode);
-
-    auto stream = url.createInputStream(options);
-    if (stream == nullptr) { // Stream may timeout or the service may be unreachable.
-        DBG("URL stream is null trying to add a renderState!");
-        return "";
-    }
-
-    juce::String response = stream->readEntireStreamAsString();
-
-    if (response.length() == 0) {
-        DBG("Failed to receive an API call render state id Response! Status code: " << statusCode);
-        return "";
-    }
-    DBG("API post add render state id response resolved to: " << response);
-    return response;
-}
-
-// Blocking operation.
-inline std::vector<struct RenderStateStruct> getGetAllRenderStates(const juce::String& jwt) {
-    juce::URL url("http://localhost:8080/renderState/getAll");
-
-    int statusCode = 0;
-
-    auto options = juce::URL::InputStreamOptions(
-        juce::URL::ParameterHandling::inAddress)
-        .withHttpRequestCmd("GET")
-        .withConnectionTimeoutMs(120000)
-        .withExtraHeaders("Content-Type: application/x-www-form-urlencoded\r\nAuthorization: Bearer " + jwt)
-        .withStatusCode(&statusCode);
-
-    auto stream = url.createInputStream(options);
-    if (stream == nullptr) { // Stream may timeout or the service may be unreachable.
-        DBG("URL stream is null trying to get all renderStates!");
-        return {};
-    }
-
-    juce::String response = stream->readEntireStreamAsString();
-    DBG("A response for getAllRenderStates has been received as stream string: " << response);
-
-    if (response.length() == 0) {
-        DBG("Failed to receive an API JSON Prompt Response! Status code: " << statusCode);
-        return {};
-    }
-
-    juce::var parsed = juce::JSON::parse(response);
-    if (parsed.isVoid()) {
-        DBG("Failed to parse API JSON Prompt Response! Status code: " << statusCode);
-        return {};
-    }
-    if (!parsed.isArray()) {
-        DBG("The get all render states response was not an array!");
-        return {};
-    }
-	std::vector<struct RenderStateStruct> renderStates;
-    auto* arr = parsed.getArray();
-    for (auto& rs : *arr) {
-        auto* obj = rs.getDynamicObject();
-
-        int id_parsed;
-        juce::String name_parsed;
-        juce::String renderState_parsed;
-
-        if (obj == nullptr) {
-            DBG("API JSON get all id Response is a nullptr! Status code: " << statusCode);
-            DBG("parsed: " << rs.toString());
-            continue;
-        }
-        if (obj->getProperty("id").isVoid()) {
-            DBG("No success status could be resolved from API JSON get all Response! Status code: " << statusCode);
-            DBG("parsed: " << rs.toString());
-            continue;
-        }
-        juce::var id = obj->getProperty("id");
-        if (!id.isInt()) {
-            DBG("No id could be resolved from API JSON get all Response! Status code: " << statusCode);
-            DBG("parsed: " << rs.toString());
-            continue;
-        }
-        id_parsed = std::atoi(id.toString().toRawUTF8());
-
-        if (obj->getProperty("name").isVoid()) {
-            DBG("No name could be resolved from API JSON get all Response! Status code: " << statusCode);
-            DBG("parsed: " << rs.toString());
-            continue;
+    APIRequest request;
+    request.method = "POST";
+    request.path = "/renderState/add";
+    request.contentType = API_FORM_CONTENT_TYPE;
+    request.headers = bearer(jwt);
+    request.body = "jsonrsbody=" + juce::URL::addEscapeChars(juce::JSON::toString(postBodyJson, true), true);
+    return client.request(request, [onId](const APIResponse& response) {
+        if (response.body.length() == 0) {
+            DBG("Failed to receive an API call render state id Response! Status code: " << response.statusCode);
+            onId(response.statusCode, response.sent, {});
+            return;
         }
-        juce::var name = obj->getProperty("name");
-        name_parsed = name.toString();
-
-        if (obj->getProperty("renderState").isVoid()) {
-            DBG("No renderState could be resolved from API JSON get all Response! Status code: " << statusCode);
-            DBG("name parsed: " << name_parsed << " id parsed: " << id_parsed);
-            continue;
-        }
-        juce::var renderState = obj->getProperty("renderState");
-        renderState_parsed = renderState.toString();
-
-        renderStates.push_back({
-            .id = id_parsed,
-            .name = name_parsed,
-            .renderState = renderState_parsed
-            });
-    }
-    return renderStates;
+        DBG("API post add render state id response resolved to: " << response.body);
+        onId(response.statusCode, response.sent, response.body);
+    });
 }
 
-// Blocking operation.
-inline struct RenderStateStruct getGetRenderState(const juce::String& jwt, int renderStateId) {
-    juce::URL url("http://localhost:8080/renderState/get");
-    url = url.withPOSTData("id=" + renderStateId);
-
-    int statusCode = 0;
-
-    auto options = juce::URL::InputStreamOptions(
-        juce::URL::ParameterHandling::inAddress)
-        .withHttpRequestCmd("GET")
-        .withConnectionTimeoutMs(120000)
-        .withExtraHeaders("Content-Type: application/x-www-form-urlencoded\r\nAuthorization: Bearer " + jwt)
-        .withStatusCode(&statusCode);
-
-    auto stream = url.createInputStream(options);
-    if (stream == nullptr) { // Stream may timeout or the service may be unreachable.
-        DBG("URL stream is null trying to get a renderState with id: " << renderStateId);
-        return {};
-    }
-
-    juce::String response = stream->readEntireStreamAsString();
-
-    if (response.length() == 0) {
-        DBG("Failed to receive an API JSON Prompt Response! Status code: " << statusCode);
-        return {};
-    }
-
-    juce::var parsed = juce::JSON::parse(response);
-    if (parsed.isVoid()) {
-        DBG("Failed to parse API JSON Prompt Response! Status code: " << statusCode);
-        return {};
-    }
-    int id_parsed;
-    juce::String name_parsed;
-    juce::String renderState_parsed;
-
-    juce::DynamicObject* obj = parsed.getDynamicObject();
+// Returns false and logs why if the object isn't a whole render state.
+inline bool parseRenderState(const juce::var& rs, struct RenderStateStruct& renderState, int statusCode) {
+    auto* obj = rs.getDynamicObject();
     if (obj == nullptr) {
         DBG("API JSON get rs Response is a nullptr! Status code: " << statusCode);
-        return {};
+        DBG("parsed: " << rs.toString());
+        return false;
     }
     if (obj->getProperty("id").isVoid()) {
         DBG("No success status could be resolved from API JSON get rs Response! Status code: " << statusCode);
-        return {};
+        DBG("parsed: " << rs.toString());
+        return false;
     }
     juce::var id = obj->getProperty("id");
     if (!id.isInt()) {
         DBG("No id could be resolved from API JSON get rs Response! Status code: " << statusCode);
-        return {};
+        DBG("parsed: " << rs.toString());
+        return false;
     }
-    id_parsed = std::atoi(id.toString().toRawUTF8());
+    int id_parsed = std::atoi(id.toString().toRawUTF8());
 
     if (obj->getProperty("name").isVoid()) {
         DBG("No name could be resolved from API JSON get rs Response! Status code: " << statusCode);
-        return {};
+        DBG("parsed: " << rs.toString());
+        return false;
     }
-    juce::var name = obj->getProperty("name");
-    name_parsed = name.toString();
+    juce::String name_parsed = obj->getProperty("name").toString();
 
     if (obj->getProperty("renderState").isVoid()) {
         DBG("No renderState could be resolved from API JSON get rs Response! Status code: " << statusCode);
-        return {};
+        DBG("name parsed: " << name_parsed << " id parsed: " << id_parsed);
+        return false;
     }
-    juce::var renderState = obj->getProperty("renderState");
-    renderState_parsed = renderState.toString();
+    juce::String renderState_parsed = obj->getProperty("renderState").toString();
 
-    return {
+    renderState = {
         .id = id_parsed,
         .name = name_parsed,
-        .renderState = renderState_parsed
+        .renderState = renderState_parsed,
+        .version = obj->getProperty("version").toString()
         };
+    return true;
 }
 
-// Blocking operation.
-inline int deleteDeleteRenderState(const juce::String& jwt, int renderStateId) {
-    juce::URL url("http://localhost:8080/renderState/delete");
-    url = url.withPOSTData("id=" + renderStateId);
-
-    int statusCode = 0;
-
-    auto options = juce::URL::InputStreamOptions(
-        juce::URL::ParameterHandling::inAddress)
-        .withHttpRequestCmd("DELETE")
-        .withConnectionTimeoutMs(120000)
-        .withExtraHeaders("Content-Type: application/x-www-form-urlencoded\r\nAuthorization: Bearer " + jwt)
-        .withStatusCode(&statusCode);
+// Like parseRenderState, for list entries that have no body.
+inline bool parseRenderStateSummary(const juce::var& rs, struct RenderStateStruct& renderState) {
+    auto* obj = rs.getDynamicObject();
+    if (obj == nullptr || !obj->getProperty("id").isInt() || obj->getProperty("name").isVoid()) {
+        DBG("Render state list entry is missing an id or name: " << juce::JSON::toString(rs, true));
+        return false;
+    }
+    renderState = {
+        .id = (int) obj->getProperty("id"),
+        .name = obj->getProperty("name").toString(),
+        .renderState = {},
+        .version = obj->getProperty("version").toString()
+        };
+    return true;
+}
 
-    auto stream = url.createInputStream(options);
-    if (stream == nullptr) { // Stream may timeout or the service may be unreachable.
-        DBG("URL stream is null trying to delete a renderState with id: " << renderStateId);
-        return {};
-    }
+/*
+    Streams a JSON array of render states, calling onBatch on the message thread with the ones in each piece of
+    the response as it arrives, so a long list can be shown as it loads. Only one element is ever held as text.
+    onDone is called last with the status code, and whether the whole array arrived.
+*/
+inline int streamRenderStates(APIClient& client, APIRequest request, bool withBodies, std::function<void(std::vector<struct RenderStateStruct>)> onBatch, std::function<void(int, bool)> onDone) {
+    auto stream = std::make_shared<JSONArrayStream>();
+    APIClient* owner = &client; // Raw, since batches are parsed on the client's workers and it outlives them.
+    request.onBodyData = [stream, owner, withBodies, onBatch](int requestId, const char* data, int size) {
+        std::vector<struct RenderStateStruct> batch;
+        stream->feed(data, size, [&](const juce::var& rs) {
+            struct RenderStateStruct renderState;
+            if (withBodies ? parseRenderState(rs, renderState, 200) : parseRenderStateSummary(rs, renderState))
+                batch.push_back(renderState);
+        });
+        if (!batch.empty())
+            owner->post(requestId, [onBatch, batch]() { onBatch(batch); });
+    };
+    return client.request(request, [stream, onDone](const APIResponse& response) {
+        bool complete = response.isSuccess() && stream->isFinished();
+        if (!complete)
+            DBG("A render state list did not arrive whole! Status code: " << response.statusCode);
+        onDone(response.statusCode, complete);
+    });
+}
 
-    juce::String response = stream->readEntireStreamAsString();
+// Streams every render state the user has saved, bodies included.
+inline int getGetAllRenderStates(APIClient& client, const juce::String& jwt, std::function<void(std::vector<struct RenderStateStruct>)> onBatch, std::function<void(int, bool)> onDone) {
+    APIRequest request;
+    request.path = "/renderState/getAll";
+    request.headers = bearer(jwt);
+    return streamRenderStates(client, request, true, onBatch, onDone);
+}
 
-    if (response.length() == 0) {
-        DBG("Failed to receive an API JSON Prompt Response! Status code: " << statusCode);
-        return {};
-    }
+// Streams the id, name and version of every render state the user has saved, without their bodies. The status
+// code is 404 on servers that predate the list endpoint, which only have getGetAllRenderStates.
+inline int getListRenderStates(APIClient& client, const juce::String& jwt, std::function<void(std::vector<struct RenderStateStruct>)> onBatch, std::function<void(int, bool)> onDone) {
+    APIRequest request;
+    request.path = "/renderState/list";
+    request.headers = bearer(jwt);
+    return streamRenderStates(client, request, false, onBatch, onDone);
+}
 
-    int status = std::atoi(response.toRawUTF8());
+/*
+    Calls back on the message thread with the status code, the render state and its ETag. With an etag the
+    request is conditional, and a 304 means the body the etag came with is still current, so nothing else is
+    sent. On any other failure the render state has an empty name.
+*/
+inline int getGetRenderState(APIClient& client, const juce::String& jwt, int renderStateId, const juce::String& etag, std::function<void(int, struct RenderStateStruct, const juce::String&)> onRenderState) {
+    APIRequest request;
+    request.path = "/renderState/get?id=" + juce::String(renderStateId);
+    request.headers = bearer(jwt);
+    if (etag.isNotEmpty())
+        request.headers += "If-None-Match: " + etag + "\r\n";
+    return client.request(request, [onRenderState, renderStateId](const APIResponse& response) {
+        struct RenderStateStruct renderState = {};
+        if (response.statusCode == 304) {
+            renderState.id = renderStateId;
+        } else if (response.body.length() == 0) {
+            DBG("Failed to receive a render state with id: " << renderStateId << " Status code: " << response.statusCode);
+        } else {
+            juce::var parsed = juce::JSON::parse(response.body);
+            if (parsed.isVoid() || !parseRenderState(parsed, renderState, response.statusCode))
+                renderState = {};
+        }
+        onRenderState(response.statusCode, renderState, response.headers["ETag"]);
+    });
+}
 
-    return status;
+// Calls back on the message thread with the status code and the status the API replied with.
+inline int deleteDeleteRenderState(APIClient& client, const juce::String& jwt, int renderStateId, std::function<void(int, int)> onStatus) {
+    APIRequest request;
+    request.method = "DELETE";
+    request.path = "/renderState/delete?id=" + juce::String(renderStateId);
+    request.headers = bearer(jwt);
+    return client.request(request, [onStatus](const APIResponse& response) {
+        if (response.body.length() == 0) {
+            DBG("Failed to receive an API JSON Prompt Response! Status code: " << response.statusCode);
+            onStatus(response.statusCode, 0);
+            return;
+        }
+        onStatus(response.statusCode, std::atoi(response.body.toRawUTF8()));
+    });
 }
 
-inline void deleteDeleteAllRenderStates(const juce::String& jwt) {
-    juce::URL url("http://localhost:8080/renderState/deleteAll");
-    int statusCode = 0;
-    auto options = juce::URL::InputStreamOptions(
-        juce::URL::ParameterHandling::inAddress)
-        .withHttpRequestCmd("DELETE")
-        .withConnectionTimeoutMs(120000)
-        .withExtraHeaders("Content-Type: application/x-www-form-urlencoded\r\nAuthorization: Bearer " + jwt)
-        .withStatusCode(&statusCode);
-    auto stream = url.createInputStream(options);
-    if (stream == nullptr) { // Stream may timeout or the service may be unreachable.
-        DBG("URL stream is null trying to delete all renderStates!");
-        return;
-    }
-    juce::String response = stream->readEntireStreamAsString();
-    if (response.length() == 0) {
-        DBG("Failed to receive an API JSON Prompt Response! Status code: " << statusCode);
-        return;
-    }
-}
\ No newline at end of file
+// Calls back on the message thread with the status code.
+inline int deleteDeleteAllRenderStates(APIClient& client, const juce::String& jwt, std::function<void(int)> onDone = nullptr) {
+    APIRequest request;
+    request.method = "DELETE";
+    request.path = "/renderState/deleteAll";
+    request.headers = bearer(jwt);
+    return client.request(request, [onDone](const APIResponse& response) {
+        if (response.body.length() == 0)
+            DBG("Failed to receive an API JSON Prompt Response! Status code: " << response.statusCode);
+        if (onDone)
+            onDone(response.statusCode);
+    });
+}
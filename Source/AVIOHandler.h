@@ -21,6 +21,12 @@ inline bool saveRenderStateToFile(juce::String absolutePath, juce::String shader
     return file.replaceWithText(shader, false, false, "\n");
 }
 
+// Writes a temporary file beside the target and renames it into place, creating the folder if need be. A crash
+// mid-write leaves the old contents or the new ones, never a mix.
+inline bool replaceFileAtomically(const juce::File& file, const juce::String& text) {
+    return file.getParentDirectory().createDirectory() && file.replaceWithText(text);
+}
+
 inline juce::String getRenderStateFromFile(juce::String absolutePath) {
     juce::File file = juce::File(absolutePath);
     return file.loadFileAsString();
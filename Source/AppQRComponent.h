@@ -27,6 +27,9 @@ public:
 			.withNativeFunction(juce::Identifier{"nativeFunctionGetSocketHandle"}, [this](const juce::Array<juce::var>& args, juce::WebBrowserComponent::NativeFunctionCompletion completion) {
 				nativeFunctionGetSocketHandle(std::move(completion));
 				})
+			.withNativeFunction(juce::Identifier{"nativeFunctionGetWebSocketHandle"}, [this](const juce::Array<juce::var>& args, juce::WebBrowserComponent::NativeFunctionCompletion completion) {
+				nativeFunctionGetWebSocketHandle(std::move(completion));
+				})
 			.withNativeIntegrationEnabled() } {
 
 		webView.goToURL(webView.getResourceProviderRoot() + "appqr.html");
@@ -46,6 +49,10 @@ private:
 	void nativeFunctionGetSocketHandle(juce::WebBrowserComponent::NativeFunctionCompletion completion) {
 		completion(settings.getSocketConnectionHandle());
 	}
+
+	void nativeFunctionGetWebSocketHandle(juce::WebBrowserComponent::NativeFunctionCompletion completion) {
+		completion(settings.getWebSocketConnectionHandle());
+	}
 };
 
 class AppQRComponent : public juce::DocumentWindow {
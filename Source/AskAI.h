@@ -14,7 +14,10 @@
 #include "RenderState2D.h"
 #include "AVAPIResolver.h"
 #include "AVIOHandler.h"
+#include "RenderStateCache.h"
+#include "RenderStateSyncQueue.h"
 #include "Settings.h"
+#include "ShaderValidator.h"
 
 class AskAI : public RenderState2D, public juce::AsyncUpdater {
 public:
@@ -38,6 +41,27 @@ public:
       loadChooser("Load Shader", juce::File::getSpecialLocation(juce::File::userDocumentsDirectory), "*.avrs") {
         renderProfile.setPresetName("AI Generator");
 
+        shaderValidator.onVerdict = [this](const ShaderValidator::Verdict& verdict) {
+            // A shader still streaming in is expected to fail until the rest of it arrives.
+            if (verdict.provisional && verdict.outcome == ShaderValidator::SHADER_REJECTED)
+                return;
+            displayStatusError.store(verdict.outcome == ShaderValidator::SHADER_REJECTED);
+            shaderStatus = verdict.reason.upToFirstOccurrenceOf("\n", false, false);
+            };
+
+        // Saves reach the picker once the server has given them an id.
+        syncQueue.onAdded = [this](int localId, int id, const juce::String& name, const juce::String& shader) {
+            juce::ignoreUnused(localId);
+            DBG("Adding new render state id resolved from cloud as: " << id);
+            updateCacheUser();
+            renderStateCache.store({ id, name, shader, {} }, {});
+            fillBackendList();
+            };
+        renderStateCache.onLoaded = [this]() {
+            fillBackendList();
+            };
+        updateCacheUser();
+
         saveEnterTitleText.setText("Enter name:", juce::dontSendNotification);
         saveEnterTitleText.setBorderSize(juce::BorderSize<int>(2));
         saveEnterTitleText.setBounds(6, 147, 125, 125);
@@ -58,26 +82,35 @@ public:
         submit.setButtonText("Click to submit prompt!");
         submit.setBounds(7, 199, 125, 25);
         submit.onClick = [this]() {
-            // If we are already making a prompt submit request, then we should not continue with this one.
-            if (pendingAPIRequest.load())
+            // Pressing again while the shader is still arriving stops it, keeping whatever has compiled so far.
+            if (pendingAPIRequest.load()) {
+                apiClient->cancel(promptRequest);
+                finishPrompt();
                 return;
+            }
             if (!appSettings.isAuth())
                 return;
 
             const juce::String promptText = prompt.getText();
-            // Launch the API request on a seperate thread because it is a blocking operation.
-            juce::Thread::launch([this, promptText]() {
-                pendingAPIRequest.store(true); 
-                juce::String response = postPromptResponse(appSettings.getAuthJWT(), promptText);
+            pendingAPIRequest.store(true);
+            receivedCharacters = 0;
+            lastTriedShader.clear();
+            submit.setButtonText("Click to stop!");
+            promptRequest = postPromptStream(*apiClient, appSettings.getAuthJWT(), promptText, [this](const juce::String& partial) {
+                receivedCharacters = partial.length();
+                // Only a shader whose main() has closed can compile, and each one is only worth trying once.
+                if (partial != lastTriedShader && PromptStream::isCompleteShader(partial)) {
+                    lastTriedShader = partial;
+                    shaderValidator.validate(partial, true);
+                }
+            }, [this](const juce::String& response) {
                 if (response.length() > 0) {
-                    auto* fragShader = new juce::String(response); // The fragShader will be freed once exchanged in the render loop.
-                    pendingFragShader.store(fragShader);
-                    pendingSubmit.store(true);
+                    submitShader(response);
                 } else {
                     DBG("Could not resolve a prompt for the AskAI RenderState!");
                     displayStatusError.store(true);
                 }
-                pendingAPIRequest.store(false);
+                finishPrompt();
             });
         };
         renderProfile.addComponent(&submit);
@@ -92,10 +125,9 @@ public:
                 if (filePath.isEmpty())
                     return;
                 DBG("Loading render state from " << filePath);
+                appSettings.addRecentFile(chooser.getResult());
                 juce::String renderState = getRenderStateFromFile(filePath);
-                auto* fragShader = new juce::String(renderState);
-                pendingFragShader.store(fragShader);
-                pendingSubmit.store(true);
+                submitShader(renderState);
                 });
             };
         renderProfile.addComponent(&loadFromFile);
@@ -114,16 +146,35 @@ public:
             selectBackenedRenderStateText.setVisible(true);
             statusText.setVisible(false);
             submit.setVisible(false);
+            loadFromBackend.setVisible(false);
+            deleteFromBackend.setVisible(true);
             };
         renderProfile.addComponent(&loadFromBackend);
         loadFromBackend.setVisible(false);
 
+        deleteFromBackend.setButtonText("Delete");
+        deleteFromBackend.setBounds(50, 270, 41, 20);
+        deleteFromBackend.setColour(juce::TextButton::ColourIds::buttonColourId, juce::Colours::lightcoral);
+        deleteFromBackend.onClick = [this]() {
+            int id = backenedListComboBox.getSelectedId();
+            if (id == 0)
+                return;
+            // Gone from the picker at once. The delete is sent by the queue, whenever the backend can be reached.
+            updateCacheUser();
+            syncQueue.enqueueDelete(id);
+            renderStateCache.remove(id);
+            fillBackendList();
+            };
+        renderProfile.addComponent(&deleteFromBackend);
+        deleteFromBackend.setVisible(false);
+
         cancelLoad.setButtonText("Cancel");
         cancelLoad.setBounds(94, 270, 41, 20);
         cancelLoad.setColour(juce::TextButton::ColourIds::buttonColourId, juce::Colours::lightcoral);
         cancelLoad.onClick = [this]() {
             loadFromFile.setVisible(false);
             loadFromBackend.setVisible(false);
+            deleteFromBackend.setVisible(false);
             cancelLoad.setVisible(false);
             backenedListComboBox.setVisible(false);
             selectBackenedRenderStateText.setVisible(false);
@@ -211,17 +262,20 @@ public:
             save.setVisible(false);
             load.setVisible(false);
 
-            // Update the list of loaded render states from the backend now while there is opportunity.
-            renderStatesCached.clear();
-            backenedListComboBox.clear();
-            juce::Thread::launch([this]() {
-                std::vector<struct RenderStateStruct> renderStates = getGetAllRenderStates(appSettings.getAuthJWT());
-                juce::MessageManager::callAsync([this, renderStates]() {
-                    for (auto renderState : renderStates) {
-                        backenedListComboBox.addItem(renderState.name, renderState.id);
-                        renderStatesCached.insert({ renderState.id, renderState });
-                    }
-                    });
+            // Show the cached list straight away, then update it from the backend while there is opportunity.
+            updateCacheUser();
+            fillBackendList();
+            apiClient->cancel(listRequest); // A list still loading from an earlier click would be stale.
+            listedRenderStates.clear();
+            listRequest = getListRenderStates(*apiClient, appSettings.getAuthJWT(), [this](std::vector<struct RenderStateStruct> renderStates) {
+                addToBackendList(renderStates);
+                }, [this](int statusCode, bool complete) {
+                if (statusCode == 404) {
+                    loadAllRenderStates();
+                    return;
+                }
+                if (complete) // Otherwise offline or cut short, so the cached list stays.
+                    finishBackendList();
                 });
             };
         renderProfile.addComponent(&load);
@@ -230,13 +284,31 @@ public:
         backenedListComboBox.setTextWhenNothingSelected("...");
         backenedListComboBox.setBounds(8, 240, 125, 25);
         backenedListComboBox.onChange = [this]() {
-            auto rs = renderStatesCached.find(backenedListComboBox.getSelectedId());
-            if (rs != renderStatesCached.end()) {
-                struct RenderStateStruct renderState = rs->second;
-                auto* fragShader = new juce::String(renderState.renderState);
-                pendingFragShader.store(fragShader);
-                pendingSubmit.store(true);
+            int id = backenedListComboBox.getSelectedId();
+            if (id == 0)
+                return;
+            auto submitCached = [this](const juce::String& shader) {
+                submitShader(shader);
+                };
+            updateCacheUser();
+            if (renderStateCache.isCurrent(id) || (listHasBodies && renderStateCache.hasBody(id))) {
+                renderStateCache.loadBody(id, submitCached);
+                return;
             }
+            // Only the body is fetched, and not even that if the cached one still matches its ETag.
+            apiClient->cancel(bodyRequest);
+            bodyRequest = getGetRenderState(*apiClient, appSettings.getAuthJWT(), id, renderStateCache.getETag(id), [this, id, submitCached](int statusCode, struct RenderStateStruct renderState, const juce::String& etag) {
+                if (statusCode == 304) {
+                    renderStateCache.markCurrent(id);
+                    renderStateCache.loadBody(id, submitCached);
+                } else if (renderState.name.isNotEmpty()) {
+                    renderStateCache.store(renderState, etag);
+                    submitShader(renderState.renderState);
+                } else if (renderStateCache.hasBody(id)) {
+                    DBG("Could not fetch render state " << id << ", using the cached copy.");
+                    renderStateCache.loadBody(id, submitCached);
+                }
+                });
             };
         renderProfile.addComponent(&backenedListComboBox);
         backenedListComboBox.setVisible(false);
@@ -245,7 +317,6 @@ public:
         saveNameEditor.setInputRestrictions(20);
         saveNameEditor.setBounds(8, 219, 125, 25);
         saveNameEditor.onReturnKey = [this]() {
-            auto shaderPtr = std::atomic_load(&fragmentShader);
             confirmSaveShaderToBackend();
             saveNameEditor.setVisible(false);
             confirmSave.setVisible(false);
@@ -276,9 +347,16 @@ public:
         renderProfile.addComponent(&prompt);
     }
 
+    ~AskAI() override {
+        apiClient->cancel(promptRequest);
+        apiClient->cancel(listRequest);
+        apiClient->cancel(bodyRequest);
+    }
+
     // Handle updating component entities on the messange thread. You can only update on the messange thread
     // and aquiring a MessageManagerLock on the render loop will block the GL thread until it aquires the lock.
     void handleAsyncUpdate() override {
+        updateCacheUser();
         if (!appSettings.isAuth()) {
             statusText.setColour(juce::Label::textColourId, juce::Colours::red);
             statusText.setText("You must be logged-in in order to use this feature", juce::dontSendNotification);
@@ -286,38 +364,49 @@ public:
         }
         if (pendingAPIRequest.load()) {
             statusText.setColour(juce::Label::textColourId, juce::Colours::green);
-            statusText.setText("Loading new shader...", juce::dontSendNotification);
+            if (receivedCharacters > 0)
+                statusText.setText("Receiving shader...\n" + juce::String(receivedCharacters) + " characters", juce::dontSendNotification);
+            else
+                statusText.setText("Loading new shader...", juce::dontSendNotification);
         } else if (displayStatusError.load()) {
             statusText.setColour(juce::Label::textColourId, juce::Colours::red);
-            statusText.setText("There was an error\nloading the shader!", juce::dontSendNotification);
+            statusText.setText("There was an error\nloading the shader!\n" + shaderStatus, juce::dontSendNotification);
+        } else if (shaderStatus.isNotEmpty()) {
+            // The shader is running, but it may cost the frame rate.
+            statusText.setColour(juce::Label::textColourId, juce::Colours::orange);
+            statusText.setText("Heavy shader!\n" + shaderStatus, juce::dontSendNotification);
+        } else if (syncQueue.getNumUnconfirmed() > 0) {
+            // The shader is still queued, and is sent again if the list shows it wasn't saved.
+            statusText.setColour(juce::Label::textColourId, juce::Colours::orange);
+            statusText.setText("A cloud save may not\nhave been made.\nChecking...", juce::dontSendNotification);
         } else {
             // Display nothing if there is no updates or errors.
             statusText.setText("", juce::dontSendNotification);
         }
     }
 
-    // This method will be called on the OpenGL Thread.
-    void render() override {
-        // Handle new shader compilation here on the GL Thread if the submit button has been pressed.
-        if (pendingSubmit.exchange(false)) {
-            DBG("New submit AI Fragment request is being processed");
-            juce::String* shaderPtr = pendingFragShader.exchange(nullptr);
-            if (shaderPtr) {
-                DBG("New AI Fragment shader is being handled.");
-                initNewFragmentShader(*shaderPtr);
-                delete shaderPtr; // filePtr is created using new
-                displayStatusError.store(false);
-            } else {
-                DBG("New AI Fragment shader failed to init and compile!");
-                displayStatusError.store(true);
-            }
+    // Called on the OpenGL Thread while the context is closing.
+    void shutdown() override {
+        shaderValidator.release();
+        RenderState2D::shutdown();
+    }
+
+    // Called on the OpenGL Thread before the frame uniforms are applied, so a new program draws with them.
+    void prepareFrame() override {
+        // New shaders are compiled and timed by the validator, and only replace the current one once they pass.
+        juce::String validatedShader;
+        auto validatedProgram = shaderValidator.update(vertexShader, [this](GLuint program, const FrameUniforms& uniforms) {
+            applyFrameUniforms(program, uniforms);
+            RenderState2D::render();
+            }, validatedShader);
+        if (validatedProgram != nullptr) {
+            DBG("New AI Fragment shader passed validation.");
+            useShaderProgram(std::move(validatedProgram), validatedShader);
         }
 
         // Handle GUI updates as the state of the statusText is always changing.
         // This render loop is a good opportunity to make updates per frame.
         triggerAsyncUpdate();
-
-        RenderState2D::render();
     }
 
     void delayColourChangeToComponent(juce::TextButton* component, int colourId, juce::Colour colour) {
@@ -330,19 +419,84 @@ public:
             });
     }
 
+    // The prompt request has finished or been stopped.
+    void finishPrompt() {
+        pendingAPIRequest.store(false);
+        promptRequest = 0;
+        submit.setButtonText("Click to submit prompt!");
+    }
+
+    void submitShader(const juce::String& shader) {
+        shaderValidator.validate(shader, false);
+    }
+
+    // The cache belongs to whoever is logged in now. Cheap unless the JWT has changed.
+    void updateCacheUser() {
+        juce::String jwt = appSettings.getAuthJWT();
+        if (jwt == cacheJWT)
+            return;
+        cacheJWT = jwt;
+        // Anything still loading was for the last user.
+        apiClient->cancel(listRequest);
+        apiClient->cancel(bodyRequest);
+        listedRenderStates.clear();
+        renderStateCache.setUser(getJWTSubject(jwt));
+        fillBackendList();
+    }
+
+    // Refills the picker from the cache, keeping the selection if it is still there.
+    void fillBackendList() {
+        int selected = backenedListComboBox.getSelectedId();
+        backenedListComboBox.clear(juce::dontSendNotification);
+        for (auto& entry : renderStateCache.getEntries())
+            backenedListComboBox.addItem(entry.second.name, entry.first);
+        if (backenedListComboBox.indexOfItemId(selected) >= 0)
+            backenedListComboBox.setSelectedId(selected, juce::dontSendNotification);
+    }
+
+    // Adds render states to the picker as they stream in. Ones already shown from the cache are left alone
+    // until the list is finished.
+    void addToBackendList(const std::vector<struct RenderStateStruct>& renderStates) {
+        for (auto& renderState : renderStates) {
+            if (syncQueue.isDeletePending(renderState.id))
+                continue;
+            listedRenderStates.push_back({ renderState.id, renderState.name, {}, renderState.version });
+            if (backenedListComboBox.indexOfItemId(renderState.id) < 0)
+                backenedListComboBox.addItem(renderState.name, renderState.id);
+        }
+    }
+
+    void finishBackendList() {
+        syncQueue.listReceived(listedRenderStates);
+        renderStateCache.setList(listedRenderStates);
+        listedRenderStates.clear();
+        fillBackendList();
+    }
+
+    // For servers without the list endpoint, which send every body in one go. Each batch of bodies goes straight
+    // to the disk cache rather than being held in memory, and selecting one then needs no request.
+    void loadAllRenderStates() {
+        listHasBodies = true;
+        listedRenderStates.clear();
+        listRequest = getGetAllRenderStates(*apiClient, appSettings.getAuthJWT(), [this](std::vector<struct RenderStateStruct> renderStates) {
+            renderStateCache.storeAll(renderStates);
+            addToBackendList(renderStates);
+            }, [this](int statusCode, bool complete) {
+            juce::ignoreUnused(statusCode);
+            if (complete)
+                finishBackendList();
+            });
+    }
+
     void confirmSaveShaderToBackend() {
         auto shaderPtr = std::atomic_load(&fragmentShader);
-        juce::Thread::launch([this, shaderPtr]() {
-            if (shaderPtr) {
-                juce::String name = saveNameEditor.getText();
-                juce::String newRSId = postAddRenderState(appSettings.getAuthJWT(), name, *shaderPtr);
-                DBG("Adding new render state id resolved from cloud as: " << newRSId);
-                juce::MessageManager::callAsync([this, name]() {
-                    saveToBackend.setColour(juce::TextButton::ColourIds::buttonColourId, name.length() == 0 ? juce::Colours::lightcoral : juce::Colours::green);
-                    });
-                delayColourChangeToComponent(&saveToBackend, juce::TextButton::ColourIds::buttonColourId, juce::Colours::lightseagreen);
-            }
-            });
+        if (shaderPtr) {
+            // Queued and written to disk at once, so the save isn't lost if the backend can't be reached.
+            juce::String name = saveNameEditor.getText();
+            syncQueue.enqueueAdd(name, *shaderPtr);
+            saveToBackend.setColour(juce::TextButton::ColourIds::buttonColourId, name.length() == 0 ? juce::Colours::lightcoral : juce::Colours::green);
+            delayColourChangeToComponent(&saveToBackend, juce::TextButton::ColourIds::buttonColourId, juce::Colours::lightseagreen);
+        }
         saveNameEditor.setVisible(false);
         statusText.setVisible(true);
         submit.setVisible(true);
@@ -350,9 +504,15 @@ public:
 
 private:
     ApplicationSettings& appSettings;
+    juce::SharedResourcePointer<APIClient> apiClient;
+    int promptRequest = 0, listRequest = 0, bodyRequest = 0;
+    RenderStateCache renderStateCache;
+    juce::String cacheJWT; // The JWT the cache's user was last taken from.
+    RenderStateSyncQueue syncQueue{ appSettings };
 
     juce::TextButton loadFromFile;
     juce::TextButton loadFromBackend;
+    juce::TextButton deleteFromBackend;
     juce::TextButton cancelLoad;
     juce::ComboBox backenedListComboBox;
 
@@ -369,10 +529,13 @@ private:
     juce::TextEditor prompt;
     juce::FileChooser saveChooser, loadChooser;
 
-    std::atomic<juce::String*> pendingFragShader{ nullptr };
+    ShaderValidator shaderValidator{ openGLContext };
+    juce::String shaderStatus; // Why the last shader was rejected or flagged as heavy.
+    juce::String lastTriedShader;
+    int receivedCharacters = 0;
     std::atomic<bool> pendingAPIRequest{ false };
-    std::atomic<bool> pendingSubmit{ false };
     std::atomic<bool> displayStatusError{ false };
 
-    std::unordered_map<int, struct RenderStateStruct> renderStatesCached;
+    std::vector<struct RenderStateStruct> listedRenderStates; // Ids, names and versions of the list loading now.
+    bool listHasBodies = false; // Set for servers without the list endpoint, whose list holds every body.
 };
\ No newline at end of file
@@ -0,0 +1,247 @@
+/*
+  ==============================================================================
+
+    AsyncFileSink.h
+    Created: 19 Oct 2026 6:10:39am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <deque>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/mem.h>
+}
+
+#define ASYNC_SINK_IO_BUFFER_SIZE 262144
+#define ASYNC_SINK_FLUSH_INTERVAL_MS 1000
+#define ASYNC_SINK_SPARE_BUFFERS 16
+#define ASYNC_SINK_MAX_QUEUED_BYTES 67108864 // 64MB. Only reached if the disk can't keep up with the encoder at all.
+
+/*
+    Writes muxer output to disk on a background thread.
+
+    The muxer writes into an AVIOContext whose callback only copies the bytes into a queue, so the encoding thread
+    never waits on the disk. The writer thread writes the queue out and flushes every open file to disk once per
+    ASYNC_SINK_FLUSH_INTERVAL_MS and when the file is closed. juce::FileOutputStream::flush() syncs the file to
+    disk, which is the call that can stall for a long time.
+
+    The AVIOContexts are not seekable, so this only suits formats that never go back to rewrite data, such as
+    fragmented MP4.
+
+    open() and close() must be called on the thread that runs the muxer.
+*/
+class AsyncFileSink : private juce::Thread {
+public:
+    AsyncFileSink() : juce::Thread("AV Async File Sink") {
+        startThread();
+    }
+
+    ~AsyncFileSink() override {
+        signalThreadShouldExit();
+        notify();
+        stopThread(-1); // Everything that was queued is written before the thread exits.
+    }
+
+    // Opens a file for writing and creates the AVIOContext the muxer writes it through. Returns an AVERROR code.
+    int open(AVIOContext** pb, const juce::String& path) {
+        auto* sinkFile = new SinkFile();
+        sinkFile->owner = this;
+        sinkFile->file = juce::File(path);
+        sinkFile->file.deleteFile();
+        // Creating the file is quick. Opening it here means a bad path is reported to the muxer straight away.
+        sinkFile->stream = std::make_unique<juce::FileOutputStream>(sinkFile->file);
+        if (sinkFile->stream->failedToOpen()) {
+            DBG("Async file sink could not open " << path << "!");
+            delete sinkFile;
+            return AVERROR(EIO);
+        }
+
+        auto* buffer = (unsigned char*) av_malloc(ASYNC_SINK_IO_BUFFER_SIZE);
+        *pb = buffer ? avio_alloc_context(buffer, ASYNC_SINK_IO_BUFFER_SIZE, 1, sinkFile, nullptr, &writePacket, nullptr) : nullptr;
+        if (!*pb) {
+            av_free(buffer);
+            delete sinkFile;
+            return AVERROR(ENOMEM);
+        }
+        DBG("Async file sink opened " << path << ".");
+        return 0;
+    }
+
+    // Pushes out whatever the AVIOContext still holds and frees it. The file is synced and closed on the writer thread.
+    int close(AVIOContext** pb) {
+        if (!*pb)
+            return 0;
+        avio_flush(*pb);
+        int ret = (*pb)->error;
+        auto* sinkFile = (SinkFile*) (*pb)->opaque;
+        av_freep(&(*pb)->buffer);
+        avio_context_free(pb);
+
+        push({ sinkFile, {}, true });
+        return ret < 0 ? ret : (failed.load() ? AVERROR(EIO) : 0);
+    }
+
+    // Routes every file the muxer opens itself, such as the segments of the segment muxer, through this sink.
+    void attach(AVFormatContext* oc) {
+        oc->opaque = this;
+        oc->io_open = &ioOpen;
+        oc->io_close2 = &ioClose;
+    }
+
+    bool hasFailed() {
+        return failed.load();
+    }
+
+private:
+    struct SinkFile {
+        AsyncFileSink* owner;
+        juce::File file;
+        std::unique_ptr<juce::FileOutputStream> stream; // Only used by the writer thread once the file is open.
+        bool dirty = false;
+    };
+
+    struct Command {
+        SinkFile* file;
+        std::vector<uint8_t> data;
+        bool close;
+    };
+
+    juce::CriticalSection queueLock;
+    std::deque<Command> queue;
+    std::atomic<size_t> queuedBytes{ 0 };
+    std::vector<std::vector<uint8_t>> spareBuffers; // Written buffers are reused so the encoding thread rarely allocates.
+    juce::WaitableEvent spaceAvailable;
+    std::atomic<bool> failed{ false };
+
+    std::vector<SinkFile*> openFiles; // Writer thread only.
+
+    static int writePacket(void* opaque, const uint8_t* buf, int size) {
+        auto* sinkFile = (SinkFile*) opaque;
+        AsyncFileSink* sink = sinkFile->owner;
+        if (sink->failed.load())
+            return AVERROR(EIO);
+
+        std::vector<uint8_t> data = sink->takeSpareBuffer();
+        data.assign(buf, buf + size);
+        sink->push({ sinkFile, std::move(data), false });
+        return size;
+    }
+
+    static int ioOpen(AVFormatContext* s, AVIOContext** pb, const char* url, int flags, AVDictionary** options) {
+        if (!(flags & AVIO_FLAG_WRITE)) {
+            DBG("Async file sink can only write files!");
+            return AVERROR(EINVAL);
+        }
+        return ((AsyncFileSink*) s->opaque)->open(pb, juce::String::fromUTF8(url));
+    }
+
+    static int ioClose(AVFormatContext* s, AVIOContext* pb) {
+        return ((AsyncFileSink*) s->opaque)->close(&pb);
+    }
+
+    std::vector<uint8_t> takeSpareBuffer() {
+        const juce::ScopedLock lock(queueLock);
+        if (spareBuffers.empty())
+            return {};
+        std::vector<uint8_t> buffer = std::move(spareBuffers.back());
+        spareBuffers.pop_back();
+        return buffer;
+    }
+
+    void push(Command command) {
+        // Muxer output can't be dropped without corrupting the file, so if the disk is this far behind the
+        // encoder has to wait for it.
+        while (queuedBytes.load() > ASYNC_SINK_MAX_QUEUED_BYTES && !failed.load()) {
+            DBG("Async file sink is " << (juce::int64) queuedBytes.load() << " bytes behind. Waiting for the disk.");
+            spaceAvailable.wait(100);
+        }
+        bool isClose = command.close;
+        queuedBytes += command.data.size();
+        {
+            const juce::ScopedLock lock(queueLock);
+            queue.push_back(std::move(command));
+        }
+        if (isClose)
+            notify();
+    }
+
+    void run() override {
+        juce::uint32 lastFlush = juce::Time::getMillisecondCounter();
+        while (true) {
+            bool exiting = threadShouldExit();
+            processQueue();
+
+            if (juce::Time::getMillisecondCounter() - lastFlush >= ASYNC_SINK_FLUSH_INTERVAL_MS) {
+                for (SinkFile* sinkFile : openFiles) {
+                    if (sinkFile->dirty) {
+                        sinkFile->stream->flush();
+                        sinkFile->dirty = false;
+                    }
+                }
+                lastFlush = juce::Time::getMillisecondCounter();
+            }
+
+            if (exiting)
+                break;
+            wait(ASYNC_SINK_FLUSH_INTERVAL_MS / 4);
+        }
+
+        // Files the muxer never closed still get everything that was written to them.
+        for (SinkFile* sinkFile : openFiles)
+            delete sinkFile;
+        openFiles.clear();
+    }
+
+    void processQueue() {
+        while (true) {
+            Command command;
+            {
+                const juce::ScopedLock lock(queueLock);
+                if (queue.empty())
+                    return;
+                command = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            SinkFile* sinkFile = command.file;
+            if (std::find(openFiles.begin(), openFiles.end(), sinkFile) == openFiles.end())
+                openFiles.push_back(sinkFile);
+
+            if (command.close) {
+                sinkFile->stream->flush();
+                if (sinkFile->stream->getStatus().failed())
+                    setFailed(sinkFile);
+                DBG("Async file sink closed " << sinkFile->file.getFullPathName() << ".");
+                openFiles.erase(std::find(openFiles.begin(), openFiles.end(), sinkFile));
+                delete sinkFile;
+                continue;
+            }
+
+            if (!sinkFile->stream->write(command.data.data(), command.data.size()))
+                setFailed(sinkFile);
+            sinkFile->dirty = true;
+
+            queuedBytes -= command.data.size();
+            spaceAvailable.signal();
+            command.data.clear();
+            const juce::ScopedLock lock(queueLock);
+            if (spareBuffers.size() < ASYNC_SINK_SPARE_BUFFERS)
+                spareBuffers.push_back(std::move(command.data));
+        }
+    }
+
+    void setFailed(SinkFile* sinkFile) {
+        DBG("Async file sink failed to write " << sinkFile->file.getFullPathName() << ": " << sinkFile->stream->getStatus().getErrorMessage());
+        failed.store(true);
+        spaceAvailable.signal();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AsyncFileSink)
+};
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    AudioFrameClock.h
+    Created: 19 Oct 2026 6:02:10am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// If the GL thread stalls for longer than this many frames, the missing frames are not
+// duplicated. The next frame is written with a timestamp that jumps forward instead.
+#define MAX_DUPLICATE_FRAMES 4
+
+#define MAX_RECORDING_LENGTH 1200000 // Milliseconds of audio a recording may last.
+
+/*
+    Decides which video frames should be written based on the audio sample position
+    rather than the wall clock.
+
+    Frame n of the video covers the audio between samples n * sampleRate / fps and
+    (n + 1) * sampleRate / fps. Every time the GL thread has a new frame ready, the clock
+    is asked how many frames are owed up to the current audio position. The frame index is
+    always computed from the total number of samples elapsed, so rounding error can never
+    accumulate over a long recording.
+*/
+class AudioFrameClock {
+public:
+    struct FrameDecision {
+        juce::int64 pts;    // Timestamp of the first frame to write.
+        int count;          // 0 = drop this frame, 1 = write it once, > 1 = duplicate it.
+        juce::int64 skipped; // Frames that were neither written nor duplicated because of a long stall.
+    };
+
+    void reset(juce::int64 startSamplePosition, double newSampleRate, int newFrameRate) {
+        startSample = startSamplePosition;
+        sampleRate = newSampleRate > 0 ? newSampleRate : 44100.0;
+        frameRate = newFrameRate;
+        nextFrame = 0;
+    }
+
+    // The index of the frame that covers the given audio sample position.
+    juce::int64 getFrameIndexForSample(juce::int64 samplePosition) const {
+        juce::int64 elapsed = samplePosition - startSample;
+        if (elapsed < 0)
+            return -1;
+        return (juce::int64) std::floor((double) elapsed * frameRate / sampleRate);
+    }
+
+    FrameDecision getFramesDue(juce::int64 samplePosition) {
+        juce::int64 target = getFrameIndexForSample(samplePosition);
+        if (target < nextFrame) // The audio clock has not moved into a new frame yet.
+            return { nextFrame, 0, 0 };
+
+        juce::int64 due = target - nextFrame + 1;
+        if (due > MAX_DUPLICATE_FRAMES) {
+            // Too far behind to fill the gap, so jump straight to the current frame.
+            FrameDecision decision{ target, 1, due - 1 };
+            nextFrame = target + 1;
+            return decision;
+        }
+
+        FrameDecision decision{ nextFrame, (int) due, 0 };
+        nextFrame += due;
+        return decision;
+    }
+
+    // The number of frames written or skipped so far. Used to measure the length of the recording.
+    juce::int64 getFramesElapsed() const {
+        return nextFrame;
+    }
+
+    int getFrameRate() const {
+        return frameRate;
+    }
+
+private:
+    juce::int64 startSample = 0;
+    double sampleRate = 44100.0;
+    int frameRate = 60;
+    juce::int64 nextFrame = 0;
+};
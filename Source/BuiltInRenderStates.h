@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    BuiltInRenderStates.h
+    Created: 19 Oct 2026 7:20:21am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "Classic1_2D.h"
+#include "Classic2_2D.h"
+#include "Classic3_2D.h"
+#include "Classic4_2D.h"
+#include "SDF_1_2D.h"
+#include "TimeDomain1_2D.h"
+#include "TimeDomain2_2D.h"
+#include "TimeDomain3_2D.h"
+#include "PresetParameters.h"
+
+// The vertex shader shared by every 2D render state. A single quad covering the screen.
+#define DEFAULT_VERTEX_SHADER_2D R"(
+    #version 330 core
+    layout(location = 0) in vec4 position;
+
+    void main() {
+        gl_Position = position;
+    }
+)"
+
+/*
+    Creates one of the built in render states by its preset id. The ids are the ones shown in the preset selector.
+    AskAI is not included because it needs the application settings to talk to the backend.
+*/
+inline std::unique_ptr<RenderState> createBuiltInRenderState(int id, juce::OpenGLContext& context) {
+    switch (id) {
+    case 1: return std::make_unique<Classic1_2D>(id, context);
+    case 2: return std::make_unique<Classic2_2D>(id, context);
+    case 3: return std::make_unique<Classic3_2D>(id, context);
+    case 4: return std::make_unique<Classic4_2D>(id, context);
+    case 5: return std::make_unique<TimeDomain1_2D>(id, context);
+    case 6: return std::make_unique<TimeDomain2_2D>(id, context);
+    case 7: return std::make_unique<TimeDomain3_2D>(id, context);
+    case 8: return std::make_unique<SDF_1_2D>(id, context);
+    default: return nullptr;
+    }
+}
+
+// Creates a render state from a fragment shader, such as one saved to an .avrs file by AskAI.
+inline std::unique_ptr<RenderState> createShaderRenderState(int id, juce::OpenGLContext& context, const juce::String& fragmentShader) {
+    return std::make_unique<RenderState2D>(id, context, juce::String(DEFAULT_VERTEX_SHADER_2D), fragmentShader);
+}
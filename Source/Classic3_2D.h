@@ -12,6 +12,7 @@
 
 #include <JuceHeader.h>
 #include "RenderState2D.h"
+#include "PresetParameters.h"
 
 class Classic3_2D : public RenderState2D {
 public:
@@ -51,26 +52,7 @@ public:
             color = vec3((sin(time / 100.0f) + 1.0f) / 2.0f, normDist, 1.0 - normDist);
         outColour = vec4(color, 1.0);
     }
-)")) {
-        button.setBounds(0, 0, 25, 25);
-        button.onClick = [this]() {
-            setMode((mode + 1) % 3);
-        };
-        renderProfile.addComponent(&button);
+)"), getBuiltInParameterSpecs(id)) {
         renderProfile.setPresetName("Classic3");
     }
-
-void render() override {
-        GLuint modeUniform = openGLContext.extensions.glGetUniformLocation(getShaderProgramID(), "mode");
-        openGLContext.extensions.glUniform1i(modeUniform, mode.load());
-        RenderState2D::render();
- }
-
-void setMode(int m) {
-    mode.store(m);
-}
-
-private:
-    std::atomic<unsigned int> mode{ 0 };
-    juce::ToggleButton button;
 };
\ No newline at end of file
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    ClientRegistry.h
+    Created: 19 Oct 2026 6:34:27am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+/*
+    Per-client state for a fixed number of clients, kept in slots that are reused as clients come and go.
+
+    State must have a reset() that returns it to its initial state. reset() should keep any buffers it owns
+    rather than freeing them, so that once every slot has been used the registry stops allocating however many
+    clients connect and disconnect. Lookups are a linear scan, which is cheaper than hashing at these sizes.
+
+    Not thread safe. Each registry belongs to the thread that serves its clients.
+*/
+template <typename State>
+class ClientRegistry {
+public:
+    explicit ClientRegistry(int capacity) : slots((size_t) capacity) {}
+
+    // Returns the state for a client, taking a free slot the first time it is seen. nullptr if every slot is taken.
+    State* acquire(int clientId) {
+        Slot* freeSlot = nullptr;
+        for (auto& slot : slots) {
+            if (slot.clientId == clientId)
+                return &slot.state;
+            if (freeSlot == nullptr && slot.clientId == FREE_SLOT)
+                freeSlot = &slot;
+        }
+        if (freeSlot == nullptr)
+            return nullptr;
+        freeSlot->clientId = clientId;
+        return &freeSlot->state;
+    }
+
+    void release(int clientId) {
+        for (auto& slot : slots) {
+            if (slot.clientId == clientId) {
+                slot.state.reset();
+                slot.clientId = FREE_SLOT;
+                return;
+            }
+        }
+    }
+
+private:
+    static constexpr int FREE_SLOT = 0; // SocketReactor client ids start at 1.
+
+    struct Slot {
+        int clientId = FREE_SLOT;
+        State state;
+    };
+    std::vector<Slot> slots;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ClientRegistry)
+};
@@ -15,6 +15,7 @@
 #include <stdio.h>
 #include "StrHelper.h"
 #include "VideoEncoder.h"
+#include "Settings.h"
 
 #define UPLOAD_NO_STATE 0
 #define UPLOAD_SUBMITTED 1
@@ -24,11 +25,13 @@
 // 600 x 300
 class ContentComponent : public juce::Component, private juce::Timer {
 public:
-	ContentComponent(OpenGLComponent& openGLComponent) : glComponent(openGLComponent) {
+	ContentComponent(OpenGLComponent& openGLComponent, ApplicationSettings& appSettings) : glComponent(openGLComponent), appSettings(appSettings) {
 		addAndMakeVisible(startButton);
 		addAndMakeVisible(finishButton);
 		addAndMakeVisible(fileNameEditor);
 		addAndMakeVisible(pathNameButton);
+		addAndMakeVisible(renderFileButton);
+		addAndMakeVisible(goLiveButton);
 
 		// Youtube UI logic
 		addAndMakeVisible(uploadVideoButton);
@@ -51,10 +54,9 @@ public:
 			juce::File outputFile(pathNameButton.getButtonText());
 			outputFile = outputFile.getChildFile(fileNameEditor.getText());
 
-			auto* str = new juce::String(outputFile.getFullPathName());
-			glComponent.pendingEncoderFileName.store(str);
+			auto* request = new RecordingRequest{ outputFile.getFullPathName(), getRecordingOptions(), getPreviewOutput(outputFile), getPreviewOptions() };
+			glComponent.pendingRecording.store(request);
 
-			recordingStartTime = juce::Time::getMillisecondCounter();
 			startTimerHz(1);
 
 			state = true;
@@ -66,6 +68,52 @@ public:
 
 		};
 
+		renderFileButton.setBounds(50, 70, 100, 30);
+		renderFileButton.onClick = [this] {
+			if (!glComponent.getVideoEncoder() || state)
+				return;
+			if (!filePathFound || !fileNameFound)
+				return;
+			auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+			audioSelector.launchAsync(flags, [this](const juce::FileChooser& chooser) {
+				juce::File audioFile = chooser.getResult();
+				if (!audioFile.existsAsFile())
+					return;
+				juce::File outputFile(pathNameButton.getButtonText());
+				outputFile = outputFile.getChildFile(fileNameEditor.getText());
+
+					auto* request = new OfflineRenderRequest{ audioFile, outputFile.getFullPathName(), getRecordingOptions() };
+				glComponent.pendingOfflineRender.store(request);
+
+				startTimerHz(1);
+				state = true;
+				offlineRender = true;
+				showYoutubeButtons(false);
+				repaint();
+				});
+		};
+
+		goLiveButton.setBounds(50, 120, 100, 30);
+		goLiveButton.onClick = [this] {
+			if (!glComponent.getVideoEncoder() || state)
+				return;
+			// The stream URL is validated by the settings, so an empty one means it was never set.
+			if (appSettings.getStreamUrl().isEmpty()) {
+				elapsedTimeString = "Set a stream URL in the settings!";
+				repaint();
+				return;
+			}
+
+			auto* request = new RecordingRequest{ appSettings.getStreamUrl(), getRecordingOptions() };
+			glComponent.pendingRecording.store(request);
+
+			startTimerHz(1);
+			state = true;
+			liveStream = true;
+			showYoutubeButtons(false);
+			repaint();
+		};
+
 		finishButton.setBounds(450, 20, 100, 30);
 		finishButton.onClick = [this] {
 			if (!state) // if we aren't already running, then we won't need to do any of this logic.
@@ -76,6 +124,14 @@ public:
 			elapsedTimeString = "00:00";
 
 			state = false;
+			offlineRender = false;
+
+			// A live stream leaves no file behind to upload.
+			if (liveStream) {
+				liveStream = false;
+				repaint();
+				return;
+			}
 
 			// Now that the video has finished, we can prompt the user to upload the video to youtube.
 			uploadVideoButton.setVisible(true);
@@ -150,6 +206,14 @@ public:
 		g.drawSingleLineText("File Name:", 160, 90, juce::Justification(0));
 		g.drawSingleLineText("Output Path:", 160, 140, juce::Justification(0));
 		g.drawSingleLineText(elapsedTimeString, 310, 42, juce::Justification(0));
+		if (state && !offlineRender) {
+			g.drawSingleLineText(statsString, 160, 175, juce::Justification(0));
+			if (errorString.isNotEmpty()) {
+				g.setColour(juce::Colours::yellow);
+				g.drawSingleLineText("Error: " + errorString, 160, 195, juce::Justification(0));
+				g.setColour(juce::Colours::black);
+			}
+		}
 		if (isPublicButton.isVisible()) // Only draw if the button it is describing is actually visible
 			g.drawSingleLineText("Private:", 100, 260, juce::Justification(0));
 		if (uploadingState.load() != UPLOAD_NO_STATE) // If there is an uploading state that is not the idle state, then we should display it as a message.
@@ -160,10 +224,39 @@ public:
 		// We need to know if at any point the timer should be stopped because the video recording 
 		// was cancelled due to other reasons. Also, if the timer has reached above the maximum
 		// defined allowable recording time limit, then we should force a cancel now in the timer loop.
+		if (offlineRender) {
+			// Offline renders are not limited in length. Show how far through the audio file the render is instead.
+			if (glComponent.isOfflineRendering()) {
+				elapsedTimeString = juce::String(juce::roundToInt(glComponent.getOfflineRenderProgress() * 100.0)) + "%";
+				repaint();
+			} else {
+				finishButton.onClick();
+			}
+			return;
+		}
+
 		bool recordingShouldContinue = glComponent.getVideoEncoder()->isActive();
 
-		auto now = juce::Time::getMillisecondCounter();
-		auto elapsedMs = now - recordingStartTime;
+		const EncoderStats& stats = glComponent.getVideoEncoder()->getStats();
+		statsString = stats.getSummary();
+		errorString = stats.getLastErrorString();
+
+		if (liveStream) {
+			// Streams are not limited in length. The encoder keeps running while the stream output reconnects.
+			if (!recordingShouldContinue) {
+				finishButton.onClick();
+				return;
+			}
+			int totalSeconds = static_cast<int>(glComponent.getVideoEncoder()->getRecordedMilliseconds() / 1000);
+			elapsedTimeString = juce::String(totalSeconds / 60).paddedLeft('0', 2) + ":" + juce::String(totalSeconds % 60).paddedLeft('0', 2)
+				+ (glComponent.getVideoEncoder()->isStreamConnected() ? " LIVE" : " CONNECTING");
+			repaint();
+			return;
+		}
+
+		// The elapsed time is taken from the encoder, which counts frames against the audio clock, so the limit
+		// is applied to the length of the exported video rather than how long the window has been open.
+		auto elapsedMs = glComponent.getVideoEncoder()->getRecordedMilliseconds();
 
 		if (elapsedMs < MAX_RECORDING_LENGTH && recordingShouldContinue) {
 			// Keep recording because we have not passed the time limit.
@@ -190,21 +283,25 @@ public:
 
 private:
 	OpenGLComponent& glComponent;
+	ApplicationSettings& appSettings;
 
-	bool state = false, filePathFound = false, fileNameFound = false;
+	bool state = false, filePathFound = false, fileNameFound = false, offlineRender = false, liveStream = false;
 	std::atomic<int> uploadingState{ 0 }; // The status of trying to upload to youtube.
 	
 	// Recording Buttons
 	juce::TextButton startButton{ "Start" };
 	juce::TextButton finishButton{ "Finish" };
+	juce::TextButton renderFileButton{ "Render File" };
+	juce::TextButton goLiveButton{ "Go Live" };
 
 	// Path Buttons
 	juce::FileChooser pathSelector{ "Please select the directory you want to export to...", juce::File::getSpecialLocation(juce::File::userHomeDirectory), "*.mp4" };
+	juce::FileChooser audioSelector{ "Please select the audio file to render...", juce::File::getSpecialLocation(juce::File::userDesktopDirectory), "*.wav;*.mp3;*.aiff" };
 	juce::TextEditor fileNameEditor{ "TypeFileName" };
 	juce::TextButton pathNameButton{ "No Path Selected!" };
 
-	juce::int64 recordingStartTime = 0;
 	juce::String elapsedTimeString = "00:00";
+	juce::String statsString = "", errorString = "";
 
 	// Video Upload Buttons
 	juce::TextButton uploadVideoButton{ "Upload Video to Youtube" };
@@ -214,6 +311,35 @@ private:
 	juce::TextButton submitButton{ "Confirm Upload" };
 	juce::TextButton cancelButton{ "Cancel Upload" };
 
+	VideoEncoder::RecordingOptions getRecordingOptions() {
+		VideoEncoder::RecordingOptions options;
+		options.container = (VideoEncoder::ContainerMode) appSettings.getRecordingMode();
+		options.segmentSeconds = appSettings.getSegmentSeconds();
+		options.profile = appSettings.getEncoderProfile();
+		return options;
+	}
+
+	// Empty if no preview is wanted, or the preview goes to a stream and no stream URL has been set.
+	juce::String getPreviewOutput(const juce::File& outputFile) {
+		switch (appSettings.getPreviewOutput()) {
+		case PREVIEW_OUTPUT_FILE:
+			return outputFile.getSiblingFile(outputFile.getFileNameWithoutExtension() + "_preview.mp4").getFullPathName();
+		case PREVIEW_OUTPUT_STREAM:
+			return appSettings.getStreamUrl();
+		default:
+			return "";
+		}
+	}
+
+	// The preview is for watching, not keeping, so it is always encoded as cheaply as possible.
+	VideoEncoder::RecordingOptions getPreviewOptions() {
+		VideoEncoder::RecordingOptions options;
+		options.container = VideoEncoder::ContainerMode::fragmentedMp4;
+		options.profile = EncoderProfile::getProfile(ENCODER_PROFILE_LOW_LATENCY);
+		options.profile.bitRateKbps = 2000; // A ninth of the pixels of the recording.
+		return options;
+	}
+
 	juce::String getYTUploadStatusMessage(int youtubeUploadStatus) {
 		if (youtubeUploadStatus == UPLOAD_FAILED) {
 			return "FAILED";
@@ -230,10 +356,10 @@ private:
 
 class CreateVideoComponent : public juce::DocumentWindow {
 public:
-	CreateVideoComponent(OpenGLComponent& openGLComponent) : DocumentWindow("recorder!", juce::Colours::white, 5), openGLComponent(openGLComponent) {
+	CreateVideoComponent(OpenGLComponent& openGLComponent, ApplicationSettings& appSettings) : DocumentWindow("recorder!", juce::Colours::white, 5), openGLComponent(openGLComponent) {
 		setUsingNativeTitleBar(true);
 
-		setContentOwned(new ContentComponent(openGLComponent), true);
+		setContentOwned(new ContentComponent(openGLComponent, appSettings), true);
 	}
 
 	void closeButtonPressed() override {
@@ -0,0 +1,235 @@
+/*
+  ==============================================================================
+
+    CueProtocol.h
+    Created: 19 Oct 2026 6:24:27am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+    The binary cue protocol. Every frame is a 12 byte header followed by its payload, all little endian:
+
+        u8  magic       CUE_PROTOCOL_MAGIC. Text clients start with a digit, so the first byte tells the two apart.
+        u8  type        CUE_FRAME_CUE, CUE_FRAME_BATCH or CUE_FRAME_ACK.
+        u16 flags       CUE_FLAG_ACK asks for an ack once the cues have run. CUE_FLAG_AT_SAMPLE or
+                        CUE_FLAG_AT_TIME schedule the cues, see CueScheduler.h.
+        u32 length      Payload length in bytes.
+        u32 sequence    Chosen by the client and echoed back in the ack.
+
+    A scheduled frame's payload starts with its u64 target time. The rest is read as usual, and the ack is sent
+    once the cues are scheduled rather than once they have run.
+
+    A CUE payload is one cue record. A BATCH payload is a u16 count and 2 reserved bytes, followed by that many
+    cue records. The cues of a batch run together, in order, on the message thread.
+
+        u16 cue id      One of the SOCKET_CUE ids.
+        u8  value type  CUE_VALUE_NONE, CUE_VALUE_INT (i32), CUE_VALUE_FLOAT (f32) or CUE_VALUE_STRING (UTF-8).
+        u8  reserved
+        u32 value length
+        ... value
+
+    An ACK payload, sent by the server, is a u8 status, 3 reserved bytes and a u32 count of cues that were
+    accepted. For queries, the reply follows. A malformed frame is acked with CUE_ACK_MALFORMED and the connection
+    is closed, since there is no way to find the next frame.
+
+    A FEATURES payload is pushed by the server to clients that sent SOCKET_CUE_SUBSCRIBE_FEATURES. Its sequence
+    counts up, so a client can tell how many it missed while it was slow.
+
+        u64 sample position
+        u16 preset      The selected render state.
+        u8  events      CUE_FEATURE_ONSET if an onset was detected since the last frame, CUE_FEATURE_PLAYING
+                        while the transport is playing.
+        u8  band count
+        f32 left RMS
+        f32 right RMS
+        f32 ...         One energy per band, lowest first.
+
+    Frames are parsed in place in the client's receive buffer. CueFrame and CueRecord point into it, so they are
+    only valid until the buffer is next changed.
+*/
+
+// Cue ids, shared by the text, binary and OSC protocols.
+#define SOCKET_CUE_PLAY 0
+#define SOCKET_CUE_STOP 1
+#define SOCKET_CUE_RENDER_STATE_INCREMENT 2
+#define SOCKET_CUE_RENDER_STATE_DECREMENT 3
+#define SOCKET_CUE_ENCODER_STATS 4 // Replies with the recording's EncoderStats as a line of JSON.
+#define SOCKET_CUE_CLOCK 5 // Replies with the audio sample position, sample rate and wall clock, for scheduling.
+#define SOCKET_CUE_SUBSCRIBE_FEATURES 6 // A body of 1 subscribes the client to audio features, 0 unsubscribes.
+
+#define CUE_PROTOCOL_MAGIC 0xA7
+#define CUE_PROTOCOL_HEADER_SIZE 12
+#define CUE_PROTOCOL_MAX_PAYLOAD 65536
+#define CUE_RECORD_HEADER_SIZE 8
+#define CUE_FEATURES_HEADER_SIZE 20
+
+#define CUE_FRAME_CUE 1
+#define CUE_FRAME_BATCH 2
+#define CUE_FRAME_ACK 3
+#define CUE_FRAME_FEATURES 4
+
+#define CUE_FLAG_ACK 0x0001
+#define CUE_FLAG_AT_SAMPLE 0x0002 // The payload starts with a u64 audio sample position to run the cues at.
+#define CUE_FLAG_AT_TIME 0x0004 // The payload starts with a u64 wall clock time in Unix milliseconds.
+
+#define CUE_CLOCK_SAMPLE 0 // An audio sample position, as returned by getAudioSamplePosition().
+#define CUE_CLOCK_WALL 1 // A wall clock time in Unix milliseconds.
+
+#define CUE_VALUE_NONE 0
+#define CUE_VALUE_INT 1
+#define CUE_VALUE_FLOAT 2
+#define CUE_VALUE_STRING 3
+
+#define CUE_ACK_OK 0
+#define CUE_ACK_UNKNOWN_CUE 1 // At least one cue was not recognised. The others still ran.
+#define CUE_ACK_MALFORMED 2
+
+#define CUE_FEATURE_ONSET 0x01
+#define CUE_FEATURE_PLAYING 0x02
+
+struct CueRecord {
+    int cueId;
+    int valueType;
+    const char* value;
+    juce::uint32 valueLength;
+
+    juce::var getValue() const {
+        switch (valueType) {
+        case CUE_VALUE_INT:
+            return (int) juce::ByteOrder::littleEndianInt(value);
+        case CUE_VALUE_FLOAT: {
+            juce::uint32 bits = juce::ByteOrder::littleEndianInt(value);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+        case CUE_VALUE_STRING:
+            return juce::String::fromUTF8(value, (int) valueLength);
+        default:
+            return juce::var();
+        }
+    }
+};
+
+struct CueFrame {
+    int type;
+    int flags;
+    juce::uint32 sequence;
+    const char* payload;
+    juce::uint32 length;
+    bool scheduled;
+    int clock; // CUE_CLOCK_SAMPLE or CUE_CLOCK_WALL, if scheduled.
+    juce::int64 target;
+};
+
+namespace CueProtocol {
+    // Returns the size of the frame at data, 0 if it hasn't all arrived yet, or -1 if it is malformed.
+    inline int parseFrame(const char* data, size_t available, CueFrame& frame) {
+        if (available < CUE_PROTOCOL_HEADER_SIZE)
+            return 0;
+        if ((juce::uint8) data[0] != CUE_PROTOCOL_MAGIC)
+            return -1;
+        frame.type = (juce::uint8) data[1];
+        frame.flags = juce::ByteOrder::littleEndianShort(data + 2);
+        frame.length = juce::ByteOrder::littleEndianInt(data + 4);
+        frame.sequence = juce::ByteOrder::littleEndianInt(data + 8);
+        if (frame.length > CUE_PROTOCOL_MAX_PAYLOAD || (frame.type != CUE_FRAME_CUE && frame.type != CUE_FRAME_BATCH))
+            return -1;
+        if (available < CUE_PROTOCOL_HEADER_SIZE + frame.length)
+            return 0;
+        frame.payload = data + CUE_PROTOCOL_HEADER_SIZE;
+        int frameSize = (int) (CUE_PROTOCOL_HEADER_SIZE + frame.length);
+
+        bool atSample = (frame.flags & CUE_FLAG_AT_SAMPLE) != 0, atTime = (frame.flags & CUE_FLAG_AT_TIME) != 0;
+        frame.scheduled = atSample || atTime;
+        frame.clock = atTime ? CUE_CLOCK_WALL : CUE_CLOCK_SAMPLE;
+        frame.target = 0;
+        if (frame.scheduled) {
+            if ((atSample && atTime) || frame.length < 8)
+                return -1;
+            frame.target = (juce::int64) juce::ByteOrder::littleEndianInt64(frame.payload);
+            frame.payload += 8;
+            frame.length -= 8;
+        }
+        return frameSize;
+    }
+
+    // Reads the record at offset and moves offset past it. Returns false if the record runs past the end.
+    inline bool readRecord(const CueFrame& frame, juce::uint32& offset, CueRecord& record) {
+        if (frame.length - offset < CUE_RECORD_HEADER_SIZE)
+            return false;
+        const char* data = frame.payload + offset;
+        record.cueId = juce::ByteOrder::littleEndianShort(data);
+        record.valueType = (juce::uint8) data[2];
+        record.valueLength = juce::ByteOrder::littleEndianInt(data + 4);
+        if (record.valueLength > frame.length - offset - CUE_RECORD_HEADER_SIZE)
+            return false;
+        if ((record.valueType == CUE_VALUE_INT || record.valueType == CUE_VALUE_FLOAT) && record.valueLength != 4)
+            return false;
+        record.value = data + CUE_RECORD_HEADER_SIZE;
+        offset += CUE_RECORD_HEADER_SIZE + record.valueLength;
+        return true;
+    }
+
+    // Calls fn for every cue in a CUE or BATCH frame. Returns false if the frame is malformed, in which case fn
+    // has not been called at all.
+    template <typename Fn>
+    bool forEachCue(const CueFrame& frame, Fn&& fn) {
+        juce::uint32 offset = 0;
+        int count = 1;
+        if (frame.type == CUE_FRAME_BATCH) {
+            if (frame.length < 4)
+                return false;
+            count = juce::ByteOrder::littleEndianShort(frame.payload);
+            offset = 4;
+        }
+        // Validate the whole frame first so that a bad batch never runs halfway.
+        juce::uint32 start = offset;
+        CueRecord record;
+        for (int i = 0; i < count; i++) {
+            if (!readRecord(frame, offset, record))
+                return false;
+        }
+        if (offset != frame.length)
+            return false;
+        offset = start;
+        for (int i = 0; i < count; i++) {
+            readRecord(frame, offset, record);
+            fn(record);
+        }
+        return true;
+    }
+
+    template <typename Type>
+    void writeLittleEndian(Type value, juce::uint8* destination) {
+        value = juce::ByteOrder::swapIfBigEndian(value);
+        memcpy(destination, &value, sizeof(value));
+    }
+
+    inline void writeLittleEndianFloat(float value, juce::uint8* destination) {
+        juce::uint32 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        writeLittleEndian(bits, destination);
+    }
+
+    inline juce::MemoryBlock makeAck(juce::uint32 sequence, int status, int accepted, const juce::String& reply = {}) {
+        juce::uint32 length = 8 + (juce::uint32) reply.getNumBytesAsUTF8();
+        juce::MemoryBlock ack(CUE_PROTOCOL_HEADER_SIZE + length, true);
+        auto* data = (juce::uint8*) ack.getData();
+        data[0] = CUE_PROTOCOL_MAGIC;
+        data[1] = CUE_FRAME_ACK;
+        writeLittleEndian<juce::uint16>(0, data + 2);
+        writeLittleEndian<juce::uint32>(length, data + 4);
+        writeLittleEndian<juce::uint32>(sequence, data + 8);
+        data[12] = (juce::uint8) status;
+        writeLittleEndian<juce::uint32>((juce::uint32) accepted, data + 16);
+        memcpy(data + 20, reply.toRawUTF8(), reply.getNumBytesAsUTF8());
+        return ack;
+    }
+}
@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    CueScheduler.h
+    Created: 19 Oct 2026 6:28:02am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+
+#include "CueProtocol.h"
+
+#define CUE_SCHEDULER_CAPACITY 256
+#define CUE_SCHEDULER_MAX_PARAM_LENGTH 64
+#define CUE_SCHEDULER_MAX_STRING_LENGTH 128 // In bytes of UTF-8, including the terminator.
+
+#define CUE_PARAM -1 // Not a SOCKET_CUE id. The cue sets a parameter of the selected render state.
+
+// A cue waiting for its time. Fixed size so that scheduling never allocates.
+struct ScheduledCue {
+    int cueId = 0;
+    char param[CUE_SCHEDULER_MAX_PARAM_LENGTH] = {};
+    int valueType = CUE_VALUE_NONE; // CUE_VALUE_NONE, CUE_VALUE_INT, CUE_VALUE_FLOAT or CUE_VALUE_STRING.
+    int intValue = 0;
+    float floatValue = 0.0f;
+    char stringValue[CUE_SCHEDULER_MAX_STRING_LENGTH] = {};
+    int clock = CUE_CLOCK_SAMPLE;
+    juce::int64 target = 0;
+    juce::uint64 ticket = 0; // Submission order, so cues with the same target run in the order they were sent.
+
+    juce::var getValue() const {
+        if (valueType == CUE_VALUE_INT)
+            return intValue;
+        if (valueType == CUE_VALUE_FLOAT)
+            return floatValue;
+        if (valueType == CUE_VALUE_STRING)
+            return juce::String::fromUTF8(stringValue);
+        return juce::var();
+    }
+
+    // Fills the value from a var. Returns false for values that can't be scheduled, such as arrays or strings
+    // longer than CUE_SCHEDULER_MAX_STRING_LENGTH.
+    bool setValue(const juce::var& value) {
+        if (value.isVoid()) {
+            valueType = CUE_VALUE_NONE;
+        } else if (value.isInt() || value.isInt64() || value.isBool()) {
+            valueType = CUE_VALUE_INT;
+            intValue = (int) value;
+        } else if (value.isDouble()) {
+            valueType = CUE_VALUE_FLOAT;
+            floatValue = (float) value;
+        } else if (value.isString()) {
+            juce::String text = value.toString();
+            size_t length = text.getNumBytesAsUTF8();
+            if (length >= CUE_SCHEDULER_MAX_STRING_LENGTH) {
+                DBG("Cue scheduler can't hold a " << (int) length << " byte string.");
+                return false;
+            }
+            valueType = CUE_VALUE_STRING;
+            memcpy(stringValue, text.toRawUTF8(), length + 1);
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+/*
+    Holds cues until an audio sample position or wall clock time, so that they land on exactly the frame they
+    were meant for instead of whenever the message thread gets to them.
+
+    Any thread may schedule. Each cue is written into a free slot that is claimed with a compare and swap, then
+    published. The GL thread calls runDueCues() once per frame, which moves published slots into a heap per
+    clock and runs every cue whose time has come. The heaps are only touched by the GL thread, so neither side
+    ever locks or allocates.
+*/
+class CueScheduler {
+public:
+    // Thread safe. Returns false if every slot is taken.
+    bool schedule(ScheduledCue cue) {
+        cue.ticket = nextTicket.fetch_add(1, std::memory_order_relaxed);
+        for (auto& slot : slots) {
+            int expected = SLOT_FREE;
+            if (!slot.state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acquire))
+                continue;
+            slot.cue = cue;
+            slot.state.store(SLOT_READY, std::memory_order_release);
+            return true;
+        }
+        DBG("Cue scheduler is full. Dropping cue " << cue.cueId << ".");
+        return false;
+    }
+
+    // Called on the GL thread before the frame is rendered. fn is called for every due cue, in time order.
+    template <typename Fn>
+    void runDueCues(juce::int64 samplePosition, juce::int64 wallMs, Fn&& fn) {
+        collectScheduledCues();
+        runDue(sampleHeap, samplePosition, fn);
+        runDue(wallHeap, wallMs, fn);
+    }
+
+    // Called on the GL thread. Drops every cue that hasn't run yet.
+    void clear() {
+        collectScheduledCues();
+        sampleHeap.size = 0;
+        wallHeap.size = 0;
+    }
+
+private:
+    static constexpr int SLOT_FREE = 0;
+    static constexpr int SLOT_WRITING = 1;
+    static constexpr int SLOT_READY = 2;
+
+    struct Slot {
+        std::atomic<int> state{ SLOT_FREE };
+        ScheduledCue cue;
+    };
+
+    struct Heap {
+        std::array<ScheduledCue, CUE_SCHEDULER_CAPACITY> cues;
+        int size = 0;
+    };
+
+    // Orders the heaps so that the earliest cue, and then the first submitted, is on top.
+    static bool runsLater(const ScheduledCue& a, const ScheduledCue& b) {
+        return a.target != b.target ? a.target > b.target : a.ticket > b.ticket;
+    }
+
+    std::array<Slot, CUE_SCHEDULER_CAPACITY> slots;
+    std::atomic<juce::uint64> nextTicket{ 0 };
+
+    // Only touched on the GL thread. A cue stays in its slot while its heap is full, so scheduling fails instead.
+    Heap sampleHeap, wallHeap;
+
+    void collectScheduledCues() {
+        for (auto& slot : slots) {
+            if (slot.state.load(std::memory_order_acquire) != SLOT_READY)
+                continue;
+            Heap& heap = slot.cue.clock == CUE_CLOCK_WALL ? wallHeap : sampleHeap;
+            if (heap.size == CUE_SCHEDULER_CAPACITY)
+                continue;
+            heap.cues[(size_t) heap.size++] = slot.cue;
+            std::push_heap(heap.cues.begin(), heap.cues.begin() + heap.size, runsLater);
+            slot.state.store(SLOT_FREE, std::memory_order_release);
+        }
+    }
+
+    template <typename Fn>
+    static void runDue(Heap& heap, juce::int64 now, Fn& fn) {
+        while (heap.size > 0 && heap.cues[0].target <= now) {
+            std::pop_heap(heap.cues.begin(), heap.cues.begin() + heap.size, runsLater);
+            heap.size--;
+            fn(heap.cues[(size_t) heap.size]);
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CueScheduler)
+};
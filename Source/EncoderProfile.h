@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    EncoderProfile.h
+    Created: 19 Oct 2026 6:11:52am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#define ENCODER_PROFILE_ARCHIVE 0
+#define ENCODER_PROFILE_LOW_LATENCY 1
+#define ENCODER_PROFILE_SMALL_FILE 2
+#define ENCODER_PROFILE_CUSTOM 3
+#define NUM_ENCODER_PROFILES 4
+
+#define MIN_ENCODER_BITRATE_KBPS 500
+#define MAX_ENCODER_BITRATE_KBPS 100000
+#define MIN_KEYFRAME_SECONDS 0.1
+#define MAX_KEYFRAME_SECONDS 10.0
+#define MIN_ENCODER_PRESET 1
+#define MAX_ENCODER_PRESET 7
+
+/*
+    The encoder settings used for a recording session. Kept free of ffmpeg types so that the settings can hold one.
+
+    The preset is a speed level from 1 (fastest) to 7 (slowest, best compression). NVENC maps it to p1 to p7 and
+    libx264 to ultrafast through slow. The tune is one of NVENC's "hq", "ll" or "ull". libx264 has no direct
+    equivalent of hq, and both low latency tunes map to zerolatency. The rate control is "vbr" or "cbr".
+*/
+struct EncoderProfile {
+    int bitRateKbps = 8000;
+    double keyframeSeconds = 2.0; // The GOP length, in seconds so that it holds at any frame rate.
+    int preset = 4;
+    juce::String tune = "hq";
+    juce::String rateControl = "vbr";
+
+    bool isValid() const {
+        return bitRateKbps >= MIN_ENCODER_BITRATE_KBPS && bitRateKbps <= MAX_ENCODER_BITRATE_KBPS
+            && keyframeSeconds >= MIN_KEYFRAME_SECONDS && keyframeSeconds <= MAX_KEYFRAME_SECONDS
+            && preset >= MIN_ENCODER_PRESET && preset <= MAX_ENCODER_PRESET
+            && (tune == "hq" || tune == "ll" || tune == "ull")
+            && (rateControl == "vbr" || rateControl == "cbr");
+    }
+
+    bool operator==(const EncoderProfile& other) const {
+        return bitRateKbps == other.bitRateKbps && keyframeSeconds == other.keyframeSeconds && preset == other.preset
+            && tune == other.tune && rateControl == other.rateControl;
+    }
+
+    bool isLowLatency() const {
+        return tune != "hq";
+    }
+
+    int getGopSize(int frameRate) const {
+        return juce::jmax(1, juce::roundToInt(keyframeSeconds * frameRate));
+    }
+
+    const char* getNvencPreset() const {
+        static const char* presets[] = { "p1", "p2", "p3", "p4", "p5", "p6", "p7" };
+        return presets[juce::jlimit(MIN_ENCODER_PRESET, MAX_ENCODER_PRESET, preset) - 1];
+    }
+
+    const char* getSoftwarePreset() const {
+        static const char* presets[] = { "ultrafast", "superfast", "veryfast", "faster", "fast", "medium", "slow" };
+        return presets[juce::jlimit(MIN_ENCODER_PRESET, MAX_ENCODER_PRESET, preset) - 1];
+    }
+
+    juce::var toVar() const {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("bitRateKbps", bitRateKbps);
+        object->setProperty("keyframeSeconds", keyframeSeconds);
+        object->setProperty("preset", preset);
+        object->setProperty("tune", tune);
+        object->setProperty("rateControl", rateControl);
+        return juce::var(object);
+    }
+
+    // The built in profiles. Anything else returns the default profile.
+    static EncoderProfile getProfile(int id) {
+        EncoderProfile profile;
+        switch (id) {
+        case ENCODER_PROFILE_ARCHIVE: // Quality first. Long GOP, slowest preset.
+            profile.bitRateKbps = 16000;
+            profile.keyframeSeconds = 2.0;
+            profile.preset = 7;
+            profile.tune = "hq";
+            profile.rateControl = "vbr";
+            break;
+        case ENCODER_PROFILE_LOW_LATENCY: // Cheapest to encode, for live sets and streaming. Short GOP, constant rate.
+            profile.bitRateKbps = 8000;
+            profile.keyframeSeconds = 1.0;
+            profile.preset = 1;
+            profile.tune = "ull";
+            profile.rateControl = "cbr";
+            break;
+        case ENCODER_PROFILE_SMALL_FILE: // Low bitrate with a long GOP so the bits go into detail instead of keyframes.
+            profile.bitRateKbps = 3000;
+            profile.keyframeSeconds = 5.0;
+            profile.preset = 6;
+            profile.tune = "hq";
+            profile.rateControl = "vbr";
+            break;
+        default:
+            break;
+        }
+        return profile;
+    }
+
+    // Names used by the command line renderer.
+    static int getProfileID(const juce::String& name) {
+        if (name == "archive")
+            return ENCODER_PROFILE_ARCHIVE;
+        if (name == "low-latency")
+            return ENCODER_PROFILE_LOW_LATENCY;
+        if (name == "small-file")
+            return ENCODER_PROFILE_SMALL_FILE;
+        return -1;
+    }
+};
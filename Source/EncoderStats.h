@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    EncoderStats.h
+    Created: 19 Oct 2026 6:21:13am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+extern "C" {
+#include <libavutil/error.h>
+}
+
+/*
+    Health of the current recording session. Written by whichever thread encodes, and read from the message thread
+    for the recorder window and the socket protocol. Every field is a relaxed atomic, so neither side ever waits
+    on the other. A reader may see fields from slightly different moments, which is fine for monitoring.
+*/
+struct EncoderStats {
+    std::atomic<juce::int64> framesEncoded{ 0 };
+    std::atomic<juce::int64> framesDropped{ 0 }; // Skipped by the audio clock, or dropped because the encoder was behind.
+    std::atomic<juce::int64> framesDuplicated{ 0 }; // Sent more than once because the GL thread fell behind the audio.
+    std::atomic<juce::int64> packetsWritten{ 0 };
+    std::atomic<juce::int64> bytesWritten{ 0 };
+    std::atomic<juce::int64> streamPacketsDropped{ 0 };
+    std::atomic<int> queueDepth{ 0 };
+
+    // Time from sending a frame to the encoder until its packets were written, in microseconds.
+    std::atomic<juce::int64> lastEncodeLatencyUs{ 0 };
+    std::atomic<juce::int64> maxEncodeLatencyUs{ 0 };
+    std::atomic<juce::int64> totalEncodeLatencyUs{ 0 };
+
+    std::atomic<int> lastError{ 0 }; // An AVERROR code. 0 if nothing has failed.
+    std::atomic<juce::int64> errorCount{ 0 };
+
+    // Called when a session starts. The last error is kept until the next one starts so a failed start can be read.
+    void reset() {
+        framesEncoded.store(0, std::memory_order_relaxed);
+        framesDropped.store(0, std::memory_order_relaxed);
+        framesDuplicated.store(0, std::memory_order_relaxed);
+        packetsWritten.store(0, std::memory_order_relaxed);
+        bytesWritten.store(0, std::memory_order_relaxed);
+        streamPacketsDropped.store(0, std::memory_order_relaxed);
+        queueDepth.store(0, std::memory_order_relaxed);
+        lastEncodeLatencyUs.store(0, std::memory_order_relaxed);
+        maxEncodeLatencyUs.store(0, std::memory_order_relaxed);
+        totalEncodeLatencyUs.store(0, std::memory_order_relaxed);
+        lastError.store(0, std::memory_order_relaxed);
+        errorCount.store(0, std::memory_order_relaxed);
+    }
+
+    void addEncodedFrame(juce::int64 latencyUs) {
+        framesEncoded.fetch_add(1, std::memory_order_relaxed);
+        lastEncodeLatencyUs.store(latencyUs, std::memory_order_relaxed);
+        totalEncodeLatencyUs.fetch_add(latencyUs, std::memory_order_relaxed);
+        // Only the encoding thread writes the maximum, so a plain compare and store is enough.
+        if (latencyUs > maxEncodeLatencyUs.load(std::memory_order_relaxed))
+            maxEncodeLatencyUs.store(latencyUs, std::memory_order_relaxed);
+    }
+
+    void addPacket(int size) {
+        packetsWritten.fetch_add(1, std::memory_order_relaxed);
+        bytesWritten.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void addError(int error) {
+        lastError.store(error, std::memory_order_relaxed);
+        errorCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    double getAverageEncodeLatencyMs() const {
+        juce::int64 frames = framesEncoded.load(std::memory_order_relaxed);
+        return frames > 0 ? totalEncodeLatencyUs.load(std::memory_order_relaxed) / (1000.0 * frames) : 0.0;
+    }
+
+    juce::String getLastErrorString() const {
+        int error = lastError.load(std::memory_order_relaxed);
+        if (error == 0)
+            return "";
+        char errbuf[AV_ERROR_MAX_STRING_SIZE];
+        av_strerror(error, errbuf, sizeof(errbuf));
+        return juce::String(errbuf) + " (" + juce::String(error) + ")";
+    }
+
+    juce::var toVar() const {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("framesEncoded", framesEncoded.load(std::memory_order_relaxed));
+        object->setProperty("framesDropped", framesDropped.load(std::memory_order_relaxed));
+        object->setProperty("framesDuplicated", framesDuplicated.load(std::memory_order_relaxed));
+        object->setProperty("packetsWritten", packetsWritten.load(std::memory_order_relaxed));
+        object->setProperty("bytesWritten", bytesWritten.load(std::memory_order_relaxed));
+        object->setProperty("streamPacketsDropped", streamPacketsDropped.load(std::memory_order_relaxed));
+        object->setProperty("queueDepth", queueDepth.load(std::memory_order_relaxed));
+        object->setProperty("lastEncodeLatencyMs", lastEncodeLatencyUs.load(std::memory_order_relaxed) / 1000.0);
+        object->setProperty("maxEncodeLatencyMs", maxEncodeLatencyUs.load(std::memory_order_relaxed) / 1000.0);
+        object->setProperty("averageEncodeLatencyMs", getAverageEncodeLatencyMs());
+        object->setProperty("lastError", lastError.load(std::memory_order_relaxed));
+        object->setProperty("lastErrorString", getLastErrorString());
+        object->setProperty("errorCount", errorCount.load(std::memory_order_relaxed));
+        return juce::var(object);
+    }
+
+    // One line for the recorder window.
+    juce::String getSummary() const {
+        return "Frames " + juce::String(framesEncoded.load(std::memory_order_relaxed))
+            + "  Dropped " + juce::String(framesDropped.load(std::memory_order_relaxed))
+            + "  Duplicated " + juce::String(framesDuplicated.load(std::memory_order_relaxed))
+            + "  " + juce::File::descriptionOfSizeInBytes(bytesWritten.load(std::memory_order_relaxed))
+            + "  " + juce::String(getAverageEncodeLatencyMs(), 1) + "ms/frame"
+            + "  Queue " + juce::String(queueDepth.load(std::memory_order_relaxed));
+    }
+};
@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    FeatureBroadcaster.cpp
+    Created: 19 Oct 2026 6:30:29am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#include "FeatureBroadcaster.h"
+
+FeatureBroadcaster::FeatureBroadcaster(AudioVisualiserAudioProcessor& processor, OpenGLComponent& openGLComponent)
+    : juce::Thread("AV Feature Broadcaster"), processor(processor), openGLComponent(openGLComponent), readBuffer(2, FEATURE_FFT_SIZE),
+    fft(FEATURE_FFT_ORDER), window(FEATURE_FFT_SIZE, juce::dsp::WindowingFunction<float>::hann) {
+}
+
+FeatureBroadcaster::~FeatureBroadcaster() {
+    stop();
+}
+
+void FeatureBroadcaster::start() {
+    if (!isThreadRunning())
+        startThread();
+}
+
+void FeatureBroadcaster::stop() {
+    stopThread(FEATURE_IDLE_WAIT_MS * 10);
+}
+
+bool FeatureBroadcaster::anyListenerWantsFeatures() {
+    bool wanted = false;
+    listeners.call([&wanted](Listener& listener) {
+        wanted = wanted || listener.wantsFeatures();
+    });
+    return wanted;
+}
+
+void FeatureBroadcaster::run() {
+    double nextTickMs = juce::Time::getMillisecondCounterHiRes();
+    AudioFeatures features;
+    while (!threadShouldExit()) {
+        if (!anyListenerWantsFeatures()) {
+            wait(FEATURE_IDLE_WAIT_MS);
+            nextTickMs = juce::Time::getMillisecondCounterHiRes();
+            continue;
+        }
+
+        // Ticks are counted from the last one rather than from when the work finished, so the rate doesn't drift.
+        nextTickMs += 1000.0 / rate.load();
+        double now = juce::Time::getMillisecondCounterHiRes();
+        if (nextTickMs > now)
+            wait((int) (nextTickMs - now));
+        else if (now - nextTickMs > 1000.0)
+            nextTickMs = now; // Fell far behind, for example while the machine slept. Don't try to catch up.
+
+        analyse(features);
+        int size = pack(features);
+        listeners.call([this, &features, size](Listener& listener) {
+            if (listener.wantsFeatures())
+                listener.featuresReady(features, (const char*) packed, size);
+        });
+    }
+}
+
+void FeatureBroadcaster::analyse(AudioFeatures& features) {
+    features.samplePosition = processor.getAudioSamplePosition();
+    features.preset = (int) openGLComponent.getSelectedState();
+    features.leftRMS = processor.getRMS(0);
+    features.rightRMS = processor.getRMS(1);
+    features.playing = processor.isTransportPlaying();
+
+    processor.getRingBuffer().readSamples(readBuffer, FEATURE_FFT_SIZE);
+    juce::FloatVectorOperations::copy(fftData, readBuffer.getReadPointer(0), FEATURE_FFT_SIZE);
+    juce::FloatVectorOperations::add(fftData, readBuffer.getReadPointer(1), FEATURE_FFT_SIZE);
+    juce::FloatVectorOperations::multiply(fftData, 0.5f, FEATURE_FFT_SIZE);
+    window.multiplyWithWindowingTable(fftData, FEATURE_FFT_SIZE);
+    fft.performFrequencyOnlyForwardTransform(fftData);
+
+    const int numBins = FEATURE_FFT_SIZE / 2;
+    double sampleRate = processor.getSampleRate() > 0 ? processor.getSampleRate() : 44100.0;
+    float binHz = (float) sampleRate / FEATURE_FFT_SIZE;
+    float nyquist = (float) sampleRate / 2.0f;
+
+    // Band edges are spaced evenly in log frequency between FEATURE_MIN_BAND_HZ and nyquist.
+    float flux = 0.0f;
+    int bin = juce::jmax(1, (int) (FEATURE_MIN_BAND_HZ / binHz));
+    for (int band = 0; band < FEATURE_NUM_BANDS; band++) {
+        float upperHz = FEATURE_MIN_BAND_HZ * std::pow(nyquist / FEATURE_MIN_BAND_HZ, (band + 1) / (float) FEATURE_NUM_BANDS);
+        int upperBin = juce::jmin(numBins, juce::jmax(bin + 1, (int) (upperHz / binHz)));
+        float energy = 0.0f;
+        for (; bin < upperBin; bin++) {
+            float magnitude = fftData[bin] / FEATURE_FFT_SIZE;
+            energy += magnitude;
+            flux += juce::jmax(0.0f, magnitude - previousMagnitudes[bin]);
+            previousMagnitudes[bin] = magnitude;
+        }
+        features.bands[band] = energy;
+    }
+
+    float averageFlux = 0.0f;
+    for (float f : fluxHistory)
+        averageFlux += f;
+    averageFlux /= FEATURE_FLUX_HISTORY;
+    fluxHistory[fluxIndex] = flux;
+    fluxIndex = (fluxIndex + 1) % FEATURE_FLUX_HISTORY;
+
+    juce::int64 nowMs = juce::Time::currentTimeMillis();
+    features.onset = flux > averageFlux * FEATURE_ONSET_THRESHOLD && flux > 1.0e-4f && nowMs - lastOnsetMs >= FEATURE_ONSET_HOLD_MS;
+    if (features.onset)
+        lastOnsetMs = nowMs;
+}
+
+int FeatureBroadcaster::pack(const AudioFeatures& features) {
+    juce::uint32 length = CUE_FEATURES_HEADER_SIZE + FEATURE_NUM_BANDS * 4;
+    packed[0] = CUE_PROTOCOL_MAGIC;
+    packed[1] = CUE_FRAME_FEATURES;
+    CueProtocol::writeLittleEndian<juce::uint16>(0, packed + 2);
+    CueProtocol::writeLittleEndian<juce::uint32>(length, packed + 4);
+    CueProtocol::writeLittleEndian<juce::uint32>(sequence++, packed + 8);
+
+    juce::uint8* payload = packed + CUE_PROTOCOL_HEADER_SIZE;
+    CueProtocol::writeLittleEndian<juce::uint64>((juce::uint64) features.samplePosition, payload);
+    CueProtocol::writeLittleEndian<juce::uint16>((juce::uint16) features.preset, payload + 8);
+    payload[10] = (features.onset ? CUE_FEATURE_ONSET : 0) | (features.playing ? CUE_FEATURE_PLAYING : 0);
+    payload[11] = FEATURE_NUM_BANDS;
+    CueProtocol::writeLittleEndianFloat(features.leftRMS, payload + 12);
+    CueProtocol::writeLittleEndianFloat(features.rightRMS, payload + 16);
+    for (int i = 0; i < FEATURE_NUM_BANDS; i++)
+        CueProtocol::writeLittleEndianFloat(features.bands[i], payload + CUE_FEATURES_HEADER_SIZE + i * 4);
+    return (int) (CUE_PROTOCOL_HEADER_SIZE + length);
+}
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    FeatureBroadcaster.h
+    Created: 19 Oct 2026 6:30:29am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "PluginProcessor.h"
+#include "OpenGLComponent.h"
+#include "CueProtocol.h"
+
+#define FEATURE_FFT_ORDER 10
+#define FEATURE_FFT_SIZE (1 << FEATURE_FFT_ORDER)
+#define FEATURE_NUM_BANDS 8
+#define FEATURE_MIN_BAND_HZ 40.0f
+#define FEATURE_DEFAULT_RATE 60
+#define FEATURE_MIN_RATE 1
+#define FEATURE_MAX_RATE 120
+#define FEATURE_IDLE_WAIT_MS 100
+#define FEATURE_FLUX_HISTORY 32
+#define FEATURE_ONSET_THRESHOLD 1.5f // An onset is spectral flux this many times above its recent average.
+#define FEATURE_ONSET_HOLD_MS 100 // No second onset is reported within this long of the last one.
+
+// The features of one analysis. The packed form is described in CueProtocol.h.
+struct AudioFeatures {
+    juce::int64 samplePosition = 0;
+    int preset = 0;
+    bool onset = false;
+    bool playing = false;
+    float leftRMS = 0.0f, rightRMS = 0.0f;
+    float bands[FEATURE_NUM_BANDS] = {};
+
+    juce::String toJSON() const {
+        juce::String json = "{\"samplePosition\":" + juce::String(samplePosition)
+            + ",\"preset\":" + juce::String(preset)
+            + ",\"onset\":" + (onset ? "true" : "false")
+            + ",\"playing\":" + (playing ? "true" : "false")
+            + ",\"leftRMS\":" + juce::String(leftRMS, 4)
+            + ",\"rightRMS\":" + juce::String(rightRMS, 4)
+            + ",\"bands\":[";
+        for (int i = 0; i < FEATURE_NUM_BANDS; i++)
+            json += (i > 0 ? "," : "") + juce::String(bands[i], 4);
+        return json + "]}\n";
+    }
+};
+
+/*
+    Analyses the audio at a steady rate and hands the result to listeners, which send it to their clients.
+
+    Runs on its own thread and reads the ring buffer like the GL thread does, so neither the audio thread nor
+    the GL thread does any of the analysis, packing or sending. Every tick computes the RMS of each channel, the
+    energy in FEATURE_NUM_BANDS log spaced bands, whether there was an onset, and the selected preset. Onsets
+    are found from spectral flux against its own recent average, which is enough for lighting to follow beats.
+
+    Nothing is analysed while no listener wants features.
+*/
+class FeatureBroadcaster : private juce::Thread {
+public:
+    struct Listener {
+        virtual ~Listener() = default;
+        // Called on the broadcaster thread.
+        virtual bool wantsFeatures() = 0;
+        // Called on the broadcaster thread. packed is a CUE_FRAME_FEATURES frame, valid for the duration of the call.
+        virtual void featuresReady(const AudioFeatures& features, const char* packed, int size) = 0;
+    };
+
+    FeatureBroadcaster(AudioVisualiserAudioProcessor& processor, OpenGLComponent& openGLComponent);
+    ~FeatureBroadcaster() override;
+
+    void start();
+    void stop();
+
+    void addListener(Listener* listener) {
+        listeners.add(listener);
+    }
+
+    void removeListener(Listener* listener) {
+        listeners.remove(listener);
+    }
+
+    // Analyses per second. Takes effect on the next tick.
+    void setRate(int newRate) {
+        rate.store(juce::jlimit(FEATURE_MIN_RATE, FEATURE_MAX_RATE, newRate));
+    }
+
+    int getRate() {
+        return rate.load();
+    }
+
+private:
+    AudioVisualiserAudioProcessor& processor;
+    OpenGLComponent& openGLComponent;
+
+    juce::ListenerList<Listener, juce::Array<Listener*, juce::CriticalSection>> listeners;
+    std::atomic<int> rate{ FEATURE_DEFAULT_RATE };
+
+    // Only touched on the broadcaster thread.
+    juce::AudioBuffer<float> readBuffer;
+    juce::dsp::FFT fft;
+    juce::dsp::WindowingFunction<float> window;
+    float fftData[FEATURE_FFT_SIZE * 2];
+    float previousMagnitudes[FEATURE_FFT_SIZE / 2] = {};
+    float fluxHistory[FEATURE_FLUX_HISTORY] = {};
+    int fluxIndex = 0;
+    juce::int64 lastOnsetMs = 0;
+    juce::uint32 sequence = 0;
+    juce::uint8 packed[CUE_PROTOCOL_HEADER_SIZE + CUE_FEATURES_HEADER_SIZE + FEATURE_NUM_BANDS * 4];
+
+    void run() override;
+    bool anyListenerWantsFeatures();
+    void analyse(AudioFeatures& features);
+    int pack(const AudioFeatures& features);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FeatureBroadcaster)
+};
@@ -11,13 +11,28 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 #include "PluginEditor.h"
 #include "SocketCueResolver.h"
+#include "SocketReactor.h"
+#include "ClientRegistry.h"
+#include "CueProtocol.h"
+#include "FeatureBroadcaster.h"
 
-class GlobalSocketHandler {
+#define SOCKET_MAX_TEXT_LINE 1024
+
+// How a client talks. Decided by the first byte it sends.
+#define CLIENT_MODE_UNKNOWN 0
+#define CLIENT_MODE_TEXT 1 // "post:body" messages, as sent by scripts/av-client.py.
+#define CLIENT_MODE_BINARY 2 // Framed cues, see CueProtocol.h.
+
+class GlobalSocketHandler : private SocketReactor::Listener, private FeatureBroadcaster::Listener {
 public:
-    GlobalSocketHandler(SocketCueResolver& socketCueResolver) : socketCueResolver(socketCueResolver) {
+    GlobalSocketHandler(SocketCueResolver& socketCueResolver, FeatureBroadcaster& featureBroadcaster) : socketCueResolver(socketCueResolver), featureBroadcaster(featureBroadcaster), reactor(serverSocket, *this) {
+        featureBroadcaster.addListener(this);
         if (serverSocket.createListener(0)) {
             port = serverSocket.getBoundPort();
             DBG("Global server socket listening on port " << juce::String(port) << ".");
@@ -27,49 +42,25 @@ public:
         }
     }
 
+    // Cues are read by the reactor thread as soon as they arrive.
     void startListening() {
-        juce::Thread::launch([this]() {
-            running.store(true);
-            while (running.load()) {
-                if (serverSocket.waitUntilReady(true, 1) > 0) {
-                    std::unique_ptr<juce::StreamingSocket> clientSocket(serverSocket.waitForNextConnection());
-                    if (clientSocket) {
-                        DBG("Client connected! " << clientSocket->getRawSocketHandle());
-                        clients.push_back(std::move(clientSocket));
-                    }
-                }
-
-                for (auto& client : clients) {
-                    if (client->waitUntilReady(true, 0)) {
-                        char buffer[1024];
-                        int bytesRead = client->read(buffer, sizeof(buffer), true);
-                        if (bytesRead > 0) {
-                            juce::String received(buffer, bytesRead);
-                            DBG("Global socket handler received data: " << received << " from client: " << client->getRawSocketHandle() << ".");
-                            resolveResponse(received);
-                        }
-                    }
-                }
-                juce::Thread::sleep(500);
-            }
-            });
+        if (port != -1)
+            reactor.start();
     }
 
     void stopListening() {
-        running.store(false);
+        reactor.stop();
     }
 
     bool isListening() {
-        return running.load();
+        return reactor.isRunning();
     }
 
     void destroy() {
+        alive->store(false);
+        featureBroadcaster.removeListener(this);
+        reactor.stop(); // Closes every client.
         serverSocket.close();
-        for (auto& client : clients) {
-            client.get()->close();
-            client.release();
-        }
-        clients.clear();
     }
 
     juce::String getConnectionHandle() {
@@ -81,13 +72,153 @@ public:
 
 private:
     SocketCueResolver& socketCueResolver;
+    FeatureBroadcaster& featureBroadcaster;
 
     int port = -1;
 
-    std::atomic<bool> running{ false };
-
     juce::StreamingSocket serverSocket;
-    std::vector<std::unique_ptr<juce::StreamingSocket>> clients;
+    SocketReactor reactor;
+    std::shared_ptr<std::atomic<bool>> alive = std::make_shared<std::atomic<bool>>(true); // Cleared by destroy(), so cues still queued for the message thread are dropped.
+
+    // Bytes a client has sent that don't make up a whole message yet. Only touched on the reactor thread.
+    struct ClientBuffer {
+        int mode = CLIENT_MODE_UNKNOWN;
+        bool lineFramed = false; // Set once a text client sends a newline. Until then each read is one message.
+        std::vector<char> data;
+
+        // Keeps the buffer for the next client unless this one grew it past a normal read.
+        void reset() {
+            mode = CLIENT_MODE_UNKNOWN;
+            lineFramed = false;
+            data.clear();
+            if (data.capacity() > SOCKET_REACTOR_READ_SIZE)
+                data.shrink_to_fit();
+        }
+    };
+    ClientRegistry<ClientBuffer> clientBuffers{ SOCKET_REACTOR_MAX_CLIENTS };
+
+    // Clients that asked for audio features. Changed on the message thread and read on the broadcaster thread.
+    struct FeatureSubscriber {
+        int clientId;
+        bool binary; // Binary clients get CUE_FRAME_FEATURES frames, text clients a line of JSON.
+    };
+    juce::CriticalSection subscribersLock;
+    std::vector<FeatureSubscriber> featureSubscribers;
+
+    void setSubscribed(int clientId, bool subscribed, bool binary) {
+        const juce::ScopedLock lock(subscribersLock);
+        featureSubscribers.erase(std::remove_if(featureSubscribers.begin(), featureSubscribers.end(), [clientId](const FeatureSubscriber& subscriber) {
+            return subscriber.clientId == clientId;
+        }), featureSubscribers.end());
+        if (subscribed)
+            featureSubscribers.push_back({ clientId, binary });
+    }
+
+    bool wantsFeatures() override {
+        const juce::ScopedLock lock(subscribersLock);
+        return !featureSubscribers.empty();
+    }
+
+    // Slow clients lose their oldest frames in the reactor's send queue rather than holding up the others.
+    // Subscribers that have gone, which can happen if a subscription raced a disconnect, are dropped here.
+    void featuresReady(const AudioFeatures& features, const char* packed, int size) override {
+        const juce::ScopedLock lock(subscribersLock);
+        juce::String json;
+        featureSubscribers.erase(std::remove_if(featureSubscribers.begin(), featureSubscribers.end(), [&](const FeatureSubscriber& subscriber) {
+            if (subscriber.binary)
+                return !reactor.publish(subscriber.clientId, packed, size);
+            if (json.isEmpty())
+                json = features.toJSON();
+            return !reactor.publish(subscriber.clientId, json.toRawUTF8(), (int) json.getNumBytesAsUTF8());
+        }), featureSubscribers.end());
+    }
+
+    bool dataReceived(int clientId, const char* data, int size) override {
+        ClientBuffer* registered = clientBuffers.acquire(clientId);
+        if (registered == nullptr)
+            return false;
+        ClientBuffer& buffer = *registered;
+        if (buffer.mode == CLIENT_MODE_UNKNOWN)
+            buffer.mode = (juce::uint8) data[0] == CUE_PROTOCOL_MAGIC ? CLIENT_MODE_BINARY : CLIENT_MODE_TEXT;
+
+        if (buffer.mode == CLIENT_MODE_TEXT)
+            return receiveText(clientId, buffer, data, size);
+        return receiveBinary(clientId, buffer, data, size);
+    }
+
+    void clientDisconnected(int clientId) override {
+        clientBuffers.release(clientId);
+        setSubscribed(clientId, false, false);
+    }
+
+    bool receiveText(int clientId, ClientBuffer& buffer, const char* data, int size) {
+        // Older clients send one message per connection with no terminator, so a read without a newline is taken
+        // as a whole message until the client shows that it ends its lines.
+        if (!buffer.lineFramed && std::find(data, data + size, '\n') == data + size) {
+            resolveResponse(juce::String(data, (size_t) size).trim(), clientId);
+            return true;
+        }
+        buffer.lineFramed = true;
+        buffer.data.insert(buffer.data.end(), data, data + size);
+
+        auto lineStart = buffer.data.begin();
+        for (auto it = buffer.data.begin(); it != buffer.data.end(); ++it) {
+            if (*it != '\n')
+                continue;
+            juce::String line(&*lineStart, (size_t) (it - lineStart));
+            if (line.trim().isNotEmpty())
+                resolveResponse(line.trim(), clientId);
+            lineStart = it + 1;
+        }
+        buffer.data.erase(buffer.data.begin(), lineStart);
+
+        if (buffer.data.size() > SOCKET_MAX_TEXT_LINE) {
+            DBG("Global Socket Handler client " << clientId << " sent a line that is too long. Closing it.");
+            return false;
+        }
+        return true;
+    }
+
+    bool receiveBinary(int clientId, ClientBuffer& buffer, const char* data, int size) {
+        buffer.data.insert(buffer.data.end(), data, data + size);
+
+        // Frames are read in place. Only the cue values are copied, to hand them to the message thread.
+        size_t offset = 0;
+        CueFrame frame;
+        while (true) {
+            int frameSize = CueProtocol::parseFrame(buffer.data.data() + offset, buffer.data.size() - offset, frame);
+            if (frameSize == 0)
+                break;
+
+            std::vector<SocketCue> cues;
+            bool valid = frameSize > 0 && SocketCueResolver::readCues(frame, cues);
+            if (!valid) {
+                DBG("Global Socket Handler client " << clientId << " sent a malformed frame. Closing it.");
+                juce::uint32 sequence = buffer.data.size() - offset >= CUE_PROTOCOL_HEADER_SIZE ? juce::ByteOrder::littleEndianInt(buffer.data.data() + offset + 8) : 0;
+                juce::MemoryBlock ack = CueProtocol::makeAck(sequence, CUE_ACK_MALFORMED, 0);
+                reactor.send(clientId, ack.getData(), (int) ack.getSize());
+                return false;
+            }
+
+            if (frame.scheduled) {
+                juce::MemoryBlock ack = socketCueResolver.scheduleCues(frame, cues);
+                if (ack.getSize() > 0)
+                    reactor.send(clientId, ack.getData(), (int) ack.getSize());
+            } else {
+                socketCueResolver.runCues(frame.sequence, (frame.flags & CUE_FLAG_ACK) != 0, std::move(cues), getReplies(clientId, true));
+            }
+            offset += (size_t) frameSize;
+        }
+        buffer.data.erase(buffer.data.begin(), buffer.data.begin() + offset);
+        return true;
+    }
+
+    // Queries and acks go back on the same connection, if the client is still connected.
+    CueReplies getReplies(int clientId, bool binary) {
+        return { alive,
+            [this, clientId, binary](bool subscribed) { setSubscribed(clientId, subscribed, binary); },
+            [this, clientId](const void* data, int size) { reactor.send(clientId, data, size); } };
+    }
 
     bool isLoopback(const juce::IPAddress& addr) {
         if (!addr.isIPv6) // Only check IPv4.
@@ -116,25 +247,9 @@ private:
         return result;
     }
 
-    void resolveResponse(juce::String response) {
-        juce::StringArray tokens;
-        tokens.addTokens(response, ":", "");
-        if (tokens.size() == 0) {
-            DBG("Global Socket Handler tried to resolve a response but the response format was incorrect!");
-            return;
-        }
+    void resolveResponse(const juce::String& response, int clientId) {
         int post, body;
-        try {
-            post = std::stoi(tokens[0].toStdString());
-            body = std::stoi(tokens[1].toStdString());
-        } catch (std::exception) {
-            DBG("Global Socket Handler tried to resolve a response but the response could not be parsed as an ID and body pair!");
-            return;
-        }
-        juce::MessageManager::callAsync([this, post, body]() {
-            DBG("Global Socket Handler resolved a response as post: " << post << " body: " << body);
-            // plugin editor can handle the request from here on the message thread.
-            socketCueResolver.postCue(post, body);
-        });
+        if (SocketCueResolver::parseTextCue(response, post, body))
+            socketCueResolver.runTextCue(post, body, getReplies(clientId, false));
     }
 };
\ No newline at end of file
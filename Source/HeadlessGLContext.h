@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    HeadlessGLContext.h
+    Created: 19 Oct 2026 6:07:51am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_LINUX
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+/*
+    An OpenGL 3.3 core context without a window, created through EGL.
+
+    Works with GPU drivers as well as Mesa's software rasteriser (llvmpipe), so the headless renderer can run
+    on servers that have no display and no GPU. Everything is rendered into FBOs, so the context only gets a
+    tiny pbuffer to be made current with.
+
+    JUCE's GL function loader is used once the context is current. With GLVND the loaded entry points
+    dispatch to whichever context is current, whether it was created through GLX or EGL.
+*/
+class HeadlessGLContext {
+public:
+    ~HeadlessGLContext() {
+        release();
+    }
+
+    bool create() {
+        display = getDisplay();
+        if (display == EGL_NO_DISPLAY) {
+            DBG("Headless GL context could not find an EGL display!");
+            return false;
+        }
+        EGLint major, minor;
+        if (!eglInitialize(display, &major, &minor)) {
+            DBG("Headless GL context could not initialise EGL!");
+            return false;
+        }
+        DBG("Headless GL context initialised EGL " << major << "." << minor << ".");
+
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint numConfigs = 0;
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+            DBG("Headless GL context could not find a suitable EGL config!");
+            return false;
+        }
+
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            DBG("Headless GL context could not bind the desktop OpenGL API!");
+            return false;
+        }
+
+        // The shaders are all #version 330 core.
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+        if (context == EGL_NO_CONTEXT) {
+            DBG("Headless GL context could not create an OpenGL 3.3 core context!");
+            return false;
+        }
+
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+        if (surface == EGL_NO_SURFACE || !eglMakeCurrent(display, surface, surface, context)) {
+            DBG("Headless GL context could not be made current!");
+            return false;
+        }
+
+        juce::gl::loadFunctions();
+
+        // A core profile context needs a vertex array object bound before any vertex attributes are set up.
+        // juce::OpenGLContext binds one for attached components, so do the same here.
+        juce::gl::glGenVertexArrays(1, &vertexArray);
+        juce::gl::glBindVertexArray(vertexArray);
+
+        DBG("Headless GL context created with renderer " << (const char*) juce::gl::glGetString(juce::gl::GL_RENDERER) << ".");
+        return true;
+    }
+
+    void release() {
+        if (display == EGL_NO_DISPLAY)
+            return;
+        if (vertexArray != 0)
+            juce::gl::glDeleteVertexArrays(1, &vertexArray);
+        vertexArray = 0;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (surface != EGL_NO_SURFACE)
+            eglDestroySurface(display, surface);
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+        eglTerminate(display);
+        surface = EGL_NO_SURFACE;
+        context = EGL_NO_CONTEXT;
+        display = EGL_NO_DISPLAY;
+    }
+
+private:
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+    GLuint vertexArray = 0;
+
+    EGLDisplay getDisplay() {
+        // Prefer Mesa's surfaceless platform so that no X server or DRM device is needed.
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay != nullptr) {
+            EGLDisplay surfaceless = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (surfaceless != EGL_NO_DISPLAY)
+                return surfaceless;
+        }
+        return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE(HeadlessGLContext)
+};
+#endif
@@ -0,0 +1,168 @@
+/*
+  ==============================================================================
+
+    HeadlessMain.cpp
+    Created: 19 Oct 2026 6:07:51am
+    Author:  lucas
+
+    Entry point of AudioVisualiserCLI, the headless batch renderer.
+
+    Renders an audio file to an MP4 with one of the built in presets or an .avrs shader, using the same
+    RenderState, OfflineRenderer and VideoEncoder classes as the plugin. No window, audio device or GPU is
+    needed, so many instances can be run side by side on a CPU only server, one per core.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+
+#include "HeadlessGLContext.h"
+#include "OfflineRenderer.h"
+#include "BuiltInRenderStates.h"
+#include "AVIOHandler.h"
+
+#if ! JUCE_LINUX
+ #error "AudioVisualiserCLI renders with EGL, so it only builds on Linux."
+#endif
+
+#define CLI_MIN_DIMENSION 2
+#define CLI_MAX_DIMENSION 7680
+#define CLI_MIN_FPS 1
+#define CLI_MAX_FPS 240
+
+static void printUsage() {
+    std::cout << "Usage: AudioVisualiserCLI --audio <file> (--preset <id> | --shader <file.avrs>) --output <file.mp4>\n"
+              << "                          [--width <pixels>] [--height <pixels>] [--fps <rate>] [--threads <count>]\n"
+              << "                          [--profile archive|low-latency|small-file]\n\n"
+              << "  --preset   Built in preset id from 1 to " << NUM_BUILT_IN_RENDER_STATES << ".\n"
+              << "  --shader   Fragment shader saved from the AI generator.\n"
+              << "  --width    Output width. Default 1920.\n"
+              << "  --height   Output height. Default 1080.\n"
+              << "  --fps      Output frame rate. Default " << STREAM_FRAME_RATE << ".\n"
+              << "  --profile  Encoder profile. Default bitrate and preset if not given.\n"
+              << "  --threads  Encoder threads. Default 1, so one process can be run per core. 0 uses every core.\n";
+}
+
+static int getIntOption(const juce::ArgumentList& args, const juce::String& option, int defaultValue) {
+    if (!args.containsOption(option))
+        return defaultValue;
+    return args.getValueForOption(option).getIntValue();
+}
+
+int main(int argc, char* argv[]) {
+    juce::ArgumentList args(argc, argv);
+
+    juce::String audioPath = args.getValueForOption("--audio");
+    juce::String outputPath = args.getValueForOption("--output");
+    juce::String shaderPath = args.getValueForOption("--shader");
+    int presetId = getIntOption(args, "--preset", 0);
+    int width = getIntOption(args, "--width", 1920);
+    int height = getIntOption(args, "--height", 1080);
+    int fps = getIntOption(args, "--fps", STREAM_FRAME_RATE);
+    int threads = getIntOption(args, "--threads", 1);
+
+    VideoEncoder::RecordingOptions options;
+    if (args.containsOption("--profile")) {
+        int profileID = EncoderProfile::getProfileID(args.getValueForOption("--profile"));
+        if (profileID < 0) {
+            printUsage();
+            return 1;
+        }
+        options.profile = EncoderProfile::getProfile(profileID);
+    }
+
+    if (audioPath.isEmpty() || outputPath.isEmpty() || (presetId == 0) == shaderPath.isEmpty()) {
+        printUsage();
+        return 1;
+    }
+    if (width < CLI_MIN_DIMENSION || width > CLI_MAX_DIMENSION || height < CLI_MIN_DIMENSION || height > CLI_MAX_DIMENSION) {
+        std::cerr << "Width and height must be between " << CLI_MIN_DIMENSION << " and " << CLI_MAX_DIMENSION << ".\n";
+        return 1;
+    }
+    if (fps < CLI_MIN_FPS || fps > CLI_MAX_FPS) {
+        std::cerr << "The frame rate must be between " << CLI_MIN_FPS << " and " << CLI_MAX_FPS << ".\n";
+        return 1;
+    }
+
+    juce::File audioFile = juce::File::getCurrentWorkingDirectory().getChildFile(audioPath);
+    juce::File outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(outputPath);
+
+    // Render states own a RenderProfileComponent, and components need the message manager to exist.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(audioFile));
+    if (reader == nullptr) {
+        std::cerr << "Could not read the audio file " << audioFile.getFullPathName() << ".\n";
+        return 1;
+    }
+
+    HeadlessGLContext glContext;
+    if (!glContext.create()) {
+        std::cerr << "Could not create a headless OpenGL context. Is an EGL driver such as Mesa installed?\n";
+        return 1;
+    }
+
+    // Never attached to a component. The render states only use it for its GL function table, which works
+    // with whatever context is current on this thread.
+    juce::OpenGLContext openGLContext;
+
+    std::unique_ptr<RenderState> renderState;
+    if (presetId != 0) {
+        renderState = createBuiltInRenderState(presetId, openGLContext);
+        if (!renderState) {
+            std::cerr << "Unknown preset id " << presetId << ".\n";
+            return 1;
+        }
+    } else {
+        juce::File shaderFile = juce::File::getCurrentWorkingDirectory().getChildFile(shaderPath);
+        if (!shaderFile.existsAsFile()) {
+            std::cerr << "Could not find the shader " << shaderFile.getFullPathName() << ".\n";
+            return 1;
+        }
+        renderState = createShaderRenderState(0, openGLContext, getRenderStateFromFile(shaderFile.getFullPathName()));
+    }
+    renderState->initAndCompileShaders();
+    if (renderState->getShaderProgramID() == (GLuint) -1) {
+        std::cerr << "The shader failed to compile.\n";
+        return 1;
+    }
+
+    VideoEncoder encoder(width, height, fps);
+    encoder.setThreadCount(threads);
+
+    GLuint fbo;
+    juce::gl::glGenFramebuffers(1, &fbo);
+    juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, fbo);
+    juce::gl::glFramebufferTexture2D(juce::gl::GL_FRAMEBUFFER, juce::gl::GL_COLOR_ATTACHMENT0, juce::gl::GL_TEXTURE_2D, encoder.getTextureID(), 0);
+    if (juce::gl::glCheckFramebufferStatus(juce::gl::GL_FRAMEBUFFER) != juce::gl::GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "The render target could not be created.\n";
+        return 1;
+    }
+    juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, 0);
+
+    OfflineRenderer renderer(std::move(reader), *renderState, encoder, fbo);
+    if (!renderer.start(outputFile.getFullPathName(), options)) {
+        std::cerr << "Could not start encoding to " << outputFile.getFullPathName() << ".\n";
+        return 1;
+    }
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+    int lastPercent = -1;
+    while (renderer.renderNextFrame()) {
+        int percent = (int) (renderer.getProgress() * 100.0);
+        if (percent != lastPercent) {
+            std::cout << "\rRendering " << percent << "%" << std::flush;
+            lastPercent = percent;
+        }
+    }
+    renderer.finish();
+    juce::gl::glDeleteFramebuffers(1, &fbo);
+
+    double seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    std::cout << "\rRendered " << renderer.getFramesRendered() << " frames to " << outputFile.getFullPathName()
+              << " in " << juce::String(seconds, 1) << "s.\n";
+    return renderer.getFramesRendered() == renderer.getTotalFrames() ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    JSONArrayStream.h
+    Created: 19 Oct 2026 6:41:31am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <string>
+
+#define JSON_ARRAY_STREAM_MAX_ELEMENT 4194304 // 4MB. A render state is a shader, so anything near this is not one.
+
+/*
+    Splits a JSON array that arrives in pieces into its elements, and parses each element as soon as its last
+    byte arrives.
+
+    Only the element being read is buffered, and its buffer is reused for the next, so memory is bounded by the
+    largest element rather than the whole array. The scan only looks at brackets, braces, quotes and escapes, all
+    of which are ASCII, so it is safe on UTF-8 split anywhere.
+*/
+class JSONArrayStream {
+public:
+    // Scans the next piece of the document and calls onElement with the juce::var of every element it completes.
+    // Returns false once the document turns out not to be an array, or an element is too big.
+    template <typename Function>
+    bool feed(const char* data, int size, Function&& onElement) {
+        for (int i = 0; i < size && state != FAILED; i++) {
+            char c = data[i];
+            switch (state) {
+            case BEFORE_ARRAY:
+                if (c == '[')
+                    state = BETWEEN_ELEMENTS;
+                else if (!isWhitespace(c) && !isByteOrderMark(c))
+                    fail("The document is not a JSON array.");
+                break;
+            case BETWEEN_ELEMENTS:
+                if (c == ']') {
+                    state = AFTER_ARRAY;
+                } else if (!isWhitespace(c) && c != ',') {
+                    element.clear();
+                    depth = 0;
+                    inString = escaped = false;
+                    state = IN_ELEMENT;
+                    scanElement(c, onElement);
+                }
+                break;
+            case IN_ELEMENT:
+                scanElement(c, onElement);
+                break;
+            default:
+                break;
+            }
+        }
+        return state != FAILED;
+    }
+
+    // True once the closing bracket of the array has been read.
+    bool isFinished() const {
+        return state == AFTER_ARRAY;
+    }
+
+private:
+    enum State { BEFORE_ARRAY, BETWEEN_ELEMENTS, IN_ELEMENT, AFTER_ARRAY, FAILED };
+    State state = BEFORE_ARRAY;
+    std::string element;
+    int depth = 0;
+    bool inString = false, escaped = false;
+
+    template <typename Function>
+    void scanElement(char c, Function& onElement) {
+        if (inString) {
+            if (escaped)
+                escaped = false;
+            else if (c == '\\')
+                escaped = true;
+            else if (c == '"')
+                inString = false;
+        } else if ((c == ',' || c == ']') && depth == 0) {
+            // The end of a number, string or literal, which has no closing character of its own.
+            emit(onElement);
+            state = c == ',' ? BETWEEN_ELEMENTS : AFTER_ARRAY;
+            return;
+        } else if (c == '"') {
+            inString = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            depth--;
+        }
+
+        element.push_back(c);
+        if (element.size() > JSON_ARRAY_STREAM_MAX_ELEMENT) {
+            fail("A JSON array element is too big.");
+            return;
+        }
+        if (depth == 0 && !inString && (c == '}' || c == ']')) {
+            emit(onElement);
+            state = BETWEEN_ELEMENTS;
+        }
+    }
+
+    template <typename Function>
+    void emit(Function& onElement) {
+        juce::var parsed;
+        juce::Result result = juce::JSON::parse(juce::String::fromUTF8(element.data(), (int) element.size()), parsed);
+        if (result.failed())
+            DBG("Skipping a JSON array element that could not be parsed: " << result.getErrorMessage());
+        else
+            onElement(parsed);
+        element.clear();
+    }
+
+    void fail(const juce::String& reason) {
+        DBG(reason);
+        juce::ignoreUnused(reason);
+        state = FAILED;
+    }
+
+    static bool isWhitespace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    static bool isByteOrderMark(char c) {
+        return (juce::uint8) c == 0xEF || (juce::uint8) c == 0xBB || (juce::uint8) c == 0xBF;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JSONArrayStream)
+};
@@ -58,6 +58,11 @@ public:
 		addAndMakeVisible(webView);
 	}
 
+	~LoginContentComponent() override {
+		apiClient->cancel(loginRequest);
+		apiClient->cancel(registerRequest);
+	}
+
 	void resized() override {
 		webView.setBounds(getLocalBounds()); // Make the web view fit the entire window on resize.
 	}
@@ -65,6 +70,8 @@ public:
 private:
 
 	ApplicationSettings& settings;
+	juce::SharedResourcePointer<APIClient> apiClient;
+	int loginRequest = 0, registerRequest = 0;
 
 	juce::WebBrowserComponent webView;
 
@@ -94,9 +101,8 @@ private:
 			return;
 		}
 		DBG("Native Login Function called from front end to back end. Username: " << args[0].toString() << ", Password: " << args[1].toString() << ".");
-		juce::Thread::launch([this, username, password]() {
-			isAttemptingLogin.store(true);
-			juce::String token = api_login(username, password);
+		isAttemptingLogin.store(true);
+		loginRequest = api_login(*apiClient, username, password, [this](const juce::String& token) {
 			// Validate token here.
 			bool success = token.length() > 0; // A successful token get would have substance to the string.
 			if (!success) {
@@ -105,10 +111,8 @@ private:
 				settings.setAuthJWT(token);
 				DBG("Successfully validated api login JWT! Token: " << token);
 			}
-			juce::MessageManager::callAsync([this, success]() {
-				isAttemptingLogin.store(false);
-				webView.emitEventIfBrowserIsVisible(juce::Identifier{ "onLoginEvent" }, success);
-				}); // Post the login update back to the GUI thread.
+			isAttemptingLogin.store(false);
+			webView.emitEventIfBrowserIsVisible(juce::Identifier{ "onLoginEvent" }, success);
 			});
 		completion(LOGIN_ATTEMPT_ARGS_OK); // Completion is sent back to the javascript frontend to have the result evaluated.
 	}
@@ -134,13 +138,10 @@ private:
 			return;
 		}
 		DBG("Native Register Function called from front end to back end. Username: " << args[0].toString() << ", Password: " << args[1].toString() << ".");
-		juce::Thread::launch([this, username, password]() {
-			isAttemptingRegister.store(true);
-			int register_status = api_register(username, password);
-			juce::MessageManager::callAsync([this, register_status]() {
-				isAttemptingRegister.store(false);
-				webView.emitEventIfBrowserIsVisible(juce::Identifier{ "onRegisterEvent" }, register_status);
-				});
+		isAttemptingRegister.store(true);
+		registerRequest = api_register(*apiClient, username, password, [this](int register_status) {
+			isAttemptingRegister.store(false);
+			webView.emitEventIfBrowserIsVisible(juce::Identifier{ "onRegisterEvent" }, register_status);
 			});
 		completion(REGISTER_ATTEMPT_ARGS_OK);
 	}
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+    Created: 19 Oct 2026 6:04:45am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+
+OfflineRenderer::OfflineRenderer(std::unique_ptr<juce::AudioFormatReader> audioReader, RenderState& renderState, VideoEncoder& encoder, GLuint fbo)
+    : reader(std::move(audioReader)), renderState(renderState), encoder(encoder), fbo(fbo), ringBuffer(2, 32768), readBuffer(2, RING_BUFFER_READ_SIZE) {
+    sampleRate = (juce::int64) reader->sampleRate;
+    frameRate = encoder.getFrameRate();
+    totalSamples = reader->lengthInSamples;
+    totalFrames = sampleRate > 0 ? (totalSamples * frameRate + sampleRate - 1) / sampleRate : 0;
+    DBG("Offline renderer created for " << totalSamples << " samples at " << sampleRate << "Hz (" << totalFrames << " frames).");
+}
+
+bool OfflineRenderer::start(const juce::String& outputFile, const VideoEncoder::RecordingOptions& options) {
+    if (totalFrames == 0) {
+        DBG("Offline renderer has nothing to render!");
+        return false;
+    }
+    // The recording clock starts at sample 0 of the file.
+    return encoder.startRecordingSession(outputFile, 0, (double) sampleRate, options);
+}
+
+bool OfflineRenderer::renderNextFrame() {
+    if (frameIndex >= totalFrames || !encoder.isActive())
+        return false;
+
+    juce::int64 frameStart = getFrameStartSample(frameIndex);
+    juce::int64 frameEnd = juce::jmin(getFrameStartSample(frameIndex + 1), totalSamples);
+    int numSamples = (int) (frameEnd - frameStart);
+
+    // Decode the audio belonging to this frame and run it through the same analysis as processBlock.
+    float leftRMS = 0, rightRMS = 0;
+    if (numSamples > 0) {
+        blockBuffer.setSize(2, numSamples, false, false, true);
+        reader->read(&blockBuffer, 0, numSamples, frameStart, true, true);
+        leftRMS = blockBuffer.getRMSLevel(0, 0, numSamples);
+        rightRMS = blockBuffer.getRMSLevel(1, 0, numSamples);
+        ringBuffer.writeSamples(blockBuffer, 0, numSamples);
+    }
+
+    ringBuffer.readSamples(readBuffer, RING_BUFFER_READ_SIZE);
+    juce::FloatVectorOperations::clear(visualizationBuffer, RING_BUFFER_READ_SIZE);
+    for (int i = 0; i < 2; ++i) { // Sum channels together
+        juce::FloatVectorOperations::add(visualizationBuffer, readBuffer.getReadPointer(i, 0), RING_BUFFER_READ_SIZE);
+    }
+
+    juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, fbo);
+    juce::gl::glViewport(0, 0, encoder.getWidth(), encoder.getHeight());
+    juce::OpenGLHelpers::clear(juce::Colours::black);
+
+    // Counted from the audio position at the live rate, rounded down like the live counter, so animations run
+    // at the same speed whatever the encoder's frame rate.
+    renderState.applyFrameUniforms({
+        .time = (unsigned int) (frameStart * TIME_UNIFORM_RATE / sampleRate),
+        .leftRMS = leftRMS,
+        .rightRMS = rightRMS,
+        .screenWidth = (float) encoder.getWidth(),
+        .screenHeight = (float) encoder.getHeight(),
+        .audioBufferTD = visualizationBuffer
+        });
+    renderState.render();
+
+    // The frame start sample maps back to exactly this frame on the encoder's audio clock, so every frame is written once.
+    encoder.addVideoFrame(frameStart);
+    juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, 0);
+
+    frameIndex++;
+    return frameIndex < totalFrames;
+}
+
+void OfflineRenderer::finish() {
+    DBG("Offline render finished after " << frameIndex << " of " << totalFrames << " frames.");
+    encoder.finishRecordingSession();
+}
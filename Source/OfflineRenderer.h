@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+    Created: 19 Oct 2026 6:04:45am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "RenderState.h"
+#include "RingBuffer.h"
+#include "VideoEncoder.h"
+
+// How long the live GL thread may spend rendering offline frames before it hands control back for a frame.
+#define OFFLINE_RENDER_BUDGET_MS 50
+
+/*
+    Renders an audio file to a video file frame by frame, as fast as the GPU and encoder allow.
+
+    The audio is decoded straight from the file rather than played through the audio device, and every frame
+    advances the audio by exactly one frame of the encoder's frame rate. Nothing here waits on the audio device or on
+    vsync, so it can be driven from the live GL thread or from a headless GL context.
+
+    All methods must be called on the thread that owns the GL context.
+*/
+class OfflineRenderer {
+public:
+    OfflineRenderer(std::unique_ptr<juce::AudioFormatReader> audioReader, RenderState& renderState, VideoEncoder& encoder, GLuint fbo);
+
+    bool start(const juce::String& outputFile, const VideoEncoder::RecordingOptions& options = {});
+
+    // Renders the next frame into the FBO and encodes it. Returns false once the whole file has been rendered.
+    bool renderNextFrame();
+
+    void finish();
+
+    juce::int64 getFramesRendered() const {
+        return frameIndex;
+    }
+
+    juce::int64 getTotalFrames() const {
+        return totalFrames;
+    }
+
+    double getProgress() const {
+        return totalFrames > 0 ? (double) frameIndex / (double) totalFrames : 1.0;
+    }
+
+private:
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    RenderState& renderState;
+    VideoEncoder& encoder;
+    GLuint fbo;
+
+    // The same analysis path as the live processor. Decoded audio goes through a RingBuffer so the shaders
+    // see exactly the inputs they would have seen during playback.
+    RingBuffer<float> ringBuffer;
+    juce::AudioBuffer<float> blockBuffer;
+    juce::AudioBuffer<GLfloat> readBuffer;
+    GLfloat visualizationBuffer[RING_BUFFER_READ_SIZE];
+
+    juce::int64 sampleRate; // Whole samples per second, so that frame boundaries can be computed exactly.
+    juce::int64 frameRate;
+    juce::int64 totalSamples = 0;
+    juce::int64 totalFrames = 0;
+    juce::int64 frameIndex = 0;
+
+    // The first audio sample covered by the given frame, rounded up. This is the inverse of AudioFrameClock.
+    juce::int64 getFrameStartSample(juce::int64 frame) const {
+        return (frame * sampleRate + frameRate - 1) / frameRate;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OfflineRenderer)
+};
@@ -14,16 +14,15 @@
 
 //==============================================================================
 OpenGLComponent::OpenGLComponent(AudioVisualiserAudioProcessor &p, ApplicationSettings& appSettings) : processor(p), appSettings(appSettings), ringBuffer(p.getRingBuffer()), readBuffer(2, RING_BUFFER_READ_SIZE) {
-    addRenderState(std::make_unique<Classic1_2D>(1, openGLContext));
-    addRenderState(std::make_unique<Classic2_2D>(2, openGLContext));
-    addRenderState(std::make_unique<Classic3_2D>(3, openGLContext));
-    addRenderState(std::make_unique<Classic4_2D>(4, openGLContext));
-    addRenderState(std::make_unique<TimeDomain1_2D>(5, openGLContext));
-    addRenderState(std::make_unique<TimeDomain2_2D>(6, openGLContext));
-    addRenderState(std::make_unique<TimeDomain3_2D>(7, openGLContext));
-    addRenderState(std::make_unique<SDF_1_2D>(8, openGLContext));
-    addRenderState(std::make_unique<AskAI>(9, openGLContext, appSettings));
+    for (int id = 1; id <= NUM_BUILT_IN_RENDER_STATES; id++)
+        addRenderState(createBuiltInRenderState(id, openGLContext));
+    addRenderState(std::make_unique<AskAI>(NUM_BUILT_IN_RENDER_STATES + 1, openGLContext, appSettings));
+    // The host keeps the parameter values, so they are the same as when the editor was last open.
+    for (int index = 0; index < (int) renderStates.size(); index++)
+        renderStates[index]->getParameters().attach(p.getParameters());
     
+    offlineFormatManager.registerBasicFormats();
+
     setOpaque(true); // Indicates that no part of this Component is transparent
     openGLContext.setRenderer(this); // Set this instance as the renderer for the context
     openGLContext.setContinuousRepainting(true); // Tell the context to repaint on a loop
@@ -75,11 +74,25 @@ void OpenGLComponent::newOpenGLContextCreated() {
     if (juce::gl::glCheckFramebufferStatus(juce::gl::GL_FRAMEBUFFER) != juce::gl::GL_FRAMEBUFFER_COMPLETE) {
         DBG("FBO creation incomplete!");
     }
+
+    previewEncoder = std::make_unique<VideoEncoder>(getPreviewDimension(videoEncoder->getWidth()), getPreviewDimension(videoEncoder->getHeight()),
+        STREAM_FRAME_RATE, videoEncoder->getDeviceContext());
+    juce::gl::glGenFramebuffers(1, &previewFbo);
+    juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, previewFbo);
+    juce::gl::glFramebufferTexture2D(juce::gl::GL_FRAMEBUFFER, juce::gl::GL_COLOR_ATTACHMENT0, juce::gl::GL_TEXTURE_2D, previewEncoder->getTextureID(), 0);
+    if (juce::gl::glCheckFramebufferStatus(juce::gl::GL_FRAMEBUFFER) != juce::gl::GL_FRAMEBUFFER_COMPLETE) {
+        DBG("Preview FBO creation incomplete!");
+    }
+    juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, 0);
 }
 
 void OpenGLComponent::renderOpenGL() {
     time++;
     juce::OpenGLHelpers::clear(juce::Colours::black);
+    // Scheduled cues run before the render state is read, so a preset change lands on this frame.
+    cueScheduler.runDueCues(processor.getAudioSamplePosition(), juce::Time::currentTimeMillis(), [this](const ScheduledCue& cue) {
+        runScheduledCue(cue);
+    });
     unsigned int currentState = selectedState.load();
     if (currentState < 1 || currentState > renderStates.size())
         return;
@@ -93,58 +106,73 @@ void OpenGLComponent::renderOpenGL() {
         DBG("Shader Program ID is invalid!");
         return;
     }
-    openGLContext.extensions.glUseProgram(progID);
 
-    GLuint timeUniform = openGLContext.extensions.glGetUniformLocation(renderState->getShaderProgramID(), "time");
-    openGLContext.extensions.glUniform1i(timeUniform, time);
-
-    GLuint leftRMSUniform = openGLContext.extensions.glGetUniformLocation(renderState->getShaderProgramID(), "leftRMS");
-    openGLContext.extensions.glUniform1f(leftRMSUniform, processor.getRMS(0));
-    GLuint rightRMSUniform = openGLContext.extensions.glGetUniformLocation(renderState->getShaderProgramID(), "rightRMS");
-    openGLContext.extensions.glUniform1f(rightRMSUniform, processor.getRMS(1));
-
-    GLuint screenWidthUniform = openGLContext.extensions.glGetUniformLocation(renderState->getShaderProgramID(), "screenWidth");
-    GLuint screenHeightUniform = openGLContext.extensions.glGetUniformLocation(renderState->getShaderProgramID(), "screenHeight");
-    auto scale = (float)openGLContext.getRenderingScale();
-    openGLContext.extensions.glUniform1f(screenWidthUniform, getWidth() * scale);
-    openGLContext.extensions.glUniform1f(screenHeightUniform, getHeight() * scale);
+    // Offline rendering takes over the GL thread until the whole file has been rendered.
+    OfflineRenderRequest* offlineRequest = pendingOfflineRender.exchange(nullptr);
+    if (offlineRequest) {
+        startOfflineRender(*offlineRequest, *renderState);
+        delete offlineRequest; // offlineRequest is created using new
+    }
+    if (offlineRenderer) {
+        renderOfflineFrames();
+        return;
+    }
 
     ringBuffer.readSamples(readBuffer, RING_BUFFER_READ_SIZE);
     juce::FloatVectorOperations::clear(visualizationBuffer, RING_BUFFER_READ_SIZE);
     for (int i = 0; i < 2; ++i) { // Sum channels together
         juce::FloatVectorOperations::add(visualizationBuffer, readBuffer.getReadPointer(i, 0), RING_BUFFER_READ_SIZE);
     }
-    GLuint visualizationUniform = openGLContext.extensions.glGetUniformLocation(renderState->getShaderProgramID(), "audioBufferTD");
-    openGLContext.extensions.glUniform1fv(visualizationUniform, RING_BUFFER_READ_SIZE, visualizationBuffer);
+
+    renderState->prepareFrame();
+    auto scale = (float)openGLContext.getRenderingScale();
+    renderState->applyFrameUniforms({
+        .time = time,
+        .leftRMS = processor.getRMS(0),
+        .rightRMS = processor.getRMS(1),
+        .screenWidth = getWidth() * scale,
+        .screenHeight = getHeight() * scale,
+        .audioBufferTD = visualizationBuffer
+        });
 
     // Video Encoding
-    juce::String* filePtr = pendingEncoderFileName.exchange(nullptr);
-    if (filePtr) {
-        videoEncoder->startRecordingSession(*filePtr);
-        delete filePtr; // filePtr is created using new
+    RecordingRequest* recordingRequest = pendingRecording.exchange(nullptr);
+    if (recordingRequest) {
+        // Live outputs encode on their own threads, so the GL thread only pays for the texture copies and the
+        // two outputs encode in parallel.
+        recordingRequest->options.encodeOnThread = true;
+        recordingRequest->previewOptions.encodeOnThread = true;
+        juce::int64 startPosition = processor.getAudioSamplePosition();
+        if (videoEncoder->startRecordingSession(recordingRequest->outputFile, startPosition, processor.getSampleRate(), recordingRequest->options)
+            && recordingRequest->previewOutput.isNotEmpty()) {
+            if (!previewEncoder->startRecordingSession(recordingRequest->previewOutput, startPosition, processor.getSampleRate(), recordingRequest->previewOptions))
+                DBG("The preview output could not be started. Recording without it.");
+        }
+        delete recordingRequest; // recordingRequest is created using new
     }
     if (pendingStop.exchange(false)) {
         videoEncoder->finishRecordingSession();
+        previewEncoder->finishRecordingSession();
+        // The encoder keeps its texture ID and CUDA device when resized, so the FBO stays attached to it.
         if (videoEncoder->getWidth() != (int) videoEncoderWidth.load() || videoEncoder->getHeight() != (int) videoEncoderHeight.load()) {
-            DBG("Resetting video encoder now!");
-            videoEncoder.reset(); // Calls delete on the old videoEncoder object.
-            videoEncoder = std::make_unique<VideoEncoder>((int) videoEncoderWidth.load(), (int) videoEncoderHeight.load()); // Create the new videoEncoder object.
-            DBG("New encoder initialised!");
-
-            // Handle removing the old frame buffer object with the old texture attached and then creating a new one with the correct texture ID.
-            juce::gl::glDeleteFramebuffers(1, &fbo);
-            juce::gl::glGenFramebuffers(1, &fbo);
-            juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, fbo);
-            juce::gl::glFramebufferTexture2D(juce::gl::GL_FRAMEBUFFER, juce::gl::GL_COLOR_ATTACHMENT0, juce::gl::GL_TEXTURE_2D, videoEncoder->getTextureID(), 0);
-            juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, 0); // Always good to unbind the frame buffer even though we are just going to bind it again straight away anyway.
-            DBG("Frame buffer has been re-created!");
+            DBG("Resizing video encoder now!");
+            if (!videoEncoder->resize((int) videoEncoderWidth.load(), (int) videoEncoderHeight.load()))
+                DBG("Video encoder could not be resized!");
+            if (!previewEncoder->resize(getPreviewDimension((int) videoEncoderWidth.load()), getPreviewDimension((int) videoEncoderHeight.load())))
+                DBG("Preview encoder could not be resized!");
         }
     }
     if (videoEncoder->isActive()) {
         juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, fbo);
         juce::gl::glViewport(0, 0, (int) videoEncoderWidth.load(), (int) videoEncoderHeight.load());
         renderState->render();
-        videoEncoder->addVideoFrame();
+        if (previewEncoder->isActive()) {
+            juce::gl::glBindFramebuffer(juce::gl::GL_READ_FRAMEBUFFER, fbo);
+            juce::gl::glBindFramebuffer(juce::gl::GL_DRAW_FRAMEBUFFER, previewFbo);
+            juce::gl::glBlitFramebuffer(0, 0, videoEncoder->getWidth(), videoEncoder->getHeight(), 0, 0, previewEncoder->getWidth(), previewEncoder->getHeight(), juce::gl::GL_COLOR_BUFFER_BIT, juce::gl::GL_LINEAR);
+        }
+        videoEncoder->addVideoFrame(processor.getAudioSamplePosition());
+        previewEncoder->addVideoFrame(processor.getAudioSamplePosition());
     }
 
     juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, 0);
@@ -162,5 +190,90 @@ void OpenGLComponent::resetVideoRecorder(int width, int height) {
     pendingStop.store(true);
 }
 
+void OpenGLComponent::startOfflineRender(const OfflineRenderRequest& request, RenderState& renderState) {
+    if (videoEncoder->isActive()) {
+        DBG("Cannot start an offline render while a recording is in progress!");
+        return;
+    }
+    std::unique_ptr<juce::AudioFormatReader> reader(offlineFormatManager.createReaderFor(request.audioFile));
+    if (reader == nullptr) {
+        DBG("The audio format reader for the offline render is null!");
+        return;
+    }
+    offlineRenderer = std::make_unique<OfflineRenderer>(std::move(reader), renderState, *videoEncoder, fbo);
+    if (!offlineRenderer->start(request.outputFile, request.options)) {
+        DBG("Failed to start the offline render!");
+        offlineRenderer.reset();
+        return;
+    }
+    offlineRenderProgress.store(0.0);
+    offlineRendering.store(true);
+    // Don't let vsync throttle the export.
+    openGLContext.setSwapInterval(0);
+}
+
+void OpenGLComponent::renderOfflineFrames() {
+    // Render as many frames as fit in the budget, then give the frame back so the window stays responsive.
+    double budgetEnd = juce::Time::getMillisecondCounterHiRes() + OFFLINE_RENDER_BUDGET_MS;
+    bool moreFrames = true;
+    while (moreFrames && !pendingStop.load() && juce::Time::getMillisecondCounterHiRes() < budgetEnd)
+        moreFrames = offlineRenderer->renderNextFrame();
+    offlineRenderProgress.store(offlineRenderer->getProgress());
+
+    // Show the latest rendered frame as a preview.
+    auto scale = openGLContext.getRenderingScale();
+    juce::gl::glBindFramebuffer(juce::gl::GL_READ_FRAMEBUFFER, fbo);
+    juce::gl::glBindFramebuffer(juce::gl::GL_DRAW_FRAMEBUFFER, 0);
+    juce::gl::glBlitFramebuffer(0, 0, videoEncoder->getWidth(), videoEncoder->getHeight(), 0, 0, (GLint) (getWidth() * scale), (GLint) (getHeight() * scale), juce::gl::GL_COLOR_BUFFER_BIT, juce::gl::GL_LINEAR);
+    juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, 0);
+
+    // A stop request cancels the render. pendingStop is left set so the normal path can still handle a resize.
+    if (!moreFrames || pendingStop.load()) {
+        offlineRenderer->finish();
+        offlineRenderer.reset();
+        offlineRendering.store(false);
+        openGLContext.setSwapInterval(1);
+    }
+}
+
+void OpenGLComponent::runScheduledCue(const ScheduledCue& cue) {
+    unsigned int numStates = (unsigned int) renderStates.size();
+    unsigned int state = selectedState.load();
+    if (numStates == 0)
+        return;
+    juce::Component::SafePointer<OpenGLComponent> safeThis(this);
+    switch (cue.cueId) {
+    case CUE_PARAM:
+        if (state >= 1 && state <= numStates)
+            renderStates[state - 1]->setParameter(cue.param, cue.getValue());
+        return;
+    case SOCKET_CUE_RENDER_STATE_INCREMENT:
+        state = state % numStates + 1;
+        break;
+    case SOCKET_CUE_RENDER_STATE_DECREMENT:
+        state = state <= 1 ? numStates : state - 1;
+        break;
+    default:
+        juce::MessageManager::callAsync([safeThis, cueId = cue.cueId, body = cue.getValue()]() {
+            if (safeThis != nullptr && safeThis->onScheduledCue)
+                safeThis->onScheduledCue(cueId, body);
+        });
+        return;
+    }
+    selectedState.store(state);
+    juce::MessageManager::callAsync([safeThis, state]() {
+        if (safeThis != nullptr && safeThis->onScheduledStateChange)
+            safeThis->onScheduledStateChange(state);
+    });
+}
+
 void OpenGLComponent::openGLContextClosing() {
+    for (auto& renderState : renderStates)
+        renderState->shutdown();
+    // The encoder owns a GL texture and its CUDA registration, so it has to go while the context is still current.
+    offlineRenderer.reset();
+    previewEncoder.reset(); // Holds a reference to the CUDA device of videoEncoder.
+    videoEncoder.reset();
+    juce::gl::glDeleteFramebuffers(1, &previewFbo);
+    juce::gl::glDeleteFramebuffers(1, &fbo);
 }
\ No newline at end of file
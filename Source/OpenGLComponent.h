@@ -19,12 +19,30 @@
 #include "VideoEncoder.h"
 #include "RingBuffer.h"
 #include "Settings.h"
+#include "OfflineRenderer.h"
+#include "CueScheduler.h"
 
 //==============================================================================
 /*
 */
 
-#define RING_BUFFER_READ_SIZE 256
+#define PREVIEW_DOWNSCALE 3 // The preview output is a third of the recording's width and height.
+
+// Handed from the message thread to the GL thread to start a live recording. If previewOutput is set, a downscaled
+// copy of the same render is encoded to it at the same time.
+struct RecordingRequest {
+    juce::String outputFile;
+    VideoEncoder::RecordingOptions options;
+    juce::String previewOutput = "";
+    VideoEncoder::RecordingOptions previewOptions = {};
+};
+
+// Handed from the message thread to the GL thread to start an offline render of an audio file.
+struct OfflineRenderRequest {
+    juce::File audioFile;
+    juce::String outputFile;
+    VideoEncoder::RecordingOptions options;
+};
 
 class OpenGLComponent : public juce::Component, public juce::OpenGLRenderer {
 
@@ -44,14 +62,45 @@ public:
         selectedState.store(state);
     }
 
+    unsigned int getSelectedState() {
+        return selectedState.load();
+    }
+
     void resetVideoRecorder(int width, int height);
 
     juce::OpenGLContext openGLContext;
     juce::Rectangle<int> cacheBounds;
     bool openGLViewportActive = true;
 
-    std::atomic<juce::String*> pendingEncoderFileName{ nullptr };
+    // Requests from the message thread. The GL thread takes them with exchange() and deletes them.
+    std::atomic<RecordingRequest*> pendingRecording{ nullptr };
     std::atomic<bool> pendingStop{ false };
+    std::atomic<OfflineRenderRequest*> pendingOfflineRender{ nullptr };
+
+    // Called on the message thread after a scheduled cue changed the render state on the GL thread.
+    std::function<void(unsigned int state)> onScheduledStateChange;
+    // Called on the message thread for scheduled cues that don't affect rendering, such as play and stop.
+    std::function<void(int cueId, const juce::var& body)> onScheduledCue;
+
+    CueScheduler& getCueScheduler() {
+        return cueScheduler;
+    }
+
+    juce::int64 getAudioSamplePosition() {
+        return processor.getAudioSamplePosition();
+    }
+
+    double getSampleRate() {
+        return processor.getSampleRate();
+    }
+
+    bool isOfflineRendering() {
+        return offlineRendering.load();
+    }
+
+    double getOfflineRenderProgress() {
+        return offlineRenderProgress.load();
+    }
 
     void setBoundsScaled(juce::Rectangle<int> bounds) {
         if (openGLViewportActive) {
@@ -72,6 +121,15 @@ public:
         return renderStates[id].get()->getRenderProfile();
     }
 
+    // Called on the message thread. Render states keep their parameters in atomics for the GL thread to read,
+    // and pass them on to the host, which saves them and can automate them.
+    bool setRenderStateParameter(const juce::String& name, const juce::var& value) {
+        int index = (int) selectedState.load() - 1;
+        if (index < 0 || index >= (int) renderStates.size())
+            return false;
+        return renderStates[index]->setParameter(name, value);
+    }
+
     VideoEncoder* getVideoEncoder() { 
         return videoEncoder.get(); 
     }
@@ -104,12 +162,33 @@ private:
     unsigned int time = 0;
     std::vector<std::unique_ptr<RenderState>> renderStates;
 
+    CueScheduler cueScheduler;
+    void runScheduledCue(const ScheduledCue& cue);
+
     std::unique_ptr<VideoEncoder> videoEncoder;
     std::atomic<unsigned int> videoEncoderWidth{ 2 }, videoEncoderHeight{ 2 }; // 2 is just the minimum encoding size. The value is changed when the OpenGL Context is initialised.
 
     GLuint fbo;
     uint8_t* pixelBuffer;
 
+    // The preview output. The recording's FBO is blitted into previewFbo, so the GPU does the downscale and the
+    // scene is only rendered once. Shares the CUDA device of videoEncoder.
+    std::unique_ptr<VideoEncoder> previewEncoder;
+    GLuint previewFbo;
+
+    static int getPreviewDimension(int dimension) {
+        return juce::jmax(2, (dimension / PREVIEW_DOWNSCALE) & ~1); // Must be a multiple of 2.
+    }
+
+    // Offline rendering. Only touched on the GL thread apart from the atomics.
+    juce::AudioFormatManager offlineFormatManager;
+    std::unique_ptr<OfflineRenderer> offlineRenderer;
+    std::atomic<bool> offlineRendering{ false };
+    std::atomic<double> offlineRenderProgress{ 0.0 };
+
+    void startOfflineRender(const OfflineRenderRequest& request, RenderState& renderState);
+    void renderOfflineFrames();
+
     std::atomic<bool> fullScreenMode = { false };
 
     void addRenderState(std::unique_ptr<RenderState> state) {
@@ -0,0 +1,200 @@
+/*
+  ==============================================================================
+
+    OscCueListener.cpp
+    Created: 19 Oct 2026 6:25:55am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#include "OscCueListener.h"
+
+#define OSC_PARAM_PREFIX "/av/param/"
+
+static const struct {
+    const char* address;
+    int cueId;
+} oscAddresses[] = {
+    { "/av/play", SOCKET_CUE_PLAY },
+    { "/av/stop", SOCKET_CUE_STOP },
+    { "/av/state/next", SOCKET_CUE_RENDER_STATE_INCREMENT },
+    { "/av/state/prev", SOCKET_CUE_RENDER_STATE_DECREMENT },
+};
+
+// OSC strings are null terminated and padded to a multiple of 4 bytes. Returns nullptr if the string runs past size.
+static const char* readOscString(const char* data, int size, int& offset) {
+    const char* string = data + offset;
+    int length = 0;
+    while (offset + length < size && string[length] != '\0')
+        length++;
+    if (offset + length >= size)
+        return nullptr;
+    offset += (length + 4) & ~3;
+    return offset <= size ? string : nullptr;
+}
+
+// NTP timetag to Unix milliseconds. The special value 1 means "immediately", which is returned as 0.
+static juce::int64 timetagToMs(juce::uint64 timetag) {
+    if (timetag <= 1)
+        return 0;
+    juce::int64 seconds = (juce::int64) (timetag >> 32) - OSC_NTP_UNIX_OFFSET;
+    juce::int64 fractionMs = (juce::int64) (((timetag & 0xffffffffULL) * 1000) >> 32);
+    return seconds * 1000 + fractionMs;
+}
+
+OscCueListener::OscCueListener(SocketCueResolver& socketCueResolver) : juce::Thread("AV OSC Listener"), socketCueResolver(socketCueResolver) {
+}
+
+OscCueListener::~OscCueListener() {
+    stopListening();
+}
+
+bool OscCueListener::startListening(int port) {
+    if (isThreadRunning())
+        return true;
+    if (socket.getBoundPort() == -1 && !socket.bindToPort(port)) {
+        DBG("OSC cue listener failed to bind to UDP port " << port << ".");
+        return false;
+    }
+    DBG("OSC cue listener listening on UDP port " << socket.getBoundPort() << ".");
+    startThread();
+    return true;
+}
+
+void OscCueListener::stopListening() {
+    stopThread(OSC_POLL_TIMEOUT_MS * 10);
+    cancelPendingUpdate();
+    readyFifo.reset();
+}
+
+void OscCueListener::run() {
+    while (!threadShouldExit()) {
+        if (socket.waitUntilReady(true, OSC_POLL_TIMEOUT_MS) != 1)
+            continue;
+        int bytesRead = socket.read(packet, OSC_MAX_PACKET_SIZE, false);
+        if (bytesRead > 0)
+            parsePacket(packet, bytesRead, 0, 0);
+    }
+}
+
+void OscCueListener::parsePacket(const char* data, int size, juce::int64 dueMs, int depth) {
+    if (size < 4 || (size & 3) != 0)
+        return;
+
+    if (size >= 16 && memcmp(data, "#bundle", 8) == 0) {
+        if (depth >= OSC_MAX_BUNDLE_DEPTH)
+            return;
+        juce::int64 bundleDueMs = timetagToMs(juce::ByteOrder::bigEndianInt64(data + 8));
+        int offset = 16;
+        while (offset + 4 <= size) {
+            int elementSize = (int) juce::ByteOrder::bigEndianInt(data + offset);
+            offset += 4;
+            if (elementSize <= 0 || elementSize > size - offset)
+                return;
+            parsePacket(data + offset, elementSize, bundleDueMs, depth + 1);
+            offset += elementSize;
+        }
+        return;
+    }
+
+    OscCue cue;
+    if (!parseMessage(data, size, cue))
+        return;
+    if (dueMs <= juce::Time::currentTimeMillis())
+        pushReady(cue);
+    else if (!socketCueResolver.scheduleCue(cue.cueId, cue.param, cue.getValue(), CUE_CLOCK_WALL, dueMs))
+        DBG("OSC cue listener could not schedule a cue from a timed bundle.");
+}
+
+bool OscCueListener::parseMessage(const char* data, int size, OscCue& cue) {
+    int offset = 0;
+    const char* address = readOscString(data, size, offset);
+    if (address == nullptr)
+        return false;
+
+    bool found = false;
+    for (auto& entry : oscAddresses) {
+        if (strcmp(address, entry.address) == 0) {
+            cue.cueId = entry.cueId;
+            found = true;
+            break;
+        }
+    }
+    if (!found && strncmp(address, OSC_PARAM_PREFIX, strlen(OSC_PARAM_PREFIX)) == 0) {
+        const char* name = address + strlen(OSC_PARAM_PREFIX);
+        if (*name == '\0' || strlen(name) >= CUE_SCHEDULER_MAX_PARAM_LENGTH)
+            return false;
+        cue.cueId = CUE_PARAM;
+        strcpy(cue.param, name);
+        found = true;
+    }
+    if (!found) {
+        DBG("OSC cue listener ignored unknown address " << address << ".");
+        return false;
+    }
+
+    // Messages from old senders may have no type tag string at all, which is the same as no arguments.
+    if (offset >= size)
+        return true;
+    const char* typeTags = readOscString(data, size, offset);
+    if (typeTags == nullptr || typeTags[0] != ',')
+        return false;
+
+    switch (typeTags[1]) {
+    case '\0':
+        break;
+    case 'i':
+        if (size - offset < 4)
+            return false;
+        cue.valueType = CUE_VALUE_INT;
+        cue.intValue = (int) juce::ByteOrder::bigEndianInt(data + offset);
+        break;
+    case 'f': {
+        if (size - offset < 4)
+            return false;
+        juce::uint32 bits = juce::ByteOrder::bigEndianInt(data + offset);
+        cue.valueType = CUE_VALUE_FLOAT;
+        memcpy(&cue.floatValue, &bits, sizeof(float));
+        break;
+    }
+    case 's': {
+        const char* value = readOscString(data, size, offset);
+        if (value == nullptr || strlen(value) >= OSC_MAX_STRING_LENGTH)
+            return false;
+        cue.valueType = CUE_VALUE_STRING;
+        strcpy(cue.stringValue, value);
+        break;
+    }
+    case 'T':
+    case 'F':
+        cue.valueType = CUE_VALUE_INT;
+        cue.intValue = typeTags[1] == 'T' ? 1 : 0;
+        break;
+    default:
+        DBG("OSC cue listener ignored " << address << " because its argument type is not supported.");
+        return false;
+    }
+    return true;
+}
+
+void OscCueListener::pushReady(const OscCue& cue) {
+    const auto scope = readyFifo.write(1);
+    if (scope.blockSize1 == 0) {
+        DBG("OSC cue listener dropped a cue because the message thread is behind.");
+        return;
+    }
+    readyCues[(size_t) scope.startIndex1] = cue;
+    triggerAsyncUpdate();
+}
+
+void OscCueListener::handleAsyncUpdate() {
+    const auto scope = readyFifo.read(readyFifo.getNumReady());
+    scope.forEach([this](int index) {
+        const OscCue& cue = readyCues[(size_t) index];
+        if (cue.cueId == CUE_PARAM)
+            socketCueResolver.postParam(cue.param, cue.getValue());
+        else
+            socketCueResolver.postCue(cue.cueId, cue.getValue());
+    });
+}
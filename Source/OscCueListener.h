@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    OscCueListener.h
+    Created: 19 Oct 2026 6:25:55am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+#include "CueProtocol.h"
+#include "SocketCueResolver.h"
+
+#define OSC_CUE_DEFAULT_PORT 9000
+#define OSC_MAX_PACKET_SIZE 8192
+#define OSC_MAX_BUNDLE_DEPTH 8
+#define OSC_MAX_QUEUED_CUES 256
+#define OSC_MAX_STRING_LENGTH CUE_SCHEDULER_MAX_STRING_LENGTH // So a string in a timed bundle can be scheduled.
+#define OSC_POLL_TIMEOUT_MS 100 // Only bounds how long stopListening() takes.
+#define OSC_NTP_UNIX_OFFSET 2208988800LL // Seconds from the NTP epoch (1900) to the Unix epoch (1970).
+
+/*
+    A cue decoded from an OSC message. Fixed size so that it can be copied through the queues without allocating.
+    Only the first argument of a message is used.
+*/
+struct OscCue {
+    int cueId = 0; // A SOCKET_CUE id, or CUE_PARAM.
+    char param[CUE_SCHEDULER_MAX_PARAM_LENGTH] = {};
+    int valueType = CUE_VALUE_NONE;
+    int intValue = 0;
+    float floatValue = 0.0f;
+    char stringValue[OSC_MAX_STRING_LENGTH] = {};
+
+    juce::var getValue() const {
+        switch (valueType) {
+        case CUE_VALUE_INT:
+            return intValue;
+        case CUE_VALUE_FLOAT:
+            return floatValue;
+        case CUE_VALUE_STRING:
+            return juce::String::fromUTF8(stringValue);
+        default:
+            return juce::var();
+        }
+    }
+};
+
+/*
+    Receives OSC over UDP for lighting desks and show control software, and runs the messages as cues:
+
+        /av/play                SOCKET_CUE_PLAY
+        /av/stop                SOCKET_CUE_STOP
+        /av/state/next          SOCKET_CUE_RENDER_STATE_INCREMENT
+        /av/state/prev          SOCKET_CUE_RENDER_STATE_DECREMENT
+        /av/param/<name> value  Sets <name> on the selected render state.
+
+    Addresses are matched exactly; OSC wildcards are not supported. Bundles are unpacked, and the cues of a
+    bundle whose timetag is in the future go to the CueScheduler, so a desk can send cues ahead of time and have
+    them land together on the frame they were meant for.
+
+    Packets are read into a fixed buffer and decoded into fixed size OscCue structs, and ready cues reach the
+    message thread through a preallocated FIFO, so nothing is allocated per packet.
+*/
+class OscCueListener : private juce::Thread, private juce::AsyncUpdater {
+public:
+    OscCueListener(SocketCueResolver& socketCueResolver);
+    ~OscCueListener() override;
+
+    // Binds the port and starts the listener thread. Returns false if the port could not be bound.
+    bool startListening(int port = OSC_CUE_DEFAULT_PORT);
+    void stopListening();
+
+    bool isListening() {
+        return isThreadRunning();
+    }
+
+    int getPort() {
+        return socket.getBoundPort();
+    }
+
+private:
+    SocketCueResolver& socketCueResolver;
+    juce::DatagramSocket socket;
+
+    char packet[OSC_MAX_PACKET_SIZE];
+
+    // Cues ready to run. Written by the listener thread and read on the message thread.
+    juce::AbstractFifo readyFifo{ OSC_MAX_QUEUED_CUES };
+    std::array<OscCue, OSC_MAX_QUEUED_CUES> readyCues;
+
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    void parsePacket(const char* data, int size, juce::int64 dueMs, int depth);
+    bool parseMessage(const char* data, int size, OscCue& cue);
+    void pushReady(const OscCue& cue);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OscCueListener)
+};
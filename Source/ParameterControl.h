@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+
+    ParameterControl.h
+    Created: 19 Oct 2026 6:58:01am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterRegistry.h"
+
+#define PARAMETER_CONTROL_HEIGHT 40
+#define PARAMETER_CONTROL_REFRESH_HZ 15 // How often a showing control catches up with cues and automation.
+
+/*
+    The control a render profile shows for one of its render state's parameters: a slider for a number, or a
+    swatch that opens a colour selector for a colour.
+
+    Values can also be changed by cues and by the host, so a control that is showing reads its value back from
+    the registry a few times a second rather than being told.
+*/
+class ParameterControl : public juce::Component, private juce::Timer {
+public:
+    ParameterControl(ParameterRegistry& registry, int index) : registry(registry), index(index) {
+        const ParameterSpec& spec = registry.getSpec(index);
+        label.setText(spec.label, juce::dontSendNotification);
+        addAndMakeVisible(label);
+
+        if (spec.type == ParameterSpec::PARAMETER_COLOUR) {
+            swatch.onClick = [this]() {
+                openColourSelector();
+            };
+            addAndMakeVisible(swatch);
+        } else {
+            slider.setSliderStyle(juce::Slider::LinearHorizontal);
+            slider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 40, 18);
+            slider.setRange(spec.minValue, spec.maxValue, spec.type == ParameterSpec::PARAMETER_INT ? 1.0 : 0.0);
+            slider.onDragStart = [this]() {
+                dragging = true;
+                this->registry.beginGesture(this->index);
+            };
+            slider.onValueChange = [this]() {
+                this->registry.setValue(this->index, (float) slider.getValue());
+            };
+            slider.onDragEnd = [this]() {
+                dragging = false;
+                this->registry.endGesture(this->index);
+            };
+            addAndMakeVisible(slider);
+        }
+        refresh();
+    }
+
+    ~ParameterControl() override {
+        if (dragging)
+            registry.endGesture(index);
+    }
+
+    void resized() override {
+        auto bounds = getLocalBounds();
+        label.setBounds(bounds.removeFromTop(16));
+        swatch.setBounds(bounds.reduced(2));
+        slider.setBounds(bounds);
+    }
+
+    // Started only while showing, so hidden presets and headless renders don't poll.
+    void visibilityChanged() override {
+        updateTimer();
+    }
+
+    void parentHierarchyChanged() override {
+        updateTimer();
+    }
+
+private:
+    // Sets the parameter as the user picks, as one gesture for as long as it is open. Only holds a SafePointer,
+    // since the call out box can outlive the editor.
+    class ColourPicker : public juce::ColourSelector, private juce::ChangeListener {
+    public:
+        ColourPicker(ParameterControl& control)
+            : juce::ColourSelector(juce::ColourSelector::showColourspace | juce::ColourSelector::showSliders), control(&control) {
+            setCurrentColour(control.registry.getColour(control.index), juce::dontSendNotification);
+            setSize(220, 240);
+            addChangeListener(this);
+            control.registry.beginGesture(control.index);
+        }
+
+        ~ColourPicker() override {
+            if (control != nullptr)
+                control->registry.endGesture(control->index);
+        }
+
+    private:
+        juce::Component::SafePointer<ParameterControl> control;
+
+        void changeListenerCallback(juce::ChangeBroadcaster*) override {
+            if (control != nullptr) {
+                control->registry.setColour(control->index, getCurrentColour());
+                control->refresh();
+            }
+        }
+    };
+
+    ParameterRegistry& registry;
+    int index;
+
+    bool dragging = false;
+
+    juce::Label label;
+    juce::Slider slider;
+    juce::TextButton swatch;
+
+    void openColourSelector() {
+        juce::CallOutBox::launchAsynchronously(std::make_unique<ColourPicker>(*this), swatch.getScreenBounds(), nullptr);
+    }
+
+    void refresh() {
+        if (registry.getSpec(index).type == ParameterSpec::PARAMETER_COLOUR) {
+            swatch.setColour(juce::TextButton::buttonColourId, registry.getColour(index));
+            return;
+        }
+        if (!slider.isMouseButtonDown())
+            slider.setValue(registry.getValue(index), juce::dontSendNotification);
+    }
+
+    void updateTimer() {
+        if (isShowing())
+            startTimerHz(PARAMETER_CONTROL_REFRESH_HZ);
+        else
+            stopTimer();
+    }
+
+    void timerCallback() override {
+        refresh();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterControl)
+};
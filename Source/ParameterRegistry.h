@@ -0,0 +1,356 @@
+/*
+  ==============================================================================
+
+    ParameterRegistry.h
+    Created: 19 Oct 2026 6:58:01am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <atomic>
+
+#define PARAMETER_COLOUR_CHANNELS 3 // A colour is automated as red, green and blue host parameters.
+
+// A parameter a render state declares. Its name is the uniform it sets and the name cues use for it.
+struct ParameterSpec {
+    enum Type { PARAMETER_FLOAT, PARAMETER_INT, PARAMETER_COLOUR };
+
+    Type type = PARAMETER_FLOAT;
+    juce::String name;
+    juce::String label; // Shown next to its control and to the host.
+    float minValue = 0.0f, maxValue = 1.0f, defaultValue = 0.0f; // Unused for colours.
+    juce::Colour defaultColour; // For colours only. Alpha is ignored.
+
+    static ParameterSpec floatParameter(const juce::String& name, const juce::String& label, float minValue, float maxValue, float defaultValue) {
+        return { PARAMETER_FLOAT, name, label, minValue, maxValue, defaultValue, {} };
+    }
+
+    static ParameterSpec intParameter(const juce::String& name, const juce::String& label, int minValue, int maxValue, int defaultValue) {
+        return { PARAMETER_INT, name, label, (float) minValue, (float) maxValue, (float) defaultValue, {} };
+    }
+
+    static ParameterSpec colourParameter(const juce::String& name, const juce::String& label, juce::Colour defaultColour) {
+        return { PARAMETER_COLOUR, name, label, 0.0f, 1.0f, 0.0f, defaultColour };
+    }
+};
+
+// The id of a preset parameter in the host, such as "preset3.mode".
+inline juce::String getParameterID(int presetId, const juce::String& name) {
+    return "preset" + juce::String(presetId) + "." + name;
+}
+
+/*
+    The parameters of one render state, as declared by it.
+
+    Every value is held in an atomic, so it can be set from any thread: by its control on the message thread, by a
+    cue on the message thread or on the GL thread, and by host automation on whatever thread the host uses. The GL
+    thread reads each value once per frame in applyUniforms() and sets the uniform of the same name, so a shader
+    only has to declare "uniform float name;", "uniform int name;" or "uniform vec3 name;" to use one.
+
+    Once attached to the processor's AudioProcessorValueTreeState, host automation sets the values, and values
+    set here are passed on to the host on the message thread. A control being dragged wraps its changes in
+    beginGesture() and endGesture(), so the host records one gesture for the whole drag. Any other change is a
+    gesture of its own. A render state that is never attached, such as one rendering headless, just uses its own
+    values.
+*/
+class ParameterRegistry : private juce::AudioProcessorValueTreeState::Listener, private juce::AsyncUpdater {
+public:
+    // presetId names the host parameters the registry follows once attached.
+    ParameterRegistry(int presetId, const std::vector<ParameterSpec>& specs) {
+        for (const auto& spec : specs) {
+            auto entry = std::make_unique<Entry>();
+            entry->spec = spec;
+            juce::String id = getParameterID(presetId, spec.name);
+            entry->numChannels = spec.type == ParameterSpec::PARAMETER_COLOUR ? PARAMETER_COLOUR_CHANNELS : 1;
+            for (int channel = 0; channel < entry->numChannels; channel++)
+                entry->hostIDs[channel] = entry->numChannels == 1 ? id : getChannelID(id, channel);
+            entry->value.store(spec.defaultValue);
+            entry->colour.store(spec.defaultColour.withAlpha(1.0f).getARGB());
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    ~ParameterRegistry() override {
+        detach();
+    }
+
+    // Adds the host parameters of a preset. Called by the processor for every built in preset, before any
+    // render state exists.
+    static void addToLayout(juce::AudioProcessorValueTreeState::ParameterLayout& layout, int presetId, const std::vector<ParameterSpec>& specs) {
+        for (const auto& spec : specs) {
+            juce::String id = getParameterID(presetId, spec.name);
+            juce::String name = "Preset " + juce::String(presetId) + " " + spec.label;
+            switch (spec.type) {
+            case ParameterSpec::PARAMETER_FLOAT:
+                layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ id, 1 }, name,
+                    juce::NormalisableRange<float>(spec.minValue, spec.maxValue), spec.defaultValue));
+                break;
+            case ParameterSpec::PARAMETER_INT:
+                layout.add(std::make_unique<juce::AudioParameterInt>(juce::ParameterID{ id, 1 }, name,
+                    (int) spec.minValue, (int) spec.maxValue, (int) spec.defaultValue));
+                break;
+            case ParameterSpec::PARAMETER_COLOUR:
+                for (int channel = 0; channel < PARAMETER_COLOUR_CHANNELS; channel++) {
+                    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ getChannelID(id, channel), 1 },
+                        name + " " + getChannelName(channel), juce::NormalisableRange<float>(0.0f, 1.0f), getChannel(spec.defaultColour, channel)));
+                }
+                break;
+            }
+        }
+    }
+
+    // Message thread. Takes the host's current values, and follows them from then on.
+    void attach(juce::AudioProcessorValueTreeState& parameters) {
+        detach();
+        host.store(&parameters);
+        for (auto& entry : entries) {
+            for (int channel = 0; channel < entry->numChannels; channel++) {
+                entry->hostParameters[channel] = parameters.getParameter(entry->hostIDs[channel]);
+                if (entry->hostParameters[channel] == nullptr)
+                    DBG("The host has no parameter " << entry->hostIDs[channel] << ".");
+            }
+        }
+        for (auto& entry : entries) {
+            for (int channel = 0; channel < entry->numChannels; channel++) {
+                if (entry->hostParameters[channel] == nullptr)
+                    continue;
+                const juce::String& id = entry->hostIDs[channel];
+                parameters.addParameterListener(id, this);
+                parameterChanged(id, parameters.getRawParameterValue(id)->load());
+                if (entry->gestures > 0)
+                    entry->hostParameters[channel]->beginChangeGesture(); // Attached mid drag.
+            }
+        }
+    }
+
+    void detach() {
+        auto* parameters = host.load();
+        if (parameters == nullptr)
+            return;
+        handleUpdateNowIfNeeded(); // Values set just before, so the host still gets them.
+        for (int i = 0; i < (int) entries.size(); i++) {
+            if (entries[i]->gestures > 0) {
+                entries[i]->gestures = 1;
+                endGesture(i);
+            }
+        }
+        host.store(nullptr);
+        for (auto& entry : entries) {
+            for (int channel = 0; channel < entry->numChannels; channel++) {
+                if (entry->hostParameters[channel] != nullptr)
+                    parameters->removeParameterListener(entry->hostIDs[channel], this);
+            }
+        }
+        for (auto& entry : entries)
+            std::fill(std::begin(entry->hostParameters), std::end(entry->hostParameters), nullptr);
+    }
+
+    // Message thread. Called as a control starts being dragged. Changes until endGesture() are sent to the host
+    // as one gesture.
+    void beginGesture(int index) {
+        Entry& entry = *entries[index];
+        if (entry.gestures++ > 0)
+            return;
+        for (auto* parameter : entry.hostParameters) {
+            if (parameter != nullptr)
+                parameter->beginChangeGesture();
+        }
+    }
+
+    void endGesture(int index) {
+        Entry& entry = *entries[index];
+        if (entry.gestures == 0 || --entry.gestures > 0)
+            return;
+        handleUpdateNowIfNeeded(); // The last value of the drag belongs inside the gesture.
+        for (auto* parameter : entry.hostParameters) {
+            if (parameter != nullptr)
+                parameter->endChangeGesture();
+        }
+    }
+
+    int size() const {
+        return (int) entries.size();
+    }
+
+    const ParameterSpec& getSpec(int index) const {
+        return entries[index]->spec;
+    }
+
+    int indexOf(const juce::String& name) const {
+        for (int i = 0; i < (int) entries.size(); i++) {
+            if (entries[i]->spec.name == name)
+                return i;
+        }
+        return -1;
+    }
+
+    // Any thread. Sets a parameter from a cue. Numbers are clamped to the parameter's range. Colours may be
+    // "#RRGGBB", "AARRGGBB", an ARGB integer or an array of red, green and blue from 0 to 1.
+    // Returns false if there is no such parameter or the value doesn't fit it.
+    bool set(const juce::String& name, const juce::var& value) {
+        int index = indexOf(name);
+        if (index < 0)
+            return false;
+        if (entries[index]->spec.type != ParameterSpec::PARAMETER_COLOUR) {
+            bool isNumber = value.isInt() || value.isInt64() || value.isDouble() || value.isBool();
+            if (!isNumber && !(value.isString() && value.toString().trim().isNotEmpty() && value.toString().trim().containsOnly("0123456789.-+eE")))
+                return false;
+            setValue(index, (float) value);
+            return true;
+        }
+        juce::Colour colour;
+        if (!parseColour(value, colour))
+            return false;
+        setColour(index, colour);
+        return true;
+    }
+
+    // Any thread.
+    void setValue(int index, float newValue) {
+        const auto& spec = entries[index]->spec;
+        newValue = juce::jlimit(spec.minValue, spec.maxValue, newValue);
+        if (spec.type == ParameterSpec::PARAMETER_INT)
+            newValue = (float) juce::roundToInt(newValue);
+        if (entries[index]->value.exchange(newValue) != newValue)
+            changed(index);
+    }
+
+    void setColour(int index, juce::Colour newColour) {
+        if (entries[index]->colour.exchange(newColour.withAlpha(1.0f).getARGB()) != newColour.withAlpha(1.0f).getARGB())
+            changed(index);
+    }
+
+    float getValue(int index) const {
+        return entries[index]->value.load();
+    }
+
+    juce::Colour getColour(int index) const {
+        return juce::Colour(entries[index]->colour.load());
+    }
+
+    // GL thread, with the program in use. Reads every value once and sets its uniform.
+    void applyUniforms(juce::OpenGLContext& context, GLuint progID) {
+        for (auto& entry : entries) {
+            GLint location = context.extensions.glGetUniformLocation(progID, entry->spec.name.toRawUTF8());
+            if (location < 0)
+                continue; // Not used by this shader.
+            switch (entry->spec.type) {
+            case ParameterSpec::PARAMETER_FLOAT:
+                context.extensions.glUniform1f(location, entry->value.load());
+                break;
+            case ParameterSpec::PARAMETER_INT:
+                context.extensions.glUniform1i(location, (GLint) entry->value.load());
+                break;
+            case ParameterSpec::PARAMETER_COLOUR: {
+                juce::Colour colour(entry->colour.load());
+                context.extensions.glUniform3f(location, colour.getFloatRed(), colour.getFloatGreen(), colour.getFloatBlue());
+                break;
+            }
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        ParameterSpec spec;
+        std::atomic<float> value{ 0.0f };
+        std::atomic<juce::uint32> colour{ 0 }; // ARGB, for colours.
+        std::atomic<bool> dirty{ false }; // Set here and not yet passed on to the host.
+        int gestures = 0; // Controls dragging it. Message thread only, like hostParameters.
+        int numChannels = 1;
+        juce::String hostIDs[PARAMETER_COLOUR_CHANNELS]; // Fixed once constructed, since the host thread reads them.
+        juce::RangedAudioParameter* hostParameters[PARAMETER_COLOUR_CHANNELS] = {};
+    };
+
+    std::vector<std::unique_ptr<Entry>> entries; // Fixed once constructed, so any thread can index it.
+    std::atomic<juce::AudioProcessorValueTreeState*> host{ nullptr }; // Read by changed() on any thread.
+
+    static juce::String getChannelID(const juce::String& id, int channel) {
+        return id + "." + juce::String::charToString("rgb"[channel]);
+    }
+
+    static juce::String getChannelName(int channel) {
+        return channel == 0 ? "Red" : channel == 1 ? "Green" : "Blue";
+    }
+
+    static float getChannel(juce::Colour colour, int channel) {
+        return channel == 0 ? colour.getFloatRed() : channel == 1 ? colour.getFloatGreen() : colour.getFloatBlue();
+    }
+
+    static bool parseColour(const juce::var& value, juce::Colour& colour) {
+        if (value.isInt() || value.isInt64()) {
+            colour = juce::Colour((juce::uint32) (juce::int64) value);
+            return true;
+        }
+        if (auto* channels = value.getArray()) {
+            if (channels->size() < PARAMETER_COLOUR_CHANNELS)
+                return false;
+            colour = juce::Colour::fromFloatRGBA((float) (*channels)[0], (float) (*channels)[1], (float) (*channels)[2], 1.0f);
+            return true;
+        }
+        juce::String hex = value.toString().trim().trimCharactersAtStart("#");
+        if (!value.isString() || !hex.containsOnly("0123456789abcdefABCDEF") || (hex.length() != 6 && hex.length() != 8))
+            return false;
+        colour = juce::Colour::fromString(hex.length() == 6 ? "ff" + hex : hex);
+        return true;
+    }
+
+    void changed(int index) {
+        if (host.load() == nullptr)
+            return;
+        entries[index]->dirty.store(true);
+        triggerAsyncUpdate();
+    }
+
+    // Host automation, on any thread. Values from the host aren't passed back to it.
+    void parameterChanged(const juce::String& parameterID, float newValue) override {
+        for (auto& entry : entries) {
+            int channel = (int) (std::find(entry->hostIDs, entry->hostIDs + entry->numChannels, parameterID) - entry->hostIDs);
+            if (channel == entry->numChannels)
+                continue;
+            if (entry->spec.type != ParameterSpec::PARAMETER_COLOUR) {
+                entry->value.store(newValue);
+                return;
+            }
+            // Only this channel changes, whatever the others are changed to meanwhile.
+            juce::uint32 expected = entry->colour.load();
+            for (;;) {
+                juce::Colour colour(expected);
+                juce::uint8 level = (juce::uint8) juce::roundToInt(juce::jlimit(0.0f, 1.0f, newValue) * 255.0f);
+                colour = juce::Colour(channel == 0 ? level : colour.getRed(), channel == 1 ? level : colour.getGreen(), channel == 2 ? level : colour.getBlue());
+                if (entry->colour.compare_exchange_weak(expected, colour.getARGB()))
+                    break;
+            }
+            return;
+        }
+    }
+
+    // Message thread. Passes values set here on to the host, so it can record them as automation.
+    void handleAsyncUpdate() override {
+        for (auto& entry : entries) {
+            if (!entry->dirty.exchange(false))
+                continue;
+            juce::Colour colour(entry->colour.load());
+            for (int channel = 0; channel < PARAMETER_COLOUR_CHANNELS; channel++) {
+                auto* parameter = entry->hostParameters[channel];
+                if (parameter == nullptr)
+                    continue;
+                float value = entry->spec.type == ParameterSpec::PARAMETER_COLOUR ? getChannel(colour, channel) : entry->value.load();
+                if (entry->gestures > 0) {
+                    parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+                } else {
+                    parameter->beginChangeGesture();
+                    parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+                    parameter->endChangeGesture();
+                }
+            }
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterRegistry)
+};
@@ -12,7 +12,7 @@
 
 //==============================================================================
 AudioVisualiserAudioProcessorEditor::AudioVisualiserAudioProcessorEditor (AudioVisualiserAudioProcessor& p)
-    : AudioProcessorEditor(&p), audioProcessor(p), appSettings(this), loginComponent(appSettings), openGLComponent(p, appSettings), selectorPanel(p, openGLComponent, appSettings), tvOverlayComponent(openGLComponent), launchRecorder("Export"), login("Login"), videoComponent(openGLComponent), socketCueResolver(selectorPanel), globalSocketHandler(socketCueResolver) {
+    : AudioProcessorEditor(&p), audioProcessor(p), appSettings(this, p.getSettingsStore()), loginComponent(appSettings), openGLComponent(p, appSettings), selectorPanel(p, openGLComponent, appSettings), tvOverlayComponent(openGLComponent), launchRecorder("Export"), login("Login"), videoComponent(openGLComponent, appSettings), socketCueResolver(selectorPanel, openGLComponent), featureBroadcaster(p, openGLComponent), globalSocketHandler(socketCueResolver, featureBroadcaster), oscCueListener(socketCueResolver), webSocketServer(socketCueResolver, featureBroadcaster) {
     width = 1080;
     height = 544;
     setSize (width, height);
@@ -56,11 +56,18 @@ AudioVisualiserAudioProcessorEditor::AudioVisualiserAudioProcessorEditor (AudioV
         };    
     addAndMakeVisible(login);
 
+    featureBroadcaster.setRate(appSettings.getFeatureRate());
+    featureBroadcaster.start();
     globalSocketHandler.startListening();
+    oscCueListener.startListening();
+    webSocketServer.startListening();
 }
 
 AudioVisualiserAudioProcessorEditor::~AudioVisualiserAudioProcessorEditor() {
+    featureBroadcaster.stop();
     globalSocketHandler.destroy();
+    oscCueListener.stopListening();
+    webSocketServer.destroy();
 }
 
 //==============================================================================
@@ -17,6 +17,9 @@
 #include "LoginComponent.h"
 #include "GlobalSocketHandler.h"
 #include "SocketCueResolver.h"
+#include "OscCueListener.h"
+#include "FeatureBroadcaster.h"
+#include "WebSocketServer.h"
 
 class ApplicationSettings;
 
@@ -45,6 +48,14 @@ public:
         return globalSocketHandler;
 	}
 
+    FeatureBroadcaster& getFeatureBroadcaster() {
+        return featureBroadcaster;
+    }
+
+    WebSocketServer& getWebSocketServer() {
+        return webSocketServer;
+    }
+
 private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
@@ -66,7 +77,12 @@ private:
     juce::TextButton launchRecorder, login;
 
     SocketCueResolver socketCueResolver;
+    FeatureBroadcaster featureBroadcaster;
     GlobalSocketHandler globalSocketHandler;
+    OscCueListener oscCueListener;
+    WebSocketServer webSocketServer;
+
+    juce::SharedResourcePointer<WebViewResources> webViewResources; // Indexes ui.zip up front and keeps its cache while windows come and go.
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioVisualiserAudioProcessorEditor)
 };
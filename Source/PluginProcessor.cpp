@@ -8,6 +8,7 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "PresetParameters.h"
 
 //==============================================================================
 AudioVisualiserAudioProcessor::AudioVisualiserAudioProcessor()
@@ -25,6 +26,7 @@ AudioVisualiserAudioProcessor::AudioVisualiserAudioProcessor()
     ringBuffer = std::make_unique<RingBuffer<float>>(2, 32768); // 32768 covers hopefully all sample sizes;
     formatManager.registerBasicFormats();
     transport.addChangeListener(this);
+    restoreParameters(settingsStore.takeLoadedParameters());
 }
 
 AudioVisualiserAudioProcessor::~AudioVisualiserAudioProcessor()
@@ -175,15 +177,27 @@ juce::AudioProcessorEditor* AudioVisualiserAudioProcessor::createEditor()
 //==============================================================================
 void AudioVisualiserAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    settingsStore.getState(destData, parameters.copyState());
 }
 
 void AudioVisualiserAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    restoreParameters(settingsStore.setState(data, sizeInBytes));
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout AudioVisualiserAudioProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    for (int id = 1; id <= NUM_BUILT_IN_RENDER_STATES; id++)
+        ParameterRegistry::addToLayout(layout, id, getBuiltInParameterSpecs(id));
+    return layout;
+}
+
+void AudioVisualiserAudioProcessor::restoreParameters(const juce::ValueTree& restored)
+{
+    // Safe on any thread. Parameters missing from older state keep their defaults.
+    if (restored.hasType(parameters.state.getType()))
+        parameters.replaceState(restored);
 }
 
 //==============================================================================
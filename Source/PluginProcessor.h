@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "RingBuffer.h"
+#include "SettingsStore.h"
 
 //==============================================================================
 /**
@@ -146,6 +147,25 @@ public:
         return *ringBuffer;
     }
 
+    SettingsStore& getSettingsStore() {
+        return settingsStore;
+    }
+
+    // The parameters of every built in preset, as the host sees and automates them.
+    juce::AudioProcessorValueTreeState& getParameters() {
+        return parameters;
+    }
+
+    // Whether the file transport is playing. Safe to call from any thread.
+    bool isTransportPlaying() {
+        return transport.isPlaying();
+    }
+
+    // The number of samples that have passed through processBlock. This is the clock that recordings are timed against.
+    juce::int64 getAudioSamplePosition() {
+        return ringBuffer->getTotalSamplesWritten();
+    }
+
 
 
 private:
@@ -160,6 +180,14 @@ private:
 
     TransportState state;
 
+    // Standalone, the settings are also kept in a file, since there is no host project to save them in.
+    SettingsStore settingsStore{ wrapperType == wrapperType_Standalone };
+
+    juce::AudioProcessorValueTreeState parameters{ *this, nullptr, "Parameters", createParameterLayout() };
+
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    void restoreParameters(const juce::ValueTree& restored);
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioVisualiserAudioProcessor)
 };
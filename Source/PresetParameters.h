@@ -0,0 +1,32 @@
+/*
+  ==============================================================================
+
+    PresetParameters.h
+    Created: 19 Oct 2026 7:19:26am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterRegistry.h"
+
+#define NUM_BUILT_IN_RENDER_STATES 8
+
+// The parameters a built in render state declares, by preset id. Kept apart from the render states so the
+// processor can give them to the host before any render state exists, without including them.
+inline std::vector<ParameterSpec> getBuiltInParameterSpecs(int id) {
+    switch (id) {
+    case 3: // Classic3
+        return { ParameterSpec::intParameter("mode", "Mode", 0, 2, 0) };
+    case 5: // TD1
+        return {
+            ParameterSpec::floatParameter("gain", "Gain", 0.0f, 4.0f, 1.5f),
+            ParameterSpec::colourParameter("background", "Background", juce::Colours::black)
+        };
+    default:
+        return {};
+    }
+}
@@ -0,0 +1,178 @@
+/*
+  ==============================================================================
+
+    PromptStream.h
+    Created: 19 Oct 2026 6:45:58am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <string>
+
+#define PROMPT_STREAM_SNIFF_BYTES 16 // Enough of the response to tell its format from.
+#define PROMPT_STREAM_DONE "[DONE]"
+
+/*
+    Collects a generated shader from a /prompt response as it streams in.
+
+    The backend may answer in one of three ways, told apart from the start of the body:
+      - Server-sent events, each data field holding the next piece of the shader, ended by a "[DONE]" event.
+      - The shader itself as plain text, usually with chunked encoding.
+      - The original JSON object, {"success": true, "prompt": "..."}, which only has a shader once it is whole.
+
+    Fed on an APIClient worker. getShader() strips a markdown code fence, which models like to add.
+*/
+class PromptStream {
+public:
+    void feed(const char* data, int size) {
+        if (format == UNKNOWN) {
+            sniffed.append(data, (size_t) size);
+            if (sniffed.size() < PROMPT_STREAM_SNIFF_BYTES && sniffed.find('\n') == std::string::npos)
+                return;
+            format = detectFormat(sniffed);
+            std::string start;
+            start.swap(sniffed);
+            consume(start.data(), start.size());
+            return;
+        }
+        consume(data, (size_t) size);
+    }
+
+    // Call once the response has ended, to take in anything held back while the format was unknown.
+    void finish() {
+        if (format == UNKNOWN && !sniffed.empty()) {
+            format = detectFormat(sniffed);
+            std::string start;
+            start.swap(sniffed);
+            consume(start.data(), start.size());
+        }
+        if (format == SERVER_SENT_EVENTS && !line.empty())
+            handleLine();
+        if (format == SERVER_SENT_EVENTS)
+            dispatchEvent();
+    }
+
+    bool isJSON() const {
+        return format == JSON;
+    }
+
+    // The whole body, for the original JSON response.
+    juce::String getBody() const {
+        return juce::String::fromUTF8(text.data(), (int) text.size());
+    }
+
+    // The shader so far.
+    juce::String getShader() const {
+        juce::String shader = juce::String::fromUTF8(text.data(), (int) text.size()).trim();
+        if (shader.startsWith("```")) {
+            shader = shader.fromFirstOccurrenceOf("\n", false, false);
+            if (shader.trimEnd().endsWith("```"))
+                shader = shader.trimEnd().dropLastCharacters(3);
+        }
+        return shader.trim();
+    }
+
+    // True once a fragment shader has a #version and a main() whose braces have all closed, so it is worth
+    // trying to compile even though more may be coming.
+    static bool isCompleteShader(const juce::String& shader) {
+        if (!shader.contains("#version"))
+            return false;
+        int mainStart = shader.indexOf("void main");
+        if (mainStart < 0)
+            return false;
+        int depth = 0;
+        bool opened = false;
+        auto* c = shader.toRawUTF8() + shader.substring(0, mainStart).getNumBytesAsUTF8();
+        for (; *c != 0; c++) {
+            if (c[0] == '/' && c[1] == '/') {
+                while (*c != 0 && *c != '\n')
+                    c++;
+                if (*c == 0)
+                    break;
+            } else if (c[0] == '/' && c[1] == '*') {
+                c += 2;
+                while (*c != 0 && !(c[0] == '*' && c[1] == '/'))
+                    c++;
+                if (*c == 0)
+                    break;
+                c++;
+            } else if (*c == '{') {
+                depth++;
+                opened = true;
+            } else if (*c == '}') {
+                if (--depth == 0 && opened)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    enum Format { UNKNOWN, SERVER_SENT_EVENTS, PLAIN_TEXT, JSON };
+    Format format = UNKNOWN;
+    std::string sniffed;
+    std::string text; // The shader, or the JSON body.
+    std::string line; // A server-sent event line that hasn't ended yet.
+    std::string eventData;
+    bool hasEventData = false;
+    bool done = false;
+
+    static Format detectFormat(const std::string& start) {
+        size_t first = start.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos)
+            return PLAIN_TEXT;
+        if (start[first] == '{')
+            return JSON;
+        for (auto* field : { "data:", "event:", "id:", "retry:", ":" }) {
+            if (start.compare(first, strlen(field), field) == 0)
+                return SERVER_SENT_EVENTS;
+        }
+        return PLAIN_TEXT;
+    }
+
+    void consume(const char* data, size_t size) {
+        if (format != SERVER_SENT_EVENTS) {
+            text.append(data, size);
+            return;
+        }
+        for (size_t i = 0; i < size && !done; i++) {
+            if (data[i] == '\n')
+                handleLine();
+            else
+                line.push_back(data[i]);
+        }
+    }
+
+    void handleLine() {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty()) {
+            dispatchEvent();
+        } else if (line.compare(0, 5, "data:") == 0) {
+            size_t valueStart = line.size() > 5 && line[5] == ' ' ? 6 : 5;
+            if (hasEventData)
+                eventData.push_back('\n');
+            eventData.append(line, valueStart, std::string::npos);
+            hasEventData = true;
+        }
+        // Comments and the other fields don't carry any of the shader.
+        line.clear();
+    }
+
+    void dispatchEvent() {
+        if (!hasEventData)
+            return;
+        if (eventData == PROMPT_STREAM_DONE)
+            done = true;
+        else
+            text.append(eventData);
+        eventData.clear();
+        hasEventData = false;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PromptStream)
+};
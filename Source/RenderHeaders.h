@@ -10,12 +10,7 @@
 
 #pragma once
 
-#include "Classic1_2D.h"
-#include "Classic2_2D.h"
-#include "Classic3_2D.h"
-#include "Classic4_2D.h"
-#include "SDF_1_2D.h"
-#include "TimeDomain1_2D.h"
-#include "TimeDomain2_2D.h"
-#include "TimeDomain3_2D.h"
-#include "AskAI.h"
\ No newline at end of file
+// Every render state the plugin offers. The headless renderer only includes BuiltInRenderStates.h, since AskAI
+// brings the backend client with it.
+#include "BuiltInRenderStates.h"
+#include "AskAI.h"
@@ -10,8 +10,13 @@
 
 #include "RenderState.h"
 
-RenderState::RenderState(int id, juce::OpenGLContext& context, juce::String vert, juce::String frag)
-    : renderStateID(id), openGLContext(context), fragmentShader(std::make_shared<juce::String>(frag)), vertexShader(vert), renderProfile(id) {
+RenderState::RenderState(int id, juce::OpenGLContext& context, juce::String vert, juce::String frag, const std::vector<ParameterSpec>& parameterSpecs)
+    : renderStateID(id), openGLContext(context), fragmentShader(std::make_shared<juce::String>(frag)), vertexShader(vert), renderProfile(id), parameters(id, parameterSpecs) {
+    for (int i = 0; i < parameters.size(); i++) {
+        parameterControls.push_back(std::make_unique<ParameterControl>(parameters, i));
+        parameterControls.back()->setBounds(0, i * PARAMETER_CONTROL_HEIGHT, 140, PARAMETER_CONTROL_HEIGHT);
+        renderProfile.addComponent(parameterControls.back().get());
+    }
 }
 
 void RenderState::initAndCompileShaders() {
@@ -54,9 +59,47 @@ void RenderState::initNewFragmentShader(juce::String& shader) {
     initAndCompileShaders();
 }
 
+void RenderState::useShaderProgram(std::unique_ptr<juce::OpenGLShaderProgram> program, const juce::String& shader) {
+    std::atomic_store(&fragmentShader, std::make_shared<juce::String>(shader));
+    shaderProgram = std::move(program);
+    shaderProgram->use();
+
+    // The buffers don't depend on the program, so they are only made the first time.
+    if (!isInit) {
+        init();
+        setInitialised();
+    }
+}
+
 GLuint RenderState::getShaderProgramID() {
     if (shaderProgram)
         return shaderProgram->getProgramID();
     else
         return -1; // -1 for ERR
-}
\ No newline at end of file
+}
+
+void RenderState::applyFrameUniforms(const FrameUniforms& uniforms) {
+    applyFrameUniforms(getShaderProgramID(), uniforms);
+}
+
+void RenderState::applyFrameUniforms(GLuint progID, const FrameUniforms& uniforms) {
+    openGLContext.extensions.glUseProgram(progID);
+
+    GLuint timeUniform = openGLContext.extensions.glGetUniformLocation(progID, "time");
+    openGLContext.extensions.glUniform1i(timeUniform, uniforms.time);
+
+    GLuint leftRMSUniform = openGLContext.extensions.glGetUniformLocation(progID, "leftRMS");
+    openGLContext.extensions.glUniform1f(leftRMSUniform, uniforms.leftRMS);
+    GLuint rightRMSUniform = openGLContext.extensions.glGetUniformLocation(progID, "rightRMS");
+    openGLContext.extensions.glUniform1f(rightRMSUniform, uniforms.rightRMS);
+
+    GLuint screenWidthUniform = openGLContext.extensions.glGetUniformLocation(progID, "screenWidth");
+    GLuint screenHeightUniform = openGLContext.extensions.glGetUniformLocation(progID, "screenHeight");
+    openGLContext.extensions.glUniform1f(screenWidthUniform, uniforms.screenWidth);
+    openGLContext.extensions.glUniform1f(screenHeightUniform, uniforms.screenHeight);
+
+    GLuint visualizationUniform = openGLContext.extensions.glGetUniformLocation(progID, "audioBufferTD");
+    openGLContext.extensions.glUniform1fv(visualizationUniform, RING_BUFFER_READ_SIZE, uniforms.audioBufferTD);
+
+    parameters.applyUniforms(openGLContext, progID);
+}
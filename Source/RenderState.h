@@ -12,22 +12,59 @@
 
 #include <JuceHeader.h>
 #include "RenderProfileComponent.h"
+#include "ParameterRegistry.h"
+#include "ParameterControl.h"
+
+#define RING_BUFFER_READ_SIZE 256
+#define TIME_UNIFORM_RATE 60 // The time uniform counts live GL frames, which arrive at about this rate.
+
+// The per frame inputs that every render state receives as uniforms.
+struct FrameUniforms {
+    unsigned int time;
+    float leftRMS, rightRMS;
+    float screenWidth, screenHeight;
+    const GLfloat* audioBufferTD; // RING_BUFFER_READ_SIZE samples of the summed time domain signal.
+};
 
 class RenderState {
 public:
-    RenderState(int id, juce::OpenGLContext&, juce::String vertexShader, juce::String fragmentShader);
+    // Parameters are declared once, here. Each gets a control in the render profile and a uniform of its name.
+    RenderState(int id, juce::OpenGLContext&, juce::String vertexShader, juce::String fragmentShader, const std::vector<ParameterSpec>& parameterSpecs = {});
     virtual ~RenderState() = default;
 
     virtual void init() = 0;
     virtual void shutdown() = 0;
     virtual void render() = 0;
 
+    // Called on the GL thread once per live frame, before the frame uniforms are applied.
+    virtual void prepareFrame() {}
+
     void initAndCompileShaders();
 
     void initNewFragmentShader(juce::String& fragmentShader);
 
+    // Switches to a program that has already been compiled and linked, such as one a ShaderValidator passed.
+    // Must be called on the GL thread, from prepareFrame() so the frame's uniforms go to the new program.
+    void useShaderProgram(std::unique_ptr<juce::OpenGLShaderProgram> program, const juce::String& fragmentShader);
+
     GLuint getShaderProgramID();
 
+    // Binds the shader program and uploads the per frame uniforms and the parameters. Must be called on the GL
+    // thread before render().
+    void applyFrameUniforms(const FrameUniforms& uniforms);
+
+    // The same for a program other than the render state's own, such as one being validated.
+    void applyFrameUniforms(GLuint progID, const FrameUniforms& uniforms);
+
+    // Sets a named parameter from a cue. Any thread. Returns false if the render state has no such parameter.
+    virtual bool setParameter(const juce::String& name, const juce::var& value) {
+        return parameters.set(name, value);
+    }
+
+    ParameterRegistry& getParameters() {
+        return parameters;
+    }
+
     bool isInititalised() {
         return isInit;
     }
@@ -50,5 +87,8 @@ protected:
 
     RenderProfileComponent renderProfile;
 
+    ParameterRegistry parameters;
+    std::vector<std::unique_ptr<ParameterControl>> parameterControls;
+
     bool isInit = false;
 };
\ No newline at end of file
@@ -10,7 +10,8 @@
 
 #include "RenderState2D.h"
 
-RenderState2D::RenderState2D(int id, juce::OpenGLContext& context, juce::String vert, juce::String frag) : RenderState(id, context, vert, frag) {}
+RenderState2D::RenderState2D(int id, juce::OpenGLContext& context, juce::String vert, juce::String frag, const std::vector<ParameterSpec>& parameterSpecs)
+    : RenderState(id, context, vert, frag, parameterSpecs) {}
 
 void RenderState2D::init() {
     openGLContext.extensions.glGenBuffers(1, &vbo);
@@ -15,7 +15,7 @@
 
 class RenderState2D : public RenderState {
 public:
-    RenderState2D(int id, juce::OpenGLContext& context, juce::String vert, juce::String frag);
+    RenderState2D(int id, juce::OpenGLContext& context, juce::String vert, juce::String frag, const std::vector<ParameterSpec>& parameterSpecs = {});
 
     void init();
     void shutdown();
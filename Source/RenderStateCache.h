@@ -0,0 +1,328 @@
+/*
+  ==============================================================================
+
+    RenderStateCache.h
+    Created: 19 Oct 2026 6:39:26am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include "AVAPIResolver.h"
+#include "AVIOHandler.h"
+
+#define RENDER_STATE_CACHE_FOLDER "AudioVisualiser/RenderStateCache"
+#define RENDER_STATE_CACHE_INDEX "index.json"
+
+/*
+    Keeps the user's cloud render states on disk so the picker can open straight away and shaders that haven't
+    changed are never downloaded again.
+
+    The index holds the name, version and ETag of every render state the list endpoint last returned, and each
+    shader body is kept next to it in <id>.avrs, the same format AskAI saves to a file. A body is only fetched
+    when it is selected. If the list gave a version and it matches the cached one, the cached body is used
+    without asking the server. Otherwise the body is revalidated with its ETag, which costs a 304 when nothing
+    has changed.
+
+    Every user has a folder of their own, named by a hash of their JWT subject, so a different account never
+    sees or deletes another's render states. Nothing is cached until setUser() is given a subject. Render states
+    that disappear from the list are removed from disk, so a folder never holds more than its user has saved.
+
+    The disk is only touched by the cache's own thread, in the order things were asked for. The index is read
+    when the user is set, and changes made before it has been read wait for it. Everything else is called on
+    the message thread.
+*/
+class RenderStateCache : private juce::Thread {
+public:
+    struct Entry {
+        juce::String name;
+        juce::String version; // From the list. Empty if the server doesn't send versions.
+        juce::String bodyVersion; // Of the cached body. Empty if there is none or the server didn't say.
+        juce::String etag; // Of the cached body. Empty if there is none or the server didn't send one.
+        bool hasBody = false;
+    };
+
+    RenderStateCache(juce::File root = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory).getChildFile(RENDER_STATE_CACHE_FOLDER))
+        : juce::Thread("Render State Cache"), root(root), alive(std::make_shared<std::atomic<bool>>(true)) {
+        // A cache from before there was a folder per user can't be told apart from anyone else's.
+        enqueue([root]() {
+            for (auto& file : root.findChildFiles(juce::File::findFiles, false))
+                file.deleteFile();
+        });
+        startThread();
+    }
+
+    ~RenderStateCache() override {
+        alive->store(false);
+        signalThreadShouldExit();
+        notify();
+        stopThread(4000); // Writes anything still pending first.
+    }
+
+    // Called on the message thread once a user's index has been read.
+    std::function<void()> onLoaded;
+
+    // Switches to the cache of the user with this JWT subject, or to none if it is empty. Does nothing if the
+    // user hasn't changed, so it can be called whenever the JWT might have.
+    void setUser(const juce::String& subject) {
+        if (subject == user)
+            return;
+        user = subject;
+        entries.clear();
+        waitingForIndex.clear();
+        generation++;
+        if (subject.isEmpty()) {
+            directory = juce::File();
+            indexLoaded = true;
+            return;
+        }
+        directory = root.getChildFile(juce::String::toHexString(subject.hashCode64()));
+        indexLoaded = false;
+        juce::File from = directory;
+        int loading = generation;
+        enqueue([this, from, loading]() {
+            auto loaded = std::make_shared<std::map<int, Entry>>(readIndex(from));
+            juce::MessageManager::callAsync([this, alive = alive, loaded, loading]() {
+                if (alive->load() && loading == generation)
+                    finishLoading(std::move(*loaded));
+            });
+        });
+    }
+
+    // The render states from the last list, by id, for filling the picker before the network answers. Empty
+    // until the index has been read.
+    const std::map<int, Entry>& getEntries() const {
+        return entries;
+    }
+
+    // Replaces the list with one from the server. Bodies of render states that have been deleted are removed.
+    // Bodies with an older version are kept until they are revalidated, since their ETag is still useful.
+    void setList(const std::vector<struct RenderStateStruct>& renderStates) {
+        whenLoaded([this, renderStates]() {
+            std::map<int, Entry> updated;
+            for (auto& renderState : renderStates) {
+                Entry entry;
+                auto existing = entries.find(renderState.id);
+                if (existing != entries.end())
+                    entry = existing->second;
+                entry.name = renderState.name;
+                entry.version = renderState.version;
+                updated[renderState.id] = entry;
+            }
+            for (auto& entry : entries) {
+                if (updated.find(entry.first) == updated.end())
+                    deleteBody(entry.first);
+            }
+            entries.swap(updated);
+            saveIndex();
+        });
+    }
+
+    // True if the cached body is known to match the version in the list, so no request is needed.
+    bool isCurrent(int id) const {
+        auto entry = entries.find(id);
+        return entry != entries.end() && entry->second.hasBody && entry->second.version.isNotEmpty()
+            && entry->second.bodyVersion == entry->second.version;
+    }
+
+    bool hasBody(int id) const {
+        auto entry = entries.find(id);
+        return entry != entries.end() && entry->second.hasBody;
+    }
+
+    // The ETag to revalidate a render state with, or empty if there is no cached body to fall back on.
+    juce::String getETag(int id) const {
+        return hasBody(id) ? entries.at(id).etag : juce::String();
+    }
+
+    // Reads a body and calls back with it on the message thread, unless there is none or the user changes first.
+    void loadBody(int id, std::function<void(const juce::String&)> onBody) {
+        if (!hasBody(id))
+            return;
+        juce::File file = getBodyFile(id);
+        int loading = generation;
+        enqueue([this, file, loading, onBody]() {
+            if (!file.existsAsFile())
+                return;
+            juce::String shader = getRenderStateFromFile(file.getFullPathName());
+            juce::MessageManager::callAsync([this, alive = alive, loading, shader, onBody]() {
+                if (alive->load() && loading == generation)
+                    onBody(shader);
+            });
+        });
+    }
+
+    // The server said the cached body is still current.
+    void markCurrent(int id) {
+        whenLoaded([this, id]() {
+            auto entry = entries.find(id);
+            if (entry == entries.end() || entry->second.bodyVersion == entry->second.version)
+                return;
+            entry->second.bodyVersion = entry->second.version;
+            saveIndex();
+        });
+    }
+
+    void remove(int id) {
+        whenLoaded([this, id]() {
+            if (entries.erase(id) == 0)
+                return;
+            deleteBody(id);
+            saveIndex();
+        });
+    }
+
+    void store(const struct RenderStateStruct& renderState, const juce::String& etag) {
+        whenLoaded([this, renderState, etag]() {
+            storeBody(renderState, etag);
+            saveIndex();
+        });
+    }
+
+    // Stores the bodies of a batch of render states, writing the index once for all of them.
+    void storeAll(const std::vector<struct RenderStateStruct>& renderStates) {
+        whenLoaded([this, renderStates]() {
+            for (auto& renderState : renderStates)
+                storeBody(renderState, {});
+            if (!renderStates.empty())
+                saveIndex();
+        });
+    }
+
+private:
+    juce::File root;
+    juce::File directory; // Of the current user. Not a file while there is none.
+    juce::String user;
+    int generation = 0; // Bumped when the user changes, so reads for the last one are ignored.
+    std::map<int, Entry> entries;
+    bool indexLoaded = true;
+    std::vector<std::function<void()>> waitingForIndex;
+    std::shared_ptr<std::atomic<bool>> alive; // Checked by a read before it hands its result to the message thread.
+
+    juce::CriticalSection jobsLock;
+    std::vector<std::function<void()>> jobs; // Disk work for the thread, in order.
+
+    void enqueue(std::function<void()> job) {
+        {
+            const juce::ScopedLock lock(jobsLock);
+            jobs.push_back(std::move(job));
+        }
+        notify();
+    }
+
+    void run() override {
+        auto runPending = [this]() {
+            std::vector<std::function<void()>> pending;
+            {
+                const juce::ScopedLock lock(jobsLock);
+                pending.swap(jobs);
+            }
+            for (auto& job : pending)
+                job();
+        };
+        while (!threadShouldExit()) {
+            wait(-1);
+            runPending();
+        }
+        runPending(); // Writes queued just before the cache was destroyed.
+    }
+
+    void whenLoaded(std::function<void()> change) {
+        if (directory == juce::File())
+            return;
+        if (indexLoaded)
+            change();
+        else
+            waitingForIndex.push_back(std::move(change));
+    }
+
+    void finishLoading(std::map<int, Entry> loaded) {
+        entries.swap(loaded);
+        indexLoaded = true;
+        auto waiting = std::move(waitingForIndex);
+        waitingForIndex.clear();
+        for (auto& change : waiting)
+            change();
+        if (onLoaded)
+            onLoaded();
+    }
+
+    void storeBody(const struct RenderStateStruct& renderState, const juce::String& etag) {
+        juce::File file = getBodyFile(renderState.id);
+        juce::String shader = renderState.renderState;
+        enqueue([file, shader]() {
+            if (!file.getParentDirectory().createDirectory() || !saveRenderStateToFile(file.getFullPathName(), shader))
+                DBG("Could not cache render state at " << file.getFullPathName());
+        });
+        Entry& entry = entries[renderState.id];
+        entry.name = renderState.name;
+        // A body fetched without a version is taken to be the one the list named.
+        entry.bodyVersion = renderState.version.isNotEmpty() ? renderState.version : entry.version;
+        entry.etag = etag;
+        entry.hasBody = true;
+    }
+
+    void deleteBody(int id) {
+        juce::File file = getBodyFile(id);
+        enqueue([file]() {
+            file.deleteFile();
+        });
+    }
+
+    juce::File getBodyFile(int id) const {
+        return directory.getChildFile(juce::String(id) + ".avrs");
+    }
+
+    // On the cache's thread.
+    static std::map<int, Entry> readIndex(const juce::File& from) {
+        std::map<int, Entry> loaded;
+        juce::File index = from.getChildFile(RENDER_STATE_CACHE_INDEX);
+        if (!index.existsAsFile())
+            return loaded;
+        juce::var parsed = juce::JSON::parse(index);
+        if (!parsed.isArray()) {
+            DBG("The render state cache index could not be parsed, starting empty.");
+            return loaded;
+        }
+        for (auto& item : *parsed.getArray()) {
+            if (!item.hasProperty("id"))
+                continue;
+            Entry entry;
+            entry.name = item["name"].toString();
+            entry.version = item["version"].toString();
+            entry.bodyVersion = item["bodyVersion"].toString();
+            entry.etag = item["etag"].toString();
+            entry.hasBody = from.getChildFile(item["id"].toString() + ".avrs").existsAsFile();
+            loaded[(int) item["id"]] = entry;
+        }
+        return loaded;
+    }
+
+    void saveIndex() {
+        juce::Array<juce::var> items;
+        for (auto& entry : entries) {
+            auto* item = new juce::DynamicObject();
+            item->setProperty("id", entry.first);
+            item->setProperty("name", entry.second.name);
+            item->setProperty("version", entry.second.version);
+            item->setProperty("bodyVersion", entry.second.bodyVersion);
+            item->setProperty("etag", entry.second.etag);
+            items.add(juce::var(item));
+        }
+        juce::File index = directory.getChildFile(RENDER_STATE_CACHE_INDEX);
+        juce::String json = juce::JSON::toString(juce::var(items), true);
+        enqueue([index, json]() {
+            if (!replaceFileAtomically(index, json))
+                DBG("Could not write the render state cache index to " << index.getFullPathName());
+        });
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderStateCache)
+};
@@ -0,0 +1,405 @@
+/*
+  ==============================================================================
+
+    RenderStateSyncQueue.h
+    Created: 19 Oct 2026 6:43:07am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <vector>
+
+#include "AVAPIResolver.h"
+#include "AVIOHandler.h"
+#include "Settings.h"
+
+#define SYNC_QUEUE_FILE "AudioVisualiser/PendingRenderStates.json"
+#define SYNC_QUEUE_MIN_BACKOFF_MS 1000
+#define SYNC_QUEUE_MAX_BACKOFF_MS 60000
+
+#define SYNC_LIST_SERIAL -1 // inFlightSerial while the list is fetched. Operations have positive serials.
+
+#define SYNC_OPERATION_ADD 0
+#define SYNC_OPERATION_DELETE 1
+
+/*
+    Saves and deletes of cloud render states, written to disk before they are sent and sent in the background.
+
+    Adding to the queue returns at once, so the UI never waits on the backend, and a change made while it can't
+    be reached is sent once it can. Operations are sent one after another in the order they were made, the next
+    straight after the last succeeds. Failures that may pass, such as no connection, a 5xx, or not being logged
+    in, are retried with a backoff doubling from SYNC_QUEUE_MIN_BACKOFF_MS to SYNC_QUEUE_MAX_BACKOFF_MS. Other
+    failures drop the operation. The backend gives saves no idempotency key, so a save that was sent but lost its
+    connection before the response, or timed out, is kept as unconfirmed rather than sent again. The queue then
+    fetches the list. If it holds more render states of that name than the last list did, the save was made.
+    Otherwise the save is sent again.
+
+    Operations that cancel out are coalesced before they are sent:
+      - Deleting a save that hasn't been sent drops both.
+      - Saving the same name and shader twice in a row, or deleting the same render state twice, is sent once.
+
+    Saves that haven't been sent are referred to by a negative local id. A delete of one whose save is in flight
+    or unconfirmed waits and is sent with the id the server gives it.
+
+    Each operation records the user it was made by, and is only sent while that user is logged in. Operations
+    made without a user are dropped.
+
+    Message thread only.
+*/
+class RenderStateSyncQueue : private juce::Timer {
+public:
+    RenderStateSyncQueue(ApplicationSettings& settings, juce::File file = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory).getChildFile(SYNC_QUEUE_FILE))
+        : settings(settings), file(file) {
+        load();
+        startTimer(SYNC_QUEUE_MIN_BACKOFF_MS);
+    }
+
+    ~RenderStateSyncQueue() override {
+        apiClient->cancel(inFlightRequest);
+    }
+
+    // Returns the local id of the save.
+    int enqueueAdd(const juce::String& name, const juce::String& shader) {
+        juce::String owner = getJWTSubject(settings.getAuthJWT());
+        if (!operations.empty()) {
+            const Operation& last = operations.back();
+            if (last.type == SYNC_OPERATION_ADD && last.name == name && last.shader == shader && last.owner == owner && !isInFlight(last) && !last.unconfirmed)
+                return last.localId;
+        }
+        Operation operation{ nextSerial++, SYNC_OPERATION_ADD, nextLocalId--, 0, name, shader, owner };
+        operations.push_back(operation);
+        commit();
+        return operation.localId;
+    }
+
+    // Deletes a render state by the id the server gave it, or by the local id enqueueAdd() returned.
+    void enqueueDelete(int id) {
+        juce::String owner = getJWTSubject(settings.getAuthJWT());
+        for (auto it = operations.begin(); it != operations.end(); ++it) {
+            if (isInFlight(*it))
+                continue;
+            if (it->type == SYNC_OPERATION_ADD && it->localId == id && !it->unconfirmed) {
+                operations.erase(it);
+                commit();
+                return;
+            }
+            if (it->type == SYNC_OPERATION_DELETE && it->id == id)
+                return;
+        }
+        operations.push_back({ nextSerial++, SYNC_OPERATION_DELETE, 0, id, {}, {}, owner });
+        commit();
+    }
+
+    // For leaving a render state out of a list fetched before its delete was sent.
+    bool isDeletePending(int id) const {
+        return std::any_of(operations.begin(), operations.end(), [id](const Operation& operation) {
+            return operation.type == SYNC_OPERATION_DELETE && operation.id == id;
+        });
+    }
+
+    // Called with every complete list of the logged in user's render states, so an unconfirmed save can be
+    // settled against it.
+    void listReceived(const std::vector<struct RenderStateStruct>& renderStates) {
+        juce::String owner = getJWTSubject(settings.getAuthJWT());
+        if (owner.isEmpty())
+            return;
+        listOwner = owner;
+        listedNames.clearQuick();
+        for (auto& renderState : renderStates)
+            listedNames.add(renderState.name);
+
+        std::vector<Operation> made;
+        std::vector<int> deleted; // Local ids of saves that were never made and have since been deleted.
+        bool settled = false;
+        for (auto& operation : operations) {
+            if (!operation.unconfirmed || operation.owner != owner)
+                continue;
+            settled = true;
+            int count = 0, newestId = 0;
+            for (auto& renderState : renderStates) {
+                if (renderState.name == operation.name) {
+                    count++;
+                    newestId = juce::jmax(newestId, renderState.id);
+                }
+            }
+            // Without an earlier list, any render state of the same name is taken to be this one.
+            if (operation.listedBefore < 0 ? count > 0 : count > operation.listedBefore) {
+                DBG("The unconfirmed save of " << operation.name << " was made, as render state " << newestId << ".");
+                made.push_back(operation);
+                made.back().id = newestId;
+            } else if (isDeletePending(operation.localId)) {
+                DBG("The unconfirmed save of " << operation.name << " was never made, and has since been deleted.");
+                deleted.push_back(operation.localId);
+            } else {
+                DBG("The unconfirmed save of " << operation.name << " was never made. Sending it again.");
+                operation.unconfirmed = false;
+            }
+        }
+        if (!settled)
+            return;
+        for (auto& operation : operations) {
+            for (auto& save : made) {
+                if (operation.type == SYNC_OPERATION_DELETE && operation.id == save.localId)
+                    operation.id = save.id; // Deletes made while it was unconfirmed can now be sent.
+            }
+        }
+        // Whatever is still unconfirmed for this user has been settled as made or deleted.
+        operations.erase(std::remove_if(operations.begin(), operations.end(), [&](const Operation& operation) {
+            if (operation.type == SYNC_OPERATION_DELETE)
+                return std::find(deleted.begin(), deleted.end(), operation.id) != deleted.end();
+            return operation.unconfirmed && operation.owner == owner;
+        }), operations.end());
+        commit();
+        if (onAdded) {
+            for (auto& operation : made)
+                onAdded(operation.localId, operation.id, operation.name, operation.shader);
+        }
+    }
+
+    // Saves that were sent but may not have been made, until a list shows whether they were.
+    int getNumUnconfirmed() const {
+        return (int) std::count_if(operations.begin(), operations.end(), [](const Operation& operation) {
+            return operation.unconfirmed;
+        });
+    }
+
+    // Called once a save has been sent, with its local id and the id the server gave it.
+    std::function<void(int localId, int id, const juce::String& name, const juce::String& shader)> onAdded;
+
+private:
+    struct Operation {
+        int serial; // Identifies the operation while it is in flight. Not saved.
+        int type;
+        int localId; // Of a save.
+        int id; // Of a delete. Negative while it refers to a save that hasn't been sent.
+        juce::String name, shader;
+        juce::String owner;
+        bool unconfirmed = false; // A save that was sent but got no response.
+        int listedBefore = -1; // Render states of its name in the last list before it was sent. -1 if unknown.
+    };
+
+    ApplicationSettings& settings;
+    juce::File file;
+    juce::SharedResourcePointer<APIClient> apiClient;
+
+    std::vector<Operation> operations;
+    int nextLocalId = -1;
+    int nextSerial = 1;
+    int inFlightSerial = 0; // 0 while nothing is in flight, SYNC_LIST_SERIAL while the list is.
+    int inFlightRequest = 0;
+    int backoffMs = 0;
+
+    juce::String listOwner; // The user the last list was of.
+    juce::StringArray listedNames; // Of the render states in it.
+    std::vector<struct RenderStateStruct> checkedList; // The list being fetched to settle unconfirmed saves.
+
+    bool isInFlight(const Operation& operation) const {
+        return operation.serial == inFlightSerial;
+    }
+
+    // Unconfirmed saves, and deletes of them, wait until a list settles the save.
+    bool isWaitingForList(const Operation& operation) const {
+        if (operation.unconfirmed)
+            return true;
+        return operation.type == SYNC_OPERATION_DELETE && std::any_of(operations.begin(), operations.end(), [&operation](const Operation& save) {
+            return save.unconfirmed && save.localId == operation.id;
+        });
+    }
+
+    // Writes the queue to disk, then sends whatever can be sent.
+    void commit() {
+        save();
+        if (inFlightSerial == 0 && backoffMs == 0)
+            flush();
+    }
+
+    void timerCallback() override {
+        stopTimer();
+        flush();
+    }
+
+    void retryLater() {
+        backoffMs = backoffMs == 0 ? SYNC_QUEUE_MIN_BACKOFF_MS : juce::jmin(backoffMs * 2, SYNC_QUEUE_MAX_BACKOFF_MS);
+        startTimer(backoffMs);
+    }
+
+    void flush() {
+        if (inFlightSerial != 0 || operations.empty())
+            return;
+        auto unowned = std::remove_if(operations.begin(), operations.end(), [this](const Operation& operation) {
+            return operation.owner.isEmpty() && !isInFlight(operation);
+        });
+        if (unowned != operations.end()) {
+            DBG("Dropping " << (int) (operations.end() - unowned) << " render state changes made without a logged in user.");
+            operations.erase(unowned, operations.end());
+            save();
+        }
+
+        juce::String jwt = settings.getAuthJWT();
+        juce::String owner = getJWTSubject(jwt);
+        int index = -1;
+        bool unconfirmed = false;
+        for (size_t i = 0; i < operations.size() && settings.isAuth(); i++) {
+            if (operations[i].owner != owner)
+                continue;
+            if (isWaitingForList(operations[i])) {
+                unconfirmed = true;
+                continue;
+            }
+            index = (int) i;
+            break;
+        }
+        if (index < 0 && unconfirmed) {
+            fetchList(jwt, false);
+            return;
+        }
+        if (index < 0) {
+            // Nothing this user can send. Checking is free, so check often for a login.
+            startTimer(SYNC_QUEUE_MIN_BACKOFF_MS);
+            return;
+        }
+
+        Operation& operation = operations[(size_t) index];
+        if (operation.type == SYNC_OPERATION_DELETE && operation.id < 0) {
+            DBG("Dropping a delete of render state " << operation.id << ", whose save never reached the server.");
+            operations.erase(operations.begin() + index);
+            save();
+            flush();
+            return;
+        }
+
+        inFlightSerial = operation.serial;
+        if (operation.type == SYNC_OPERATION_ADD) {
+            inFlightRequest = postAddRenderState(*apiClient, jwt, operation.name, operation.shader, [this](int statusCode, bool sent, const juce::String& id) {
+                completed(statusCode, id.getIntValue(), sent);
+            });
+        } else {
+            inFlightRequest = deleteDeleteRenderState(*apiClient, jwt, operation.id, [this](int statusCode, int status) {
+                juce::ignoreUnused(status);
+                completed(statusCode, 0, false);
+            });
+        }
+    }
+
+    // Fetches every render state's name, falling back to the whole list on servers without the list endpoint.
+    void fetchList(const juce::String& jwt, bool withBodies) {
+        inFlightSerial = SYNC_LIST_SERIAL;
+        checkedList.clear();
+        auto onBatch = [this](std::vector<struct RenderStateStruct> renderStates) {
+            checkedList.insert(checkedList.end(), renderStates.begin(), renderStates.end());
+        };
+        auto onDone = [this, jwt, withBodies](int statusCode, bool complete) {
+            inFlightSerial = 0;
+            if (statusCode == 404 && !withBodies) {
+                fetchList(jwt, true);
+                return;
+            }
+            if (!complete) {
+                DBG("Could not fetch the render state list to settle unconfirmed saves, status " << statusCode << ". Retrying.");
+                retryLater();
+                return;
+            }
+            backoffMs = 0;
+            auto renderStates = std::move(checkedList);
+            checkedList.clear();
+            listReceived(renderStates);
+        };
+        inFlightRequest = withBodies ? getGetAllRenderStates(*apiClient, jwt, onBatch, onDone) : getListRenderStates(*apiClient, jwt, onBatch, onDone);
+    }
+
+    // mayHaveBeenMade is set for a save that was sent. Deleting twice is harmless, so deletes never set it.
+    void completed(int statusCode, int addedId, bool mayHaveBeenMade) {
+        auto inFlight = std::find_if(operations.begin(), operations.end(), [this](const Operation& operation) {
+            return isInFlight(operation);
+        });
+        inFlightSerial = 0;
+        jassert(inFlight != operations.end()); // Nothing removes an operation in flight.
+
+        bool lost = statusCode == 0 && mayHaveBeenMade;
+        bool retry = statusCode == 0 || statusCode == 401 || statusCode == 408 || statusCode == 429 || statusCode >= 500;
+        if (retry && !lost) {
+            DBG("Render state sync failed with status " << statusCode << ", retrying.");
+            retryLater();
+            return;
+        }
+        if (lost) {
+            DBG("A render state save got no response after it was sent. Keeping it until a list shows whether it was made.");
+            inFlight->unconfirmed = true;
+            inFlight->listedBefore = -1;
+            if (listOwner == inFlight->owner)
+                inFlight->listedBefore = (int) std::count(listedNames.begin(), listedNames.end(), inFlight->name);
+            backoffMs = 0;
+            save();
+            flush();
+            return;
+        }
+        if (statusCode / 100 != 2)
+            DBG("Render state sync was refused with status " << statusCode << ", dropping it.");
+
+        Operation operation = *inFlight;
+        operations.erase(inFlight);
+        backoffMs = 0;
+        bool added = statusCode / 100 == 2 && operation.type == SYNC_OPERATION_ADD && addedId > 0;
+        if (added) {
+            // Deletes made while the save was in flight can now be sent.
+            for (auto& waiting : operations) {
+                if (waiting.type == SYNC_OPERATION_DELETE && waiting.id == operation.localId)
+                    waiting.id = addedId;
+            }
+        }
+        save();
+        if (added && onAdded)
+            onAdded(operation.localId, addedId, operation.name, operation.shader);
+        flush();
+    }
+
+    void load() {
+        if (!file.existsAsFile())
+            return;
+        juce::var parsed = juce::JSON::parse(file);
+        if (!parsed.isObject()) {
+            DBG("The render state sync queue could not be read, starting empty.");
+            return;
+        }
+        nextLocalId = juce::jmin(-1, (int) parsed["nextLocalId"]);
+        if (auto* items = parsed["operations"].getArray()) {
+            for (auto& item : *items) {
+                int type = (int) item["type"];
+                if (type != SYNC_OPERATION_ADD && type != SYNC_OPERATION_DELETE)
+                    continue;
+                operations.push_back({ nextSerial++, type, (int) item["localId"], (int) item["id"],
+                    item["name"].toString(), item["shader"].toString(), item["owner"].toString(),
+                    (bool) item["unconfirmed"], item.hasProperty("listedBefore") ? (int) item["listedBefore"] : -1 });
+            }
+        }
+        DBG("Loaded " << operations.size() << " unsent render state changes.");
+    }
+
+    void save() {
+        juce::Array<juce::var> items;
+        for (auto& operation : operations) {
+            auto* item = new juce::DynamicObject();
+            item->setProperty("type", operation.type);
+            item->setProperty("localId", operation.localId);
+            item->setProperty("id", operation.id);
+            item->setProperty("name", operation.name);
+            item->setProperty("shader", operation.shader);
+            item->setProperty("owner", operation.owner);
+            item->setProperty("unconfirmed", operation.unconfirmed);
+            item->setProperty("listedBefore", operation.listedBefore);
+            items.add(juce::var(item));
+        }
+        auto* root = new juce::DynamicObject();
+        root->setProperty("nextLocalId", nextLocalId);
+        root->setProperty("operations", items);
+        if (!replaceFileAtomically(file, juce::JSON::toString(juce::var(root), true)))
+            DBG("Could not write the render state sync queue to " << file.getFullPathName());
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderStateSyncQueue)
+};
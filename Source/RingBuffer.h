@@ -79,6 +79,7 @@ public:
 
         writePosition += numSamples;
         writePosition = writePosition.get() % bufferSize;
+        totalSamplesWritten += numSamples;
 
         /*
             Although it would seem that the above two lines could cause a
@@ -160,6 +161,15 @@ public:
         }
     }
 
+    /** Returns the total number of samples written to the RingBuffer since it was
+        created. Unlike the write position this never wraps, so it can be used as
+        an audio clock by the consumers.
+    */
+    juce::int64 getTotalSamplesWritten() const
+    {
+        return totalSamplesWritten.get();
+    }
+
 private:
     int bufferSize;
     int numChannels;
@@ -167,6 +177,7 @@ private:
     juce::Atomic<int> writePosition; // This must be atomic so the conumer does
     // not read it in a torn state as it is being
     // changed.
+    juce::Atomic<juce::int64> totalSamplesWritten{ 0 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RingBuffer)
 };
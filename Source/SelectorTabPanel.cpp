@@ -26,12 +26,14 @@ SelectorTabPanel::SelectorTabPanel(AudioVisualiserAudioProcessor& p, OpenGLCompo
         updatePanelRenderProfile(newState, selectedState);
         selectedState = newState;
         openGLComponent.setSelectedState(selectedState);
+        appSettings.setSelectedPreset(selectedState);
         };
     addAndMakeVisible(&presetSelector);
     for (int i = 0; i < openGL.getNumRenderStates(); i++) {
         addRenderPofile(openGL.getProfileComponent(i)); // Here they will be added to the presetSelector.
     }
-    presetSelector.setSelectedId(DEFAULT_RENDER_STATE);
+    int savedState = appSettings.getSelectedPreset();
+    presetSelector.setSelectedId(savedState >= 1 && savedState <= presetSelector.getNumItems() ? savedState : DEFAULT_RENDER_STATE);
 
     openInApp.setButtonText("Open In App");
     openInApp.setBounds(8, 40, 123, 25);
@@ -66,6 +68,8 @@ SelectorTabPanel::SelectorTabPanel(AudioVisualiserAudioProcessor& p, OpenGLCompo
             juce::File file = chooser.getResult();
             DBG("File selected for playback!");
             pluginProcessor.setNewTransportSource(file);
+            if (file.existsAsFile())
+                appSettings.addRecentFile(file);
             });
         };
     addAndMakeVisible(open);
@@ -135,6 +139,7 @@ void SelectorTabPanel::processRenderStateIncrement() {
     updatePanelRenderProfile(newState, selectedState);
     selectedState = newState;
     openGLComponent.setSelectedState(selectedState);
+    appSettings.setSelectedPreset(selectedState);
 }
 
 void SelectorTabPanel::processRenderStateDecrement() {
@@ -145,4 +150,5 @@ void SelectorTabPanel::processRenderStateDecrement() {
     updatePanelRenderProfile(newState, selectedState);
     selectedState = newState;
     openGLComponent.setSelectedState(selectedState);
+    appSettings.setSelectedPreset(selectedState);
 }
\ No newline at end of file
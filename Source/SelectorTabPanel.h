@@ -38,6 +38,14 @@ public:
     void processRenderStateIncrement();
     void processRenderStateDecrement();
 
+    // Brings the panel up to date after the GL thread changed the render state for a scheduled cue.
+    void syncSelectedState(unsigned int state) {
+        presetSelector.setSelectedId((int) state, juce::dontSendNotification);
+        updatePanelRenderProfile(state, selectedState);
+        selectedState = state;
+        appSettings.setSelectedPreset((int) state);
+    }
+
     void addRenderPofile(RenderProfileComponent* component) {
         const int index = renderProfiles.size();
         component->setResizableBounds(juce::Rectangle(0, 168, 140, 298));
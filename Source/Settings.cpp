@@ -11,14 +11,55 @@
 #include "Settings.h"
 #include "PluginEditor.h"
 
-ApplicationSettings::ApplicationSettings(AudioVisualiserAudioProcessorEditor* editor) : root(editor) {
+ApplicationSettings::ApplicationSettings(AudioVisualiserAudioProcessorEditor* editor, SettingsStore& store) : root(editor), store(store) {
+    // Only read here, the editor applies them once the components they affect exist.
+    load();
+    store.addChangeListener(this);
+}
+
+ApplicationSettings::~ApplicationSettings() {
+    store.removeChangeListener(this);
+}
+
+void ApplicationSettings::load() {
+    width = store.get("width", width);
+    height = store.get("height", height);
+    fftSize = store.get("fftSize", fftSize);
+    recordingMode = store.get("recordingMode", recordingMode);
+    segmentSeconds = store.get("segmentSeconds", segmentSeconds);
+    encoderProfileID = store.get("encoderProfile", encoderProfileID);
+    EncoderProfile custom;
+    custom.bitRateKbps = store.get("customBitRateKbps", customEncoderProfile.bitRateKbps);
+    custom.keyframeSeconds = store.get("customKeyframeSeconds", customEncoderProfile.keyframeSeconds);
+    custom.preset = store.get("customPreset", customEncoderProfile.preset);
+    custom.tune = store.get("customTune", customEncoderProfile.tune).toString();
+    custom.rateControl = store.get("customRateControl", customEncoderProfile.rateControl).toString();
+    if (custom.isValid())
+        customEncoderProfile = custom;
+    streamUrl = store.get("streamUrl", streamUrl).toString();
+    previewOutput = store.get("previewOutput", previewOutput);
+    featureRate = store.get("featureRate", featureRate);
+    selectedPreset = store.get("selectedPreset", selectedPreset);
+}
 
+// The host restored a project while the editor is open.
+void ApplicationSettings::changeListenerCallback(juce::ChangeBroadcaster* source) {
+    juce::ignoreUnused(source);
+    load();
+    sendDimensionUpdate(width, height);
+    root->getFeatureBroadcaster().setRate(featureRate);
 }
 
 void ApplicationSettings::sendDimensionUpdate(int w, int h) {
     root->getOpenGLComponent().resetVideoRecorder(w, h);
 }
 
+void ApplicationSettings::setFeatureRate(int rate) {
+    featureRate = rate;
+    store.set("featureRate", rate);
+    root->getFeatureBroadcaster().setRate(rate);
+}
+
 void ApplicationSettings::setFullScreen(bool val) {
     root->getOpenGLComponent().setFullScreen(val);
     if (val == false) {
@@ -29,4 +70,8 @@ void ApplicationSettings::setFullScreen(bool val) {
 
 juce::String ApplicationSettings::getSocketConnectionHandle() {
 	return root->getGlobalSocketHandler().getConnectionHandle();
+}
+
+juce::String ApplicationSettings::getWebSocketConnectionHandle() {
+	return root->getWebSocketServer().getConnectionHandle();
 }
\ No newline at end of file
@@ -11,12 +11,25 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "EncoderProfile.h"
+#include "SettingsStore.h"
+
+#define PREVIEW_OUTPUT_NONE 0
+#define PREVIEW_OUTPUT_FILE 1 // Written next to the recording as <name>_preview.mp4.
+#define PREVIEW_OUTPUT_STREAM 2 // Sent to the stream URL.
+#define NUM_PREVIEW_OUTPUTS 3
 
 class AudioVisualiserAudioProcessorEditor;
 
-class ApplicationSettings {
+/*
+    Settings are kept in the processor's SettingsStore as they are changed, so they are saved with the host's
+    project, or to disk as a standalone app, and restored when the editor is next opened. The JWT is not kept,
+    since host state ends up in project files that get shared.
+*/
+class ApplicationSettings : private juce::ChangeListener {
 public:
-    ApplicationSettings(AudioVisualiserAudioProcessorEditor* editor);
+    ApplicationSettings(AudioVisualiserAudioProcessorEditor* editor, SettingsStore& store);
+    ~ApplicationSettings() override;
     /*
         Only to be updated on the message thread for now.
     */
@@ -35,6 +48,8 @@ public:
     void setDimensions(int w, int h) {
         width = w;
         height = h;
+        store.set("width", w);
+        store.set("height", h);
         sendDimensionUpdate(w, h);
     }
 
@@ -52,20 +67,126 @@ public:
 
     void setFFTSize(int size) {
         fftSize = size;
+        store.set("fftSize", size);
+    }
+
+    // Recording mode ids match VideoEncoder::ContainerMode. Applied when the next recording starts.
+    int getRecordingMode() {
+        return recordingMode;
+    }
+
+    void setRecordingMode(int mode) {
+        recordingMode = mode;
+        store.set("recordingMode", mode);
+    }
+
+    int getSegmentSeconds() {
+        return segmentSeconds;
+    }
+
+    void setSegmentSeconds(int seconds) {
+        segmentSeconds = seconds;
+        store.set("segmentSeconds", seconds);
+    }
+
+    // One of the ENCODER_PROFILE ids. Applied when the next recording starts.
+    int getEncoderProfileID() {
+        return encoderProfileID;
+    }
+
+    void setEncoderProfileID(int id) {
+        encoderProfileID = id;
+        store.set("encoderProfile", id);
+    }
+
+    // The profile used when the custom profile is selected. Only set with a profile that isValid().
+    EncoderProfile getCustomEncoderProfile() {
+        return customEncoderProfile;
+    }
+
+    void setCustomEncoderProfile(const EncoderProfile& profile) {
+        customEncoderProfile = profile;
+        store.set("customBitRateKbps", profile.bitRateKbps);
+        store.set("customKeyframeSeconds", profile.keyframeSeconds);
+        store.set("customPreset", profile.preset);
+        store.set("customTune", profile.tune);
+        store.set("customRateControl", profile.rateControl);
+    }
+
+    EncoderProfile getEncoderProfile() {
+        return encoderProfileID == ENCODER_PROFILE_CUSTOM ? customEncoderProfile : EncoderProfile::getProfile(encoderProfileID);
+    }
+
+    // Where "Go Live" streams to. Only set with a target that isStreamTarget().
+    juce::String getStreamUrl() {
+        return streamUrl;
+    }
+
+    void setStreamUrl(const juce::String& url) {
+        streamUrl = url;
+        store.set("streamUrl", url);
+    }
+
+    // One of the PREVIEW_OUTPUT ids. A preview is a second, downscaled output of the same recording.
+    int getPreviewOutput() {
+        return previewOutput;
+    }
+
+    void setPreviewOutput(int output) {
+        previewOutput = output;
+        store.set("previewOutput", output);
+    }
+
+    // Audio feature broadcasts per second, for socket clients that subscribe to them.
+    int getFeatureRate() {
+        return featureRate;
+    }
+
+    void setFeatureRate(int rate);
+
+    // The id of the preset in the selector, restored when the editor opens.
+    int getSelectedPreset() {
+        return selectedPreset;
+    }
+
+    void setSelectedPreset(int id) {
+        selectedPreset = id;
+        store.set("selectedPreset", id);
+    }
+
+    // Audio files and render states opened most recently, as full paths, most recent first.
+    juce::StringArray getRecentFiles() {
+        return store.getRecentFiles();
+    }
+
+    void addRecentFile(const juce::File& file) {
+        store.addRecentFile(file);
     }
 
     void setFullScreen(bool val);
 
     juce::String getSocketConnectionHandle();
+    juce::String getWebSocketConnectionHandle();
 
 private:
     AudioVisualiserAudioProcessorEditor* root;
+    SettingsStore& store;
 
     void sendDimensionUpdate(int w, int h);
+    void load();
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
 
     juce::String authJWT = "";
 
     int width = 1920, height = 1080;
     int fftSize = 2048;
+    int recordingMode = 1; // Fragmented MP4, so a crash never loses a whole recording.
+    int segmentSeconds = 10;
+    int encoderProfileID = ENCODER_PROFILE_ARCHIVE;
+    EncoderProfile customEncoderProfile;
+    juce::String streamUrl = "";
+    int previewOutput = 0;
+    int featureRate = 60;
+    int selectedPreset = 1;
     bool fullScreen = false;
 };
\ No newline at end of file
@@ -13,16 +13,29 @@
 #include <JuceHeader.h>
 #include "Settings.h"
 #include "WebViewHelper.h"
+#include "StrHelper.h"
 
 #define SETTINGS_DIMENSION_W 0
 #define SETTINGS_DIMENSION_H 1
 #define SETTINGS_DIMENSION_WH 2
 #define SETTINGS_FFT_SIZE 3
+#define SETTINGS_RECORDING_MODE 4
+#define SETTINGS_SEGMENT_LENGTH 5
+#define SETTINGS_ENCODER_PROFILE 6
+#define SETTINGS_ENCODER_CUSTOM 7
+#define SETTINGS_STREAM_URL 8
+#define SETTINGS_PREVIEW_OUTPUT 9
+#define SETTINGS_FEATURE_RATE 10
 
 #define MIN_WIDTH 100
 #define MAX_WIDTH 1920
 #define MIN_HEIGHT 100
 #define MAX_HEIGHT 1080
+#define NUM_RECORDING_MODES 3
+#define MIN_SEGMENT_SECONDS 2
+#define MAX_SEGMENT_SECONDS 600
+#define MIN_FEATURE_RATE 1
+#define MAX_FEATURE_RATE 120
 
 class SettingsContentComponent : public juce::Component{
 public:
@@ -72,6 +85,27 @@ private:
 			case SETTINGS_FFT_SIZE:
 				completion(settings.getFFTSize());
 				break;
+			case SETTINGS_RECORDING_MODE:
+				completion(settings.getRecordingMode());
+				break;
+			case SETTINGS_SEGMENT_LENGTH:
+				completion(settings.getSegmentSeconds());
+				break;
+			case SETTINGS_ENCODER_PROFILE:
+				completion(settings.getEncoderProfileID());
+				break;
+			case SETTINGS_ENCODER_CUSTOM:
+				completion(settings.getCustomEncoderProfile().toVar());
+				break;
+			case SETTINGS_STREAM_URL:
+				completion(settings.getStreamUrl());
+				break;
+			case SETTINGS_PREVIEW_OUTPUT:
+				completion(settings.getPreviewOutput());
+				break;
+			case SETTINGS_FEATURE_RATE:
+				completion(settings.getFeatureRate());
+				break;
 			default:
 				completion(-1);
 			}
@@ -84,7 +118,8 @@ private:
 			return;
 		}
 		int setting = args[0].isInt() ? (int) args[0] : -1;
-		int fftSize;
+		int fftSize, recordingMode, segmentSeconds, encoderProfileID, previewOutput, featureRate;
+		EncoderProfile customProfile;
 
 		switch (setting) {
 		case SETTINGS_DIMENSION_WH:
@@ -108,6 +143,82 @@ private:
 			settings.setFFTSize(fftSize);
 			completion(true);
 			break;
+		case SETTINGS_RECORDING_MODE:
+			recordingMode = args[1].toString().getIntValue();
+			if (recordingMode < 0 || recordingMode >= NUM_RECORDING_MODES) {
+				DBG("Recording mode settings attempted to change to an unknown mode: " << args[1].toString());
+				completion(false);
+				break;
+			}
+			settings.setRecordingMode(recordingMode);
+			completion(true);
+			break;
+		case SETTINGS_SEGMENT_LENGTH:
+			segmentSeconds = args[1].toString().getIntValue();
+			if (segmentSeconds < MIN_SEGMENT_SECONDS || segmentSeconds > MAX_SEGMENT_SECONDS) {
+				DBG("Segment length settings attempted to change but the length is outside the acceptable bounds: " << args[1].toString());
+				completion(false);
+				break;
+			}
+			settings.setSegmentSeconds(segmentSeconds);
+			completion(true);
+			break;
+		case SETTINGS_ENCODER_PROFILE:
+			encoderProfileID = args[1].toString().getIntValue();
+			if (encoderProfileID < 0 || encoderProfileID >= NUM_ENCODER_PROFILES) {
+				DBG("Encoder profile settings attempted to change to an unknown profile: " << args[1].toString());
+				completion(false);
+				break;
+			}
+			settings.setEncoderProfileID(encoderProfileID);
+			completion(true);
+			break;
+		case SETTINGS_ENCODER_CUSTOM:
+			// Args are the bitrate in kbps, keyframe interval in seconds, preset, tune and rate control.
+			if (args.size() >= 6) {
+				customProfile.bitRateKbps = args[1].toString().getIntValue();
+				customProfile.keyframeSeconds = args[2].toString().getDoubleValue();
+				customProfile.preset = args[3].toString().getIntValue();
+				customProfile.tune = args[4].toString();
+				customProfile.rateControl = args[5].toString();
+				if (customProfile.isValid()) {
+					settings.setCustomEncoderProfile(customProfile);
+					completion(true);
+					break;
+				}
+				DBG("Custom encoder profile settings attempted to change but the values are outside the acceptable bounds!");
+			}
+			completion(false);
+			break;
+		case SETTINGS_STREAM_URL:
+			if (!isStreamTarget(args[1].toString().trim().toStdString())) {
+				DBG("Stream URL settings attempted to change to an unsupported target: " << args[1].toString());
+				completion(false);
+				break;
+			}
+			settings.setStreamUrl(args[1].toString().trim());
+			completion(true);
+			break;
+		case SETTINGS_PREVIEW_OUTPUT:
+			previewOutput = args[1].toString().getIntValue();
+			if (previewOutput < 0 || previewOutput >= NUM_PREVIEW_OUTPUTS) {
+				DBG("Preview output settings attempted to change to an unknown output: " << args[1].toString());
+				completion(false);
+				break;
+			}
+			settings.setPreviewOutput(previewOutput);
+			completion(true);
+			break;
+		case SETTINGS_FEATURE_RATE:
+			featureRate = args[1].toString().getIntValue();
+			if (featureRate < MIN_FEATURE_RATE || featureRate > MAX_FEATURE_RATE) {
+				DBG("Feature rate settings attempted to change but the rate is outside the acceptable bounds: " << args[1].toString());
+				completion(false);
+				break;
+			}
+			settings.setFeatureRate(featureRate);
+			completion(true);
+			break;
 		default:
 			DBG("Settings change attempted but the settigns ID was unkown! Setting: " << args[0].toString());
 			completion(false);
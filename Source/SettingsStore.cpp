@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    SettingsStore.cpp
+    Created: 19 Oct 2026 6:52:23am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#include "SettingsStore.h"
+#include "AVIOHandler.h"
+
+SettingsStore::SettingsStore(bool useFile, juce::File file)
+    : juce::Thread("Settings Writer"), useFile(useFile), file(file), state(createDefaultState()),
+      alive(std::make_shared<std::atomic<bool>>(true)) {
+    if (useFile && file.getSize() > SETTINGS_MAX_FILE_SIZE) {
+        DBG("The settings in " << file.getFullPathName() << " are too big to be settings, using the defaults.");
+    } else if (useFile && file.existsAsFile()) {
+        std::unique_ptr<juce::XmlElement> xml = juce::parseXML(file);
+        juce::ValueTree loaded = xml != nullptr ? juce::ValueTree::fromXml(*xml) : juce::ValueTree();
+        if (loaded.hasType(state.getType()) && migrate(loaded)) {
+            loadedParameters = takeParameters(loaded);
+            state = loaded;
+        } else {
+            DBG("The settings in " << file.getFullPathName() << " could not be read, using the defaults.");
+        }
+    }
+    snapshot = state.createCopy();
+
+    if (useFile)
+        startThread();
+}
+
+SettingsStore::~SettingsStore() {
+    alive->store(false);
+    signalThreadShouldExit();
+    notify();
+    stopThread(4000); // Writes anything still pending first.
+}
+
+void SettingsStore::set(const juce::Identifier& name, const juce::var& value) {
+    juce::ValueTree settings = state.getChildWithName("Settings");
+    if (settings.hasProperty(name) && settings[name] == value)
+        return;
+    settings.setProperty(name, value, nullptr);
+    changed();
+}
+
+juce::StringArray SettingsStore::getRecentFiles() const {
+    juce::StringArray paths;
+    for (const auto& recent : state.getChildWithName("RecentFiles"))
+        paths.add(recent["path"].toString());
+    return paths;
+}
+
+void SettingsStore::addRecentFile(const juce::File& recentFile) {
+    juce::ValueTree recentFiles = state.getChildWithName("RecentFiles");
+    juce::String path = recentFile.getFullPathName();
+    if (recentFiles.getNumChildren() > 0 && recentFiles.getChild(0)["path"] == path)
+        return;
+    recentFiles.removeChild(recentFiles.getChildWithProperty("path", path), nullptr);
+    recentFiles.addChild(juce::ValueTree("File", { { "path", path } }), 0, nullptr);
+    while (recentFiles.getNumChildren() > SETTINGS_MAX_RECENT_FILES)
+        recentFiles.removeChild(recentFiles.getNumChildren() - 1, nullptr);
+    changed();
+}
+
+void SettingsStore::getState(juce::MemoryBlock& destData, const juce::ValueTree& parameters) {
+    juce::ValueTree tree;
+    {
+        const juce::ScopedLock lock(snapshotLock);
+        tree = snapshot.createCopy();
+    }
+    if (parameters.isValid())
+        tree.appendChild(parameters.createCopy(), nullptr);
+    juce::MemoryOutputStream out(destData, false);
+    out.writeInt(SETTINGS_STORE_MAGIC);
+    out.writeInt(SETTINGS_STORE_VERSION);
+    tree.writeToStream(out);
+}
+
+juce::ValueTree SettingsStore::setState(const void* data, int sizeInBytes) {
+    juce::ValueTree restored = readState(data, sizeInBytes);
+    if (!restored.isValid())
+        return {};
+    juce::ValueTree parameters = takeParameters(restored);
+    {
+        // So the host gets back what it just set, even before it has been applied.
+        const juce::ScopedLock lock(snapshotLock);
+        snapshot = restored.createCopy();
+    }
+    auto* messageManager = juce::MessageManager::getInstanceWithoutCreating();
+    if (messageManager != nullptr && messageManager->isThisTheMessageThread()) {
+        apply(restored);
+        return parameters;
+    }
+    auto flag = alive;
+    juce::MessageManager::callAsync([this, flag, restored]() {
+        if (flag->load())
+            apply(restored);
+    });
+    return parameters;
+}
+
+juce::ValueTree SettingsStore::createDefaultState() {
+    return juce::ValueTree("AudioVisualiserState", { { "version", SETTINGS_STORE_VERSION } }, {
+        juce::ValueTree("Settings"),
+        juce::ValueTree("RecentFiles")
+    });
+}
+
+juce::ValueTree SettingsStore::readState(const void* data, int sizeInBytes) {
+    if (data == nullptr || sizeInBytes < 8)
+        return {};
+    juce::MemoryInputStream in(data, (size_t) sizeInBytes, false);
+    if (in.readInt() != SETTINGS_STORE_MAGIC) {
+        DBG("The host state is not AudioVisualiser state, ignoring it.");
+        return {};
+    }
+    int version = in.readInt();
+    if (version > SETTINGS_STORE_VERSION) {
+        DBG("The host state is from a newer version (" << version << "), ignoring it.");
+        return {};
+    }
+    juce::ValueTree tree = juce::ValueTree::readFromStream(in);
+    if (!tree.hasType("AudioVisualiserState") || !migrate(tree)) {
+        DBG("The host state could not be read, ignoring it.");
+        return {};
+    }
+    return tree;
+}
+
+bool SettingsStore::migrate(juce::ValueTree& tree) {
+    int version = tree.getProperty("version", 0);
+    if (version > SETTINGS_STORE_VERSION)
+        return false;
+    if (version < 2) {
+        // Version 1 kept the parameters cues set on a preset in a Presets child. They are host parameters now,
+        // so they become the Parameters child the host state carries them in.
+        juce::ValueTree presets = tree.getChildWithName("Presets");
+        juce::ValueTree parameters("Parameters");
+        for (const auto& preset : presets) {
+            for (int i = 0; i < preset.getNumProperties(); i++) {
+                juce::Identifier name = preset.getPropertyName(i);
+                if (name == juce::Identifier("id"))
+                    continue;
+                parameters.appendChild(juce::ValueTree("PARAM", {
+                    { "id", getParameterID((int) preset["id"], name.toString()) },
+                    { "value", preset[name] }
+                }), nullptr);
+            }
+        }
+        tree.removeChild(presets, nullptr);
+        if (parameters.getNumChildren() > 0)
+            tree.appendChild(parameters, nullptr);
+    }
+    for (auto* child : { "Settings", "RecentFiles" }) {
+        if (!tree.getChildWithName(child).isValid())
+            tree.appendChild(juce::ValueTree(child), nullptr);
+    }
+    tree.setProperty("version", SETTINGS_STORE_VERSION, nullptr);
+    return true;
+}
+
+juce::ValueTree SettingsStore::takeParameters(juce::ValueTree& tree) {
+    juce::ValueTree parameters = tree.getChildWithName("Parameters");
+    tree.removeChild(parameters, nullptr);
+    return parameters;
+}
+
+void SettingsStore::apply(const juce::ValueTree& restored) {
+    state.copyPropertiesAndChildrenFrom(restored, nullptr);
+    changed();
+    sendChangeMessage();
+}
+
+void SettingsStore::changed() {
+    {
+        const juce::ScopedLock lock(snapshotLock);
+        snapshot = state.createCopy();
+    }
+    if (!useFile)
+        return;
+    {
+        const juce::ScopedLock lock(writeLock);
+        pendingWrite = state.toXmlString();
+    }
+    notify();
+}
+
+void SettingsStore::run() {
+    auto writePending = [this]() {
+        juce::String xml;
+        {
+            const juce::ScopedLock lock(writeLock);
+            xml.swapWith(pendingWrite);
+        }
+        if (xml.isEmpty())
+            return;
+        if (!replaceFileAtomically(file, xml))
+            DBG("Could not write the settings to " << file.getFullPathName());
+    };
+    while (!threadShouldExit()) {
+        wait(-1);
+        writePending();
+    }
+    writePending(); // A change made just before the store was destroyed.
+}
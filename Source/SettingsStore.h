@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    SettingsStore.h
+    Created: 19 Oct 2026 6:52:23am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+#include "ParameterRegistry.h"
+
+#define SETTINGS_STORE_MAGIC 0x54535641 // "AVST" in the first four bytes of the host state.
+#define SETTINGS_STORE_VERSION 2
+#define SETTINGS_STORE_FILE "AudioVisualiser/Settings.xml"
+#define SETTINGS_MAX_RECENT_FILES 10
+#define SETTINGS_MAX_FILE_SIZE (256 * 1024) // Far more than any settings file, so one that is bigger is damaged.
+
+/*
+    Everything the plugin remembers between sessions: the application settings, the selected preset and the
+    files opened most recently.
+
+    It is held in a ValueTree owned by the processor, so it outlives the editor and is what the host saves with
+    a project. Host state is the tree in JUCE's binary ValueTree format after a magic number and the version,
+    with the state of the preset parameters, which belong to the processor's AudioProcessorValueTreeState, as a
+    Parameters child. As a standalone app the tree is also kept in SETTINGS_STORE_FILE as XML, so it can be read
+    and edited by hand. The parameters aren't, since the standalone wrapper saves the host state itself.
+
+    The tree carries SETTINGS_STORE_VERSION. State from an older version is migrated when it is read. State from
+    a newer version is ignored rather than half understood, leaving the defaults.
+
+    The file is written by a background thread with replaceFileAtomically(). Changes made quickly one after
+    another are written once.
+
+    The file is read once, on the message thread, when the processor creates the store. This is deliberate:
+    the processor needs the settings and any migrated parameters before its constructor returns, which a read
+    on the writer thread could only give it by waiting. The file is a few kilobytes of XML, as cheap to read
+    as the PropertiesFile JUCE reads the same way, and one larger than SETTINGS_MAX_FILE_SIZE is ignored
+    rather than read, so a damaged file can't hold up the host.
+
+    The tree is read and changed on the message thread. getState() and setState() may be called by the host on
+    any thread. A state set by the host is applied on the message thread, and listeners are told once it is.
+*/
+class SettingsStore : public juce::ChangeBroadcaster, private juce::Thread {
+public:
+    // Use a file for a standalone app. A plugin's state belongs to the host's project instead.
+    SettingsStore(bool useFile, juce::File file = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory).getChildFile(SETTINGS_STORE_FILE));
+    ~SettingsStore() override;
+
+    juce::var get(const juce::Identifier& name, const juce::var& defaultValue) const {
+        return state.getChildWithName("Settings").getProperty(name, defaultValue);
+    }
+
+    void set(const juce::Identifier& name, const juce::var& value);
+
+    // Full paths, most recent first.
+    juce::StringArray getRecentFiles() const;
+
+    void addRecentFile(const juce::File& file);
+
+    // Any thread. The parameters are the state of the processor's AudioProcessorValueTreeState.
+    void getState(juce::MemoryBlock& destData, const juce::ValueTree& parameters);
+
+    // Any thread. Returns the parameter state that was saved with it, or an invalid tree if there was none.
+    juce::ValueTree setState(const void* data, int sizeInBytes);
+
+    // Parameter state migrated from a version 1 file, for the processor to take once it has been created.
+    juce::ValueTree takeLoadedParameters() {
+        return std::exchange(loadedParameters, {});
+    }
+
+private:
+    bool useFile;
+    juce::File file;
+    juce::ValueTree state;
+    juce::ValueTree loadedParameters;
+    std::shared_ptr<std::atomic<bool>> alive; // Host state set off the message thread is only applied while set.
+
+    juce::CriticalSection snapshotLock;
+    juce::ValueTree snapshot; // A copy of the tree as it was last changed, only used under the lock.
+
+    juce::CriticalSection writeLock;
+    juce::String pendingWrite; // The latest XML the writer hasn't written yet. Empty if there is none.
+
+    static juce::ValueTree createDefaultState();
+    static juce::ValueTree readState(const void* data, int sizeInBytes);
+    static bool migrate(juce::ValueTree& tree);
+    static juce::ValueTree takeParameters(juce::ValueTree& tree);
+
+    void apply(const juce::ValueTree& restored);
+    void changed();
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SettingsStore)
+};
@@ -0,0 +1,344 @@
+/*
+  ==============================================================================
+
+    ShaderValidator.cpp
+    Created: 19 Oct 2026 6:49:07am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#include "ShaderValidator.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+ShaderValidator::ShaderValidator(juce::OpenGLContext& context)
+    : openGLContext(context), alive(std::make_shared<std::atomic<bool>>(true)),
+      scanner(juce::ThreadPoolOptions{}.withThreadName("Shader Validator").withNumberOfThreads(1)) {
+    // A loud signal, since audio reactive shaders tend to do the most work when the audio is loudest.
+    juce::FloatVectorOperations::fill(trialAudio, 1.0f, RING_BUFFER_READ_SIZE);
+}
+
+ShaderValidator::~ShaderValidator() {
+    alive->store(false);
+    scanner.removeAllJobs(true, 1000);
+    delete scanned.exchange(nullptr);
+    if (fbo != 0 || query != 0)
+        DBG("The shader validator was destroyed without releasing its GL objects.");
+}
+
+void ShaderValidator::validate(const juce::String& fragmentShader, bool provisional) {
+    int generation = ++latestGeneration;
+    scanner.addJob([this, generation, fragmentShader, provisional]() {
+        if (generation != latestGeneration.load())
+            return; // A newer shader has already replaced it.
+        juce::String note;
+        juce::String problem = analyseSource(fragmentShader, note);
+        if (problem.isNotEmpty()) {
+            post({ SHADER_REJECTED, problem, 0.0, provisional });
+            return;
+        }
+        delete scanned.exchange(new Candidate{ generation, fragmentShader, provisional, note });
+    });
+}
+
+std::unique_ptr<juce::OpenGLShaderProgram> ShaderValidator::update(const juce::String& vertexShader, std::function<void(GLuint, const FrameUniforms&)> drawTrial, juce::String& fragmentShader) {
+    if (timing != nullptr && timing->generation != latestGeneration.load()) {
+        // Replaced while it was being timed. The query can be reused before its result is read.
+        timing.reset();
+        timingProgram.reset();
+    }
+
+    if (timing != nullptr) {
+        GLint available = 0;
+        juce::gl::glGetQueryObjectiv(query, juce::gl::GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0) {
+            if (++waitedFrames < SHADER_VALIDATION_MAX_WAIT_FRAMES)
+                return nullptr;
+            post({ SHADER_REJECTED, "The trial render did not finish in time.", 0.0, timing->provisional });
+            timing.reset();
+            timingProgram.reset();
+            return nullptr;
+        }
+
+        GLuint64 elapsedNs = 0;
+        juce::gl::glGetQueryObjectui64v(query, juce::gl::GL_QUERY_RESULT, &elapsedNs);
+        GLint viewport[4];
+        juce::gl::glGetIntegerv(juce::gl::GL_VIEWPORT, viewport);
+        double pixelScale = (double) juce::jmax(1, viewport[2] * viewport[3]) / (SHADER_VALIDATION_SIZE * SHADER_VALIDATION_SIZE);
+
+        Verdict verdict;
+        verdict.provisional = timing->provisional;
+        verdict.estimatedMs = (double) elapsedNs / 1000000.0 / SHADER_VALIDATION_FRAMES * pixelScale;
+        verdict.reason = timing->note;
+        if (verdict.estimatedMs > SHADER_REJECT_MS) {
+            verdict.outcome = SHADER_REJECTED;
+            verdict.reason = "Estimated at " + juce::String(verdict.estimatedMs, 1) + "ms per frame, over the "
+                + juce::String(SHADER_REJECT_MS, 0) + "ms budget.";
+        } else if (verdict.estimatedMs > SHADER_WARN_MS) {
+            verdict.outcome = SHADER_HEAVY;
+            verdict.reason = "Estimated at " + juce::String(verdict.estimatedMs, 1) + "ms per frame.";
+        } else if (timing->note.isNotEmpty()) {
+            verdict.outcome = SHADER_HEAVY;
+        }
+        DBG("Shader validation estimated " << verdict.estimatedMs << "ms per frame at " << viewport[2] << "x" << viewport[3] << ".");
+        post(verdict);
+
+        auto passed = std::move(timing);
+        auto program = std::move(timingProgram);
+        if (verdict.outcome == SHADER_REJECTED)
+            return nullptr;
+        fragmentShader = passed->fragmentShader;
+        return program;
+    }
+
+    std::unique_ptr<Candidate> candidate(scanned.exchange(nullptr));
+    if (candidate == nullptr || candidate->generation != latestGeneration.load())
+        return nullptr;
+    auto program = std::make_unique<juce::OpenGLShaderProgram>(openGLContext);
+    if (!program->addVertexShader(vertexShader) || !program->addFragmentShader(candidate->fragmentShader) || !program->link()) {
+        post({ SHADER_REJECTED, "The shader did not compile:\n" + program->getLastError().trim(), 0.0, candidate->provisional });
+        return nullptr;
+    }
+    if (!createTarget()) {
+        // Without a target the shader can't be timed, which is no reason to refuse one that compiles.
+        post({ SHADER_HEAVY, "The shader could not be timed.", 0.0, candidate->provisional });
+        fragmentShader = candidate->fragmentShader;
+        return program;
+    }
+    startTrial(std::move(candidate), std::move(program), drawTrial);
+    return nullptr;
+}
+
+void ShaderValidator::startTrial(std::unique_ptr<Candidate> candidate, std::unique_ptr<juce::OpenGLShaderProgram> program, std::function<void(GLuint, const FrameUniforms&)>& drawTrial) {
+    GLint previousFramebuffer = 0, previousProgram = 0;
+    GLint previousViewport[4];
+    juce::gl::glGetIntegerv(juce::gl::GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    juce::gl::glGetIntegerv(juce::gl::GL_CURRENT_PROGRAM, &previousProgram);
+    juce::gl::glGetIntegerv(juce::gl::GL_VIEWPORT, previousViewport);
+
+    juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, fbo);
+    juce::gl::glViewport(0, 0, SHADER_VALIDATION_SIZE, SHADER_VALIDATION_SIZE);
+    program->use();
+    FrameUniforms uniforms{
+        .time = 0,
+        .leftRMS = 1.0f,
+        .rightRMS = 1.0f,
+        .screenWidth = (float) SHADER_VALIDATION_SIZE,
+        .screenHeight = (float) SHADER_VALIDATION_SIZE,
+        .audioBufferTD = trialAudio
+    };
+    juce::gl::glBeginQuery(juce::gl::GL_TIME_ELAPSED, query);
+    for (int frame = 0; frame < SHADER_VALIDATION_FRAMES; frame++) {
+        uniforms.time = (unsigned int) frame;
+        drawTrial(program->getProgramID(), uniforms);
+    }
+    juce::gl::glEndQuery(juce::gl::GL_TIME_ELAPSED);
+    juce::gl::glFlush(); // Send the trial to the GPU now, so its result is ready in a frame or two.
+
+    juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, (GLuint) previousFramebuffer);
+    juce::gl::glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    juce::gl::glUseProgram((GLuint) previousProgram);
+
+    timing = std::move(candidate);
+    timingProgram = std::move(program);
+    waitedFrames = 0;
+}
+
+bool ShaderValidator::createTarget() {
+    if (fbo != 0)
+        return true;
+    juce::gl::glGenTextures(1, &texture);
+    juce::gl::glBindTexture(juce::gl::GL_TEXTURE_2D, texture);
+    juce::gl::glTexImage2D(juce::gl::GL_TEXTURE_2D, 0, juce::gl::GL_RGBA8, SHADER_VALIDATION_SIZE, SHADER_VALIDATION_SIZE, 0,
+        juce::gl::GL_RGBA, juce::gl::GL_UNSIGNED_BYTE, nullptr);
+    juce::gl::glBindTexture(juce::gl::GL_TEXTURE_2D, 0);
+
+    GLint previousFramebuffer = 0;
+    juce::gl::glGetIntegerv(juce::gl::GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    juce::gl::glGenFramebuffers(1, &fbo);
+    juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, fbo);
+    juce::gl::glFramebufferTexture2D(juce::gl::GL_FRAMEBUFFER, juce::gl::GL_COLOR_ATTACHMENT0, juce::gl::GL_TEXTURE_2D, texture, 0);
+    bool complete = juce::gl::glCheckFramebufferStatus(juce::gl::GL_FRAMEBUFFER) == juce::gl::GL_FRAMEBUFFER_COMPLETE;
+    juce::gl::glBindFramebuffer(juce::gl::GL_FRAMEBUFFER, (GLuint) previousFramebuffer);
+    if (!complete) {
+        DBG("Shader validation FBO creation incomplete!");
+        release();
+        return false;
+    }
+    juce::gl::glGenQueries(1, &query);
+    return true;
+}
+
+void ShaderValidator::release() {
+    timing.reset();
+    timingProgram.reset();
+    if (query != 0)
+        juce::gl::glDeleteQueries(1, &query);
+    if (fbo != 0)
+        juce::gl::glDeleteFramebuffers(1, &fbo);
+    if (texture != 0)
+        juce::gl::glDeleteTextures(1, &texture);
+    query = fbo = texture = 0;
+}
+
+void ShaderValidator::post(const Verdict& verdict) {
+    if (verdict.outcome == SHADER_REJECTED)
+        DBG("Shader rejected: " << verdict.reason);
+    auto flag = alive;
+    juce::MessageManager::callAsync([this, flag, verdict]() {
+        if (flag->load() && onVerdict)
+            onVerdict(verdict);
+    });
+}
+
+namespace {
+    // Bytes of multi byte UTF-8 characters count as identifier characters, so a keyword next to one isn't taken.
+    bool isIdentifierCharacter(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || (unsigned char) c >= 0x80;
+    }
+
+    bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    std::string_view trim(std::string_view text) {
+        size_t start = text.find_first_not_of(" \t\r\n");
+        if (start == std::string_view::npos)
+            return {};
+        return text.substr(start, text.find_last_not_of(" \t\r\n") - start + 1);
+    }
+
+    // The offset of the next keyword in code that isn't part of a longer identifier, or npos.
+    size_t findKeyword(std::string_view code, std::string_view keyword, size_t start) {
+        for (size_t i = code.find(keyword, start); i != std::string_view::npos; i = code.find(keyword, i + 1)) {
+            bool before = i > 0 && isIdentifierCharacter(code[i - 1]);
+            bool after = i + keyword.size() < code.size() && isIdentifierCharacter(code[i + keyword.size()]);
+            if (!before && !after)
+                return i;
+        }
+        return std::string_view::npos;
+    }
+
+    // The text between the parenthesis at or after start and the one that closes it. end is set after it.
+    std::string_view readParenthesised(std::string_view code, size_t start, size_t& end) {
+        size_t open = code.find('(', start);
+        if (open == std::string_view::npos)
+            return {};
+        int depth = 0;
+        for (size_t i = open; i < code.size(); i++) {
+            if (code[i] == '(') {
+                depth++;
+            } else if (code[i] == ')' && --depth == 0) {
+                end = i + 1;
+                return code.substr(open + 1, i - open - 1);
+            }
+        }
+        return {};
+    }
+
+    // The largest integer literal a loop condition compares against, or 0 if it compares against none.
+    double constantBound(std::string_view condition) {
+        if (condition.find_first_of("<>!=") == std::string_view::npos)
+            return 0.0;
+        double bound = 0.0;
+        for (size_t i = 0; i < condition.size();) {
+            if (!isDigit(condition[i])) {
+                i++;
+                continue;
+            }
+            size_t start = i;
+            while (i < condition.size() && (isDigit(condition[i]) || condition[i] == '.'))
+                i++;
+            if (start == 0 || !isIdentifierCharacter(condition[start - 1]))
+                bound = juce::jmax(bound, juce::String(condition.data() + start, i - start).getDoubleValue());
+        }
+        return bound;
+    }
+
+    std::string stripComments(const juce::String& source) {
+        auto* c = source.toRawUTF8();
+        std::string out;
+        out.reserve(source.getNumBytesAsUTF8());
+        while (*c != 0) {
+            if (c[0] == '/' && c[1] == '/') {
+                while (*c != 0 && *c != '\n')
+                    c++;
+            } else if (c[0] == '/' && c[1] == '*') {
+                c += 2;
+                while (*c != 0 && !(c[0] == '*' && c[1] == '/'))
+                    c++;
+                if (*c != 0)
+                    c += 2;
+                out += ' ';
+            } else {
+                out += *c++;
+            }
+        }
+        return out;
+    }
+}
+
+// Scans the UTF-8 bytes once, since indexing a juce::String walks it from the start. Partial shaders are
+// analysed again every time one completes while a prompt streams in.
+juce::String ShaderValidator::analyseSource(const juce::String& fragmentShader, juce::String& note) {
+    const std::string stripped = stripComments(fragmentShader);
+    const std::string_view code = stripped;
+    constexpr size_t none = std::string_view::npos;
+    if (findKeyword(code, "main", 0) == none)
+        return "The shader has no main function.";
+
+    for (size_t at = findKeyword(code, "while", 0); at != none; at = findKeyword(code, "while", at + 1)) {
+        size_t end = at;
+        std::string_view condition = trim(readParenthesised(code, at, end));
+        if (condition == "true" || condition == "1")
+            return "A while loop never ends.";
+        if (note.isEmpty())
+            note = "A while loop may run for a long time.";
+    }
+
+    // Loops open at each point of the code, with the brace depth of their body and their constant bound.
+    struct Loop { int depth; double bound; };
+    std::vector<Loop> loops;
+    int depth = 0;
+    size_t nextFor = findKeyword(code, "for", 0);
+    for (size_t i = 0; i < code.size(); i++) {
+        if (i == nextFor) {
+            size_t end = i;
+            std::string_view header = readParenthesised(code, i, end);
+            std::vector<std::string_view> parts;
+            for (size_t partStart = 0;;) {
+                size_t semicolon = header.find(';', partStart);
+                parts.push_back(header.substr(partStart, semicolon == none ? none : semicolon - partStart));
+                if (semicolon == none)
+                    break;
+                partStart = semicolon + 1;
+            }
+            if (parts.size() == 3 && trim(parts[1]).empty())
+                return "A for loop has no condition and never ends.";
+            double bound = parts.size() == 3 ? constantBound(parts[1]) : 0.0;
+            if (bound <= 0.0 && note.isEmpty())
+                note = "A for loop has a bound that isn't a constant.";
+            // Only loops with a body in braces nest. A single statement is counted on its own.
+            size_t body = code.find('{', end);
+            bool braced = body != none && trim(code.substr(end, body - end)).empty();
+            double iterations = juce::jmax(1.0, bound);
+            for (auto& loop : loops)
+                iterations *= loop.bound;
+            if (iterations > SHADER_MAX_CONSTANT_ITERATIONS && note.isEmpty())
+                note = "Nested loops run about " + juce::String((juce::int64) iterations) + " times per pixel.";
+            if (braced)
+                loops.push_back({ depth + 1, juce::jmax(1.0, bound) });
+            nextFor = findKeyword(code, "for", i + 1);
+        } else if (code[i] == '{') {
+            depth++;
+        } else if (code[i] == '}') {
+            while (!loops.empty() && loops.back().depth == depth)
+                loops.pop_back();
+            depth--;
+        }
+    }
+    return {};
+}
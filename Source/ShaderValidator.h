@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    ShaderValidator.h
+    Created: 19 Oct 2026 6:49:07am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+
+#include "RenderState.h"
+
+#define SHADER_VALIDATION_SIZE 64 // Width and height of the trial render target.
+#define SHADER_VALIDATION_FRAMES 4 // Trial frames timed together, so one slow frame doesn't decide alone.
+#define SHADER_VALIDATION_MAX_WAIT_FRAMES 120 // Live frames to wait for the trial timing before giving up on it.
+#define SHADER_WARN_MS 8.0 // Estimated GPU time per frame at the output size above which a shader is flagged as heavy.
+#define SHADER_REJECT_MS 33.0 // Estimated GPU time per frame at the output size above which a shader is not used.
+#define SHADER_MAX_CONSTANT_ITERATIONS 65536 // Iterations of nested constant loops per pixel above which a shader is flagged.
+
+/*
+    Checks a fragment shader before it replaces the one a render state is drawing with, so a generated or loaded
+    shader can't hang the driver or drop the frame rate in the middle of a show.
+
+    A shader goes through two stages:
+      - On a worker thread, its source is scanned for loops that can never end, which are rejected, and for loops
+        with no constant bound or with nested constant bounds over SHADER_MAX_CONSTANT_ITERATIONS, which are noted.
+      - On the GL thread, it is compiled into a program of its own and drawn SHADER_VALIDATION_FRAMES times to a
+        SHADER_VALIDATION_SIZE square target inside a GL_TIME_ELAPSED query. The result is read on a later frame,
+        once it is available, so the GL thread never waits on the GPU. The time is scaled up by the number of
+        pixels in the live viewport to estimate a frame at full size.
+
+    The trial draw is small, so even a shader far over budget costs the live render very little while it is
+    measured. A shader estimated over SHADER_REJECT_MS is rejected, and one over SHADER_WARN_MS is used but
+    flagged. Only a shader that passes is handed back to replace the current program.
+
+    Shaders that arrive while another is being checked replace it, so only the latest is ever used.
+*/
+class ShaderValidator {
+public:
+    enum Outcome { SHADER_ACCEPTED, SHADER_HEAVY, SHADER_REJECTED };
+
+    struct Verdict {
+        Outcome outcome = SHADER_ACCEPTED;
+        juce::String reason; // Empty for a shader accepted without any notes.
+        double estimatedMs = 0.0; // Estimated GPU time per frame at the output size. 0 if it wasn't measured.
+        bool provisional = false; // As passed to validate().
+    };
+
+    ShaderValidator(juce::OpenGLContext& context);
+    ~ShaderValidator();
+
+    // Starts checking a shader. A provisional shader is one that may not be finished yet, such as one still
+    // streaming in, so its caller can ignore its rejection. Any thread but the GL thread.
+    void validate(const juce::String& fragmentShader, bool provisional);
+
+    /*
+        Moves the check of the latest shader along. Call on the GL thread once per frame, with the live viewport
+        bound. drawTrial is called with the candidate program in use and the trial uniforms, and must draw the
+        render state without changing the program or the framebuffer.
+
+        Returns the compiled program once a shader passes, and sets fragmentShader to its source.
+    */
+    std::unique_ptr<juce::OpenGLShaderProgram> update(const juce::String& vertexShader, std::function<void(GLuint, const FrameUniforms&)> drawTrial, juce::String& fragmentShader);
+
+    // Frees the trial target and query. GL thread, while the context is still current.
+    void release();
+
+    // Called on the message thread with the result of each shader checked to the end.
+    std::function<void(const Verdict&)> onVerdict;
+
+    // Returns why the source can't be used, or an empty string. Sets note for loops that may be expensive,
+    // which flags the shader as heavy whatever its timing, since the trial only sees one set of inputs.
+    static juce::String analyseSource(const juce::String& fragmentShader, juce::String& note);
+
+private:
+    struct Candidate {
+        int generation;
+        juce::String fragmentShader;
+        bool provisional;
+        juce::String note; // From the source scan.
+    };
+
+    juce::OpenGLContext& openGLContext;
+    std::shared_ptr<std::atomic<bool>> alive; // post() won't give onVerdict a verdict once this is cleared.
+    std::atomic<int> latestGeneration{ 0 };
+    std::atomic<Candidate*> scanned{ nullptr }; // Passed the source scan and waiting for the GL thread.
+
+    // GL thread only.
+    std::unique_ptr<Candidate> timing;
+    std::unique_ptr<juce::OpenGLShaderProgram> timingProgram;
+    int waitedFrames = 0;
+    GLuint fbo = 0, texture = 0, query = 0;
+    GLfloat trialAudio[RING_BUFFER_READ_SIZE];
+
+    juce::ThreadPool scanner; // Last, so a scan still running can reach latestGeneration and scanned.
+
+    void startTrial(std::unique_ptr<Candidate> candidate, std::unique_ptr<juce::OpenGLShaderProgram> program, std::function<void(GLuint, const FrameUniforms&)>& drawTrial);
+    bool createTarget();
+    void post(const Verdict& verdict);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ShaderValidator)
+};
@@ -10,16 +10,42 @@
 
 #pragma once
 
-#define SOCKET_CUE_PLAY 0
-#define SOCKET_CUE_STOP 1
-#define SOCKET_CUE_RENDER_STATE_INCREMENT 2
-#define SOCKET_CUE_RENDER_STATE_DECREMENT 3
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "CueProtocol.h"
+#include "CueScheduler.h"
+
+// A cue read from a client, with its value copied out of the frame.
+struct SocketCue {
+    int id;
+    juce::var value;
+};
+
+// How a connection is answered, so every transport runs cues the same way and only frames what it sends back.
+// Called on the message thread, and only while alive is set. The resolver outlives every transport that uses it.
+struct CueReplies {
+    std::shared_ptr<std::atomic<bool>> alive; // The transport's. Cleared when it is destroyed.
+    std::function<void(bool subscribed)> setSubscribed; // SOCKET_CUE_SUBSCRIBE_FEATURES.
+    std::function<void(const void* data, int size)> send; // A query's reply or an ack.
+};
 
 class SocketCueResolver {
 public:
-    SocketCueResolver(SelectorTabPanel& selectorTabPanel) : selectorTabPanel(selectorTabPanel) {}
+    SocketCueResolver(SelectorTabPanel& selectorTabPanel, OpenGLComponent& openGLComponent) : selectorTabPanel(selectorTabPanel), openGLComponent(openGLComponent) {
+        // Scheduled cues run on the GL thread. These bring the message thread up to date afterwards.
+        openGLComponent.onScheduledStateChange = [this](unsigned int state) {
+            this->selectorTabPanel.syncSelectedState(state);
+        };
+        openGLComponent.onScheduledCue = [this](int cueId, const juce::var& body) {
+            postCue(cueId, body);
+        };
+    }
 
-    bool postCue(int cueId, int body) {
+    // body is the cue's value. Text cues always carry an int, binary cues may carry an int, float or string.
+    bool postCue(int cueId, const juce::var& body) {
         switch (cueId) {
         case SOCKET_CUE_PLAY:
             selectorTabPanel.processPlay();
@@ -38,6 +64,138 @@ public:
         }
         return true;
     }
+
+    // Sets a parameter of the selected render state. Returns false if it has no parameter with that name.
+    bool postParam(const juce::String& name, const juce::var& value) {
+        return openGLComponent.setRenderStateParameter(name, value);
+    }
+
+    // Runs a cue on the first frame at or after target, on the given CUE_CLOCK. Safe to call from any thread.
+    // Returns false if the cue can't be scheduled, such as a query or a string longer than
+    // CUE_SCHEDULER_MAX_STRING_LENGTH, or the scheduler is full.
+    bool scheduleCue(int cueId, const char* param, const juce::var& body, int clock, juce::int64 target) {
+        ScheduledCue cue;
+        if (cueId == CUE_PARAM) {
+            if (param == nullptr || strlen(param) == 0 || strlen(param) >= CUE_SCHEDULER_MAX_PARAM_LENGTH)
+                return false;
+            strcpy(cue.param, param);
+        } else if (cueId < SOCKET_CUE_PLAY || cueId > SOCKET_CUE_RENDER_STATE_DECREMENT) {
+            return false;
+        }
+        cue.cueId = cueId;
+        cue.clock = clock;
+        cue.target = target;
+        if (!cue.setValue(body))
+            return false;
+        return openGLComponent.getCueScheduler().schedule(cue);
+    }
+
+    // Parses a text cue, "post:body", where both are integers. Returns false and logs if it isn't one.
+    static bool parseTextCue(const juce::String& text, int& cueId, int& body) {
+        juce::String post = text.upToFirstOccurrenceOf(":", false, false).trim();
+        juce::String value = text.fromFirstOccurrenceOf(":", false, false).trim();
+        juce::String digits = value.startsWithChar('-') ? value.substring(1) : value;
+        if (!text.containsChar(':') || post.isEmpty() || !post.containsOnly("0123456789") || digits.isEmpty() || !digits.containsOnly("0123456789")) {
+            DBG("Socket cue is not an ID and body pair: " << text);
+            return false;
+        }
+        cueId = post.getIntValue();
+        body = value.getIntValue();
+        return true;
+    }
+
+    // Copies the cues out of a frame. Returns false if the frame is malformed.
+    static bool readCues(const CueFrame& frame, std::vector<SocketCue>& cues) {
+        return CueProtocol::forEachCue(frame, [&cues](const CueRecord& record) {
+            cues.push_back({ record.cueId, record.getValue() });
+        });
+    }
+
+    // Runs a text cue on the message thread. A query is answered with its reply, anything else isn't answered.
+    // Safe to call from any thread.
+    void runTextCue(int cueId, int body, CueReplies replies) {
+        juce::MessageManager::callAsync([this, cueId, body, replies = std::move(replies)]() {
+            if (!replies.alive->load())
+                return;
+            if (cueId == SOCKET_CUE_SUBSCRIBE_FEATURES) {
+                replies.setSubscribed(body != 0);
+                return;
+            }
+            juce::String reply;
+            if (queryCue(cueId, reply)) {
+                replies.send(reply.toRawUTF8(), (int) reply.getNumBytesAsUTF8());
+                return;
+            }
+            postCue(cueId, body);
+        });
+    }
+
+    // Runs the cues of one frame together on the message thread, then acks them if the client asked. Queries are
+    // always answered, since the reply travels in the ack. Safe to call from any thread.
+    void runCues(juce::uint32 sequence, bool wantsAck, std::vector<SocketCue> cues, CueReplies replies) {
+        juce::MessageManager::callAsync([this, sequence, wantsAck, cues = std::move(cues), replies = std::move(replies)]() {
+            if (!replies.alive->load())
+                return;
+            int accepted = 0;
+            juce::String reply;
+            for (const SocketCue& cue : cues) {
+                juce::String cueReply;
+                if (cue.id == SOCKET_CUE_SUBSCRIBE_FEATURES) {
+                    replies.setSubscribed((int) cue.value != 0);
+                    accepted++;
+                } else if (queryCue(cue.id, cueReply)) {
+                    reply += cueReply;
+                    accepted++;
+                } else if (postCue(cue.id, cue.value)) {
+                    accepted++;
+                }
+            }
+            if (wantsAck || reply.isNotEmpty()) {
+                juce::MemoryBlock ack = CueProtocol::makeAck(sequence, accepted == (int) cues.size() ? CUE_ACK_OK : CUE_ACK_UNKNOWN_CUE, accepted, reply);
+                replies.send(ack.getData(), (int) ack.getSize());
+            }
+        });
+    }
+
+    // Hands the cues of a scheduled frame to the GL thread's scheduler, straight from the calling thread. Returns
+    // the ack, which only says whether they were scheduled, or an empty block if the client didn't ask for one.
+    juce::MemoryBlock scheduleCues(const CueFrame& frame, const std::vector<SocketCue>& cues) {
+        int accepted = 0;
+        for (const SocketCue& cue : cues) {
+            if (scheduleCue(cue.id, nullptr, cue.value, frame.clock, frame.target))
+                accepted++;
+        }
+        if ((frame.flags & CUE_FLAG_ACK) == 0)
+            return {};
+        return CueProtocol::makeAck(frame.sequence, accepted == (int) cues.size() ? CUE_ACK_OK : CUE_ACK_UNKNOWN_CUE, accepted);
+    }
+
+    // Cues that are answered instead of acted on. Returns false if the cue is not a query.
+    bool queryCue(int cueId, juce::String& reply) {
+        switch (cueId) {
+        case SOCKET_CUE_ENCODER_STATS: {
+            VideoEncoder* encoder = openGLComponent.getVideoEncoder();
+            juce::var result = encoder ? encoder->getStats().toVar() : juce::var(new juce::DynamicObject());
+            auto* object = result.getDynamicObject();
+            object->setProperty("active", encoder != nullptr && encoder->isActive());
+            object->setProperty("recordedMs", encoder ? encoder->getRecordedMilliseconds() : 0);
+            reply = juce::JSON::toString(result, true) + "\n";
+            return true;
+        }
+        case SOCKET_CUE_CLOCK: {
+            auto* object = new juce::DynamicObject();
+            juce::var result(object);
+            object->setProperty("samplePosition", openGLComponent.getAudioSamplePosition());
+            object->setProperty("sampleRate", openGLComponent.getSampleRate());
+            object->setProperty("wallMs", juce::Time::currentTimeMillis());
+            reply = juce::JSON::toString(result, true) + "\n";
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
 private:
     SelectorTabPanel& selectorTabPanel;
+    OpenGLComponent& openGLComponent;
 };
\ No newline at end of file
@@ -0,0 +1,354 @@
+/*
+  ==============================================================================
+
+    SocketReactor.cpp
+    Created: 19 Oct 2026 6:22:20am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#include "SocketReactor.h"
+
+#define SOCKET_WOULD_BLOCK -2
+
+#if JUCE_WINDOWS
+ #include <winsock2.h>
+ typedef WSAPOLLFD PollFd;
+ #define POLL_READABLE POLLRDNORM
+ #define POLL_WRITABLE POLLWRNORM
+ static int pollSockets(PollFd* fds, size_t count, int timeoutMs) {
+     return WSAPoll(fds, (ULONG) count, timeoutMs);
+ }
+ static PollFd makePollFd(int handle, short events) {
+     return { (SOCKET) handle, events, 0 };
+ }
+ static bool setNonBlocking(int handle) {
+     u_long nonBlocking = 1;
+     return ioctlsocket((SOCKET) handle, FIONBIO, &nonBlocking) == 0;
+ }
+ // Bytes read, 0 once the peer has closed, SOCKET_WOULD_BLOCK if there is nothing yet or -1 on an error.
+ static int readSocket(int handle, char* buffer, int size) {
+     int bytes = ::recv((SOCKET) handle, buffer, size, 0);
+     if (bytes == SOCKET_ERROR)
+         return WSAGetLastError() == WSAEWOULDBLOCK ? SOCKET_WOULD_BLOCK : -1;
+     return bytes;
+ }
+ // Bytes written, which is 0 while the socket is full, or -1 on an error.
+ static int writeSocket(int handle, const char* data, int size) {
+     int bytes = ::send((SOCKET) handle, data, size, 0);
+     if (bytes == SOCKET_ERROR)
+         return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+     return bytes;
+ }
+#else
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <poll.h>
+ #include <sys/socket.h>
+ typedef pollfd PollFd;
+ #define POLL_READABLE POLLIN
+ #define POLL_WRITABLE POLLOUT
+ #ifdef MSG_NOSIGNAL
+  #define SOCKET_SEND_FLAGS MSG_NOSIGNAL // A client that hung up mustn't raise SIGPIPE.
+ #else
+  #define SOCKET_SEND_FLAGS 0
+ #endif
+ static int pollSockets(PollFd* fds, size_t count, int timeoutMs) {
+     return ::poll(fds, (nfds_t) count, timeoutMs);
+ }
+ static PollFd makePollFd(int handle, short events) {
+     return { handle, events, 0 };
+ }
+ static bool setNonBlocking(int handle) {
+     int flags = fcntl(handle, F_GETFL, 0);
+     return flags >= 0 && fcntl(handle, F_SETFL, flags | O_NONBLOCK) == 0;
+ }
+ static int readSocket(int handle, char* buffer, int size) {
+     ssize_t bytes = ::recv(handle, buffer, (size_t) size, 0);
+     if (bytes < 0)
+         return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? SOCKET_WOULD_BLOCK : -1;
+     return (int) bytes;
+ }
+ static int writeSocket(int handle, const char* data, int size) {
+     ssize_t bytes = ::send(handle, data, (size_t) size, SOCKET_SEND_FLAGS);
+     if (bytes < 0)
+         return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+     return (int) bytes;
+ }
+#endif
+
+SocketReactor::SocketReactor(juce::StreamingSocket& serverSocket, Listener& listener, int maxClients, int idleTimeoutMs)
+    : juce::Thread("AV Socket Reactor"), serverSocket(serverSocket), listener(listener), maxClients(maxClients), idleTimeoutMs(idleTimeoutMs) {
+    clients.reserve((size_t) maxClients);
+    spareSendQueues.reserve((size_t) maxClients);
+}
+
+SocketReactor::~SocketReactor() {
+    stop();
+}
+
+void SocketReactor::start() {
+    if (!isThreadRunning())
+        startThread();
+}
+
+void SocketReactor::stop() {
+    stopThread(SOCKET_REACTOR_POLL_TIMEOUT_MS * 10);
+    closeAllClients();
+}
+
+bool SocketReactor::send(int clientId, const void* data, int size) {
+    const juce::ScopedLock lock(clientsLock);
+    Client* client = findClient(clientId);
+    if (client == nullptr || client->closing || client->failed)
+        return false;
+    SendQueue& queue = getSendQueue(*client);
+    if (queue.replies.size() - queue.repliesWritten + (size_t) size > SOCKET_SEND_BUFFER_BYTES) {
+        DBG("Socket reactor client " << clientId << " isn't reading its replies. Closing it.");
+        client->failed = true;
+        return false;
+    }
+    if (queue.isEmpty())
+        client->lastProgressMs = juce::Time::getMillisecondCounter();
+    // Drop what has been written, so the buffer only grows with what is still waiting.
+    queue.replies.erase(queue.replies.begin(), queue.replies.begin() + (std::ptrdiff_t) queue.repliesWritten);
+    queue.repliesWritten = 0;
+    queue.replies.insert(queue.replies.end(), (const char*) data, (const char*) data + size);
+    if (!flushSendQueue(*client))
+        client->failed = true;
+    return !client->failed;
+}
+
+bool SocketReactor::publish(int clientId, const void* data, int size) {
+    const juce::ScopedLock lock(clientsLock);
+    Client* client = findClient(clientId);
+    if (client == nullptr || client->closing || client->failed)
+        return false;
+    SendQueue& queue = getSendQueue(*client);
+    if (queue.isEmpty())
+        client->lastProgressMs = juce::Time::getMillisecondCounter();
+    if (queue.count == SOCKET_SEND_QUEUE_PACKETS) {
+        queue.head = (queue.head + 1) % SOCKET_SEND_QUEUE_PACKETS;
+        queue.count--;
+    }
+    std::vector<char>& packet = queue.packets[(queue.head + queue.count) % SOCKET_SEND_QUEUE_PACKETS];
+    packet.assign((const char*) data, (const char*) data + size);
+    queue.count++;
+    if (!flushSendQueue(*client))
+        client->failed = true;
+    return !client->failed;
+}
+
+SocketReactor::Client* SocketReactor::findClient(int clientId) {
+    for (auto& client : clients) {
+        if (client.id == clientId)
+            return &client;
+    }
+    return nullptr;
+}
+
+SocketReactor::SendQueue& SocketReactor::getSendQueue(Client& client) {
+    if (!client.sendQueue) {
+        if (spareSendQueues.empty()) {
+            client.sendQueue = std::make_unique<SendQueue>();
+        } else {
+            client.sendQueue = std::move(spareSendQueues.back());
+            spareSendQueues.pop_back();
+        }
+    }
+    return *client.sendQueue;
+}
+
+// Called with clientsLock held. Returns false if the socket failed.
+bool SocketReactor::flushSendQueue(Client& client) {
+    if (!client.sendQueue)
+        return true;
+    SendQueue& queue = *client.sendQueue;
+    int handle = client.socket->getRawSocketHandle();
+    while (!queue.isEmpty()) {
+        int written;
+        if (queue.repliesWritten < queue.replies.size()) {
+            written = writeSocket(handle, queue.replies.data() + queue.repliesWritten, (int) (queue.replies.size() - queue.repliesWritten));
+            if (written > 0)
+                queue.repliesWritten += (size_t) written;
+            if (queue.repliesWritten == queue.replies.size()) {
+                queue.replies.clear();
+                queue.repliesWritten = 0;
+            }
+        } else {
+            std::vector<char>& packet = queue.packets[queue.head];
+            written = writeSocket(handle, packet.data(), (int) packet.size());
+            if (written > 0) {
+                if (written < (int) packet.size())
+                    queue.replies.assign(packet.begin() + written, packet.end());
+                queue.head = (queue.head + 1) % SOCKET_SEND_QUEUE_PACKETS;
+                queue.count--;
+            }
+        }
+        if (written < 0)
+            return false;
+        if (written == 0)
+            return true; // Full. The reactor finishes it when the socket is writable.
+        client.lastProgressMs = client.lastActivityMs = juce::Time::getMillisecondCounter();
+    }
+    return true;
+}
+
+void SocketReactor::recycleSendQueue(Client& client) {
+    if (!client.sendQueue)
+        return;
+    // The buffers keep their capacity for whoever gets the queue next.
+    client.sendQueue->replies.clear();
+    client.sendQueue->repliesWritten = 0;
+    client.sendQueue->head = 0;
+    client.sendQueue->count = 0;
+    spareSendQueues.push_back(std::move(client.sendQueue));
+}
+
+int SocketReactor::getNumClients() {
+    const juce::ScopedLock lock(clientsLock);
+    return (int) clients.size();
+}
+
+void SocketReactor::run() {
+    std::vector<PollFd> fds;
+    std::vector<int> ids; // The client id of each entry in fds after the listener.
+    std::vector<int> closed;
+
+    while (!threadShouldExit()) {
+        closeIdleClients(closed);
+
+        fds.clear();
+        ids.clear();
+        fds.push_back(makePollFd(serverSocket.getRawSocketHandle(), POLL_READABLE));
+        {
+            const juce::ScopedLock lock(clientsLock);
+            for (auto& client : clients) {
+                short events = client.closing ? 0 : POLL_READABLE;
+                if (client.sendQueue && !client.sendQueue->isEmpty())
+                    events |= POLL_WRITABLE;
+                fds.push_back(makePollFd(client.socket->getRawSocketHandle(), events));
+                ids.push_back(client.id);
+            }
+        }
+
+        int ready = pollSockets(fds.data(), fds.size(), SOCKET_REACTOR_POLL_TIMEOUT_MS);
+        if (ready <= 0)
+            continue;
+
+        // Only this thread removes clients, so every socket in fds is still open and at the same index.
+        closed.clear();
+        for (size_t i = 1; i < fds.size(); i++) {
+            short events = fds[i].revents;
+            if (events == 0)
+                continue;
+            const int clientId = ids[i - 1];
+            bool closing;
+            {
+                const juce::ScopedLock lock(clientsLock);
+                Client& client = clients[i - 1];
+                client.lastActivityMs = juce::Time::getMillisecondCounter();
+                if ((events & POLL_WRITABLE) != 0 && !flushSendQueue(client))
+                    client.failed = true;
+                closing = client.closing;
+            }
+            if (closing) {
+                // Only writes are waited for. A hang up or error means they never will be.
+                if ((events & ~POLL_WRITABLE) != 0)
+                    closed.push_back(clientId);
+                continue;
+            }
+            if ((events & ~POLL_WRITABLE) == 0)
+                continue;
+            // A hang up or error reads as 0 or -1, so every other event goes through read.
+            int bytesRead = readSocket((int) fds[i].fd, readBuffer, SOCKET_REACTOR_READ_SIZE);
+            if (bytesRead == SOCKET_WOULD_BLOCK)
+                continue;
+            if (bytesRead <= 0) {
+                closed.push_back(clientId);
+            } else if (!listener.dataReceived(clientId, readBuffer, bytesRead)) {
+                const juce::ScopedLock lock(clientsLock);
+                clients[i - 1].closing = true;
+                clients[i - 1].lastProgressMs = juce::Time::getMillisecondCounter();
+            }
+        }
+        for (int clientId : closed)
+            closeClient(clientId);
+
+        if (fds[0].revents != 0)
+            acceptClient();
+    }
+}
+
+void SocketReactor::acceptClient() {
+    // The listener is readable, so this returns straight away.
+    std::unique_ptr<juce::StreamingSocket> socket(serverSocket.waitForNextConnection());
+    if (!socket)
+        return;
+    if (getNumClients() >= maxClients) {
+        DBG("Socket reactor is full (" << maxClients << " clients), rejecting " << socket->getHostName() << ".");
+        socket->close();
+        return;
+    }
+    if (!setNonBlocking(socket->getRawSocketHandle())) {
+        DBG("Socket reactor could not make the socket for " << socket->getHostName() << " non-blocking, rejecting it.");
+        socket->close();
+        return;
+    }
+    int clientId = nextClientId++;
+    DBG("Socket reactor accepted client " << clientId << " (" << socket->getHostName() << ").");
+    {
+        const juce::ScopedLock lock(clientsLock);
+        clients.push_back({ clientId, std::move(socket), juce::Time::getMillisecondCounter() });
+    }
+    listener.clientConnected(clientId);
+}
+
+void SocketReactor::closeClient(int clientId) {
+    {
+        const juce::ScopedLock lock(clientsLock);
+        for (auto it = clients.begin(); it != clients.end(); ++it) {
+            if (it->id == clientId) {
+                it->socket->close();
+                recycleSendQueue(*it);
+                clients.erase(it);
+                break;
+            }
+        }
+    }
+    DBG("Socket reactor client " << clientId << " disconnected.");
+    listener.clientDisconnected(clientId);
+}
+
+void SocketReactor::closeAllClients() {
+    const juce::ScopedLock lock(clientsLock);
+    for (auto& client : clients) {
+        client.socket->close();
+        recycleSendQueue(client);
+    }
+    clients.clear();
+}
+
+// Closes clients that went quiet, that failed a write, that stopped taking their output, or that finished
+// writing it after being asked to close.
+void SocketReactor::closeIdleClients(std::vector<int>& idle) {
+    idle.clear();
+    juce::uint32 now = juce::Time::getMillisecondCounter();
+    {
+        const juce::ScopedLock lock(clientsLock);
+        for (auto& client : clients) {
+            bool waiting = client.sendQueue && !client.sendQueue->isEmpty();
+            // Unsigned subtraction, so this survives the counter wrapping.
+            if (client.failed
+                || (client.closing && !waiting)
+                || ((waiting || client.closing) && now - client.lastProgressMs > (juce::uint32) SOCKET_REACTOR_STALL_TIMEOUT_MS)
+                || (idleTimeoutMs > 0 && now - client.lastActivityMs > (juce::uint32) idleTimeoutMs))
+                idle.push_back(client.id);
+        }
+    }
+    for (int clientId : idle) {
+        DBG("Socket reactor is closing client " << clientId << ".");
+        closeClient(clientId);
+    }
+}
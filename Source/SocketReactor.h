@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    SocketReactor.h
+    Created: 19 Oct 2026 6:22:20am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+#define SOCKET_REACTOR_POLL_TIMEOUT_MS 100 // Bounds how long stop() takes, and how long output another thread couldn't write waits to be watched for.
+#define SOCKET_REACTOR_READ_SIZE 65536
+#define SOCKET_SEND_QUEUE_PACKETS 8 // Published packets held for a slow client before the oldest is dropped.
+#define SOCKET_SEND_BUFFER_BYTES (1 << 20) // Replies waiting for a client past which it is closed for not reading them.
+#define SOCKET_REACTOR_STALL_TIMEOUT_MS 10000 // Clients with output waiting that take none of it for this long are closed.
+#define SOCKET_REACTOR_MAX_CLIENTS 64 // Connections past this are closed as soon as they are accepted.
+#define SOCKET_REACTOR_IDLE_TIMEOUT_MS 300000 // Clients that neither send nor receive for this long are closed. 0 never closes them.
+
+/*
+    Serves a listening socket and all of its clients from a single thread.
+
+    The thread sleeps in poll() (WSAPoll() on Windows) on the listener and every client at once, so a cue is read
+    the moment it arrives and an idle server uses no CPU. Everything a client sends is handed to the listener in
+    whatever pieces the network delivered it, so the listener is responsible for finding message boundaries.
+    Clients that disconnect are closed and forgotten.
+
+    At most maxClients are connected at once, and clients that go quiet for idleTimeoutMs are closed, so a peer
+    that vanished without a FIN can't hold a slot forever. Listeners can keep their per-client state in a
+    ClientRegistry of the same size. Send queues are kept when their client leaves and handed to the next one,
+    so memory stays flat however many clients come and go.
+
+    Clients are referred to by an id that is never reused, so other threads can reply to a client that may have
+    disconnected in the meantime.
+
+    Client sockets are non-blocking and nothing ever waits on a write. Output is queued per client and written
+    as far as the socket takes it straight away, and the rest when poll() says the socket is writable. Replies
+    are kept whole and in order. Published packets are dropped oldest first when a client falls behind. A client
+    that lets SOCKET_SEND_BUFFER_BYTES of replies pile up, or takes none of its output for
+    SOCKET_REACTOR_STALL_TIMEOUT_MS, is closed.
+*/
+class SocketReactor : private juce::Thread {
+public:
+    struct Listener {
+        virtual ~Listener() = default;
+        virtual void clientConnected(int clientId) { juce::ignoreUnused(clientId); }
+        // Called on the reactor thread. data is only valid for the duration of the call. Returning false closes the
+        // client once what has already been sent to it is written, so a last reply still arrives.
+        virtual bool dataReceived(int clientId, const char* data, int size) = 0;
+        virtual void clientDisconnected(int clientId) { juce::ignoreUnused(clientId); }
+    };
+
+    SocketReactor(juce::StreamingSocket& serverSocket, Listener& listener, int maxClients = SOCKET_REACTOR_MAX_CLIENTS, int idleTimeoutMs = SOCKET_REACTOR_IDLE_TIMEOUT_MS);
+    ~SocketReactor() override;
+
+    void start();
+    void stop();
+
+    bool isRunning() {
+        return isThreadRunning();
+    }
+
+    // Queues a reply for a client from any thread, and writes what the socket will take without blocking. Replies
+    // are never dropped. Returns false if the client has gone, is closing, or has too many replies waiting.
+    bool send(int clientId, const void* data, int size);
+
+    // The same for a packet that a newer one makes stale. When a slow client already has SOCKET_SEND_QUEUE_PACKETS
+    // waiting the oldest is dropped, so a client that falls behind gets the newest data rather than holding
+    // everyone up. Returns false if the client has gone or is closing.
+    bool publish(int clientId, const void* data, int size);
+
+    int getNumClients();
+
+private:
+    // Output waiting for a client. Replies, and the rest of a packet the socket only took part of, are written
+    // first, since a message cut short would corrupt the stream. Then the ring of published packets. Each
+    // buffer keeps its capacity, so a steady stream of packets stops allocating.
+    struct SendQueue {
+        std::vector<char> replies;
+        size_t repliesWritten = 0;
+        std::vector<char> packets[SOCKET_SEND_QUEUE_PACKETS];
+        int head = 0, count = 0;
+
+        bool isEmpty() const {
+            return repliesWritten == replies.size() && count == 0;
+        }
+    };
+
+    struct Client {
+        int id;
+        std::unique_ptr<juce::StreamingSocket> socket;
+        juce::uint32 lastActivityMs;
+        std::unique_ptr<SendQueue> sendQueue; // Taken from spareSendQueues the first time something is sent.
+        juce::uint32 lastProgressMs = 0; // When output last started waiting or was last written.
+        bool closing = false; // Not read from any more, and closed once its output is written.
+        bool failed = false; // Closed on the next pass of the reactor.
+    };
+
+    juce::StreamingSocket& serverSocket;
+    Listener& listener;
+    const int maxClients;
+    const int idleTimeoutMs;
+
+    // Only the reactor thread changes the list. clientsLock is held while it does, and by send() and publish().
+    juce::CriticalSection clientsLock;
+    std::vector<Client> clients;
+    std::vector<std::unique_ptr<SendQueue>> spareSendQueues;
+    int nextClientId = 1;
+
+    char readBuffer[SOCKET_REACTOR_READ_SIZE];
+
+    void run() override;
+    void acceptClient();
+    void closeClient(int clientId);
+    void closeAllClients();
+    void closeIdleClients(std::vector<int>& idle);
+    Client* findClient(int clientId);
+    SendQueue& getSendQueue(Client& client);
+    void recycleSendQueue(Client& client);
+    bool flushSendQueue(Client& client);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SocketReactor)
+};
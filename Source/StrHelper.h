@@ -11,6 +11,7 @@
 #pragma once
 
 #include <regex>
+#include <cctype>
 #include <string>
 
 inline bool isValidFilename(const std::string& filename) {
@@ -29,3 +30,14 @@ inline bool isMP4(const std::string&filename) {
 inline bool isValidVidFileStr(const std::string& filename) {
     return isValidFilename(filename) && isMP4(filename);
 }
+
+
+// A network target that VideoEncoder streams to instead of writing a file. Matches StreamOutput::getFormatName.
+inline bool isStreamTarget(const std::string& target) {
+    std::string lower = target;
+    for (char& c : lower)
+        c = (char) std::tolower((unsigned char) c);
+    if (lower.rfind("rtmp://", 0) == 0 || lower.rfind("rtmps://", 0) == 0 || lower.rfind("srt://", 0) == 0)
+        return lower.length() > lower.find("://") + 3; // Needs a host after the scheme.
+    return lower.length() > 5 && lower.substr(lower.length() - 5) == ".m3u8";
+}
\ No newline at end of file
@@ -0,0 +1,272 @@
+/*
+  ==============================================================================
+
+    StreamOutput.cpp
+    Created: 19 Oct 2026 6:16:52am
+    Author:  lucas
+
+    Sources:
+    * https://github.com/FFmpeg/FFmpeg/blob/master/doc/examples/remux.c
+    * https://ffmpeg.org/ffmpeg-formats.html#flv
+    * https://ffmpeg.org/ffmpeg-formats.html#hls-2
+    * https://ffmpeg.org/ffmpeg-protocols.html#srt
+
+  ==============================================================================
+*/
+
+#include "StreamOutput.h"
+
+StreamOutput::StreamOutput() : juce::Thread("AV Stream Output") {
+}
+
+StreamOutput::~StreamOutput() {
+    stop();
+    for (AVPacket* packet : sparePackets)
+        av_packet_free(&packet);
+    avcodec_parameters_free(&codecParameters);
+}
+
+const char* StreamOutput::getFormatName(const juce::String& target) {
+    if (target.startsWithIgnoreCase("rtmp://") || target.startsWithIgnoreCase("rtmps://"))
+        return "flv";
+    if (target.startsWithIgnoreCase("srt://"))
+        return "mpegts";
+    if (target.endsWithIgnoreCase(".m3u8"))
+        return "hls";
+    return nullptr;
+}
+
+bool StreamOutput::start(const juce::String& targetUrl, const AVCodecContext* codecContext) {
+    if (isThreadRunning())
+        return false;
+    formatName = getFormatName(targetUrl);
+    if (!formatName) {
+        DBG("Stream output does not know how to send to " << targetUrl << "!");
+        return false;
+    }
+    url = targetUrl;
+
+    // The muxer is created on the I/O thread, possibly many times, so it gets its own copy of the stream parameters.
+    if (!codecParameters)
+        codecParameters = avcodec_parameters_alloc();
+    if (!codecParameters || avcodec_parameters_from_context(codecParameters, codecContext) < 0) {
+        DBG("Stream output could not copy the codec parameters!");
+        return false;
+    }
+    codecTimeBase = codecContext->time_base;
+
+    {
+        const juce::ScopedLock lock(queueLock);
+        waitingForKeyframe = true;
+    }
+    droppedPackets.store(0);
+    abortIO.store(false);
+    startThread();
+    return true;
+}
+
+void StreamOutput::push(const AVPacket* packet) {
+    bool isKeyframe = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    {
+        const juce::ScopedLock lock(queueLock);
+
+        // The network is behind. Stale video is worth less than a prompt recovery, so everything that is queued goes.
+        if (!queue.empty()) {
+            juce::int64 queuedMs = av_rescale_q(packet->dts - queue.front()->dts, codecTimeBase, av_make_q(1, 1000));
+            if (queuedMs > STREAM_MAX_QUEUE_MS || queue.size() >= STREAM_MAX_QUEUE_PACKETS) {
+                DBG("Stream output is " << queuedMs << "ms behind. Dropping " << (int) queue.size() << " packets.");
+                dropQueue();
+            }
+        }
+
+        // Packets after a drop can't be decoded until the next keyframe, so there is no point sending them.
+        if (waitingForKeyframe && !isKeyframe) {
+            droppedPackets++;
+            return;
+        }
+        waitingForKeyframe = false;
+
+        AVPacket* queued = nullptr;
+        if (!sparePackets.empty()) {
+            queued = sparePackets.back();
+            sparePackets.pop_back();
+        } else {
+            queued = av_packet_alloc();
+        }
+        if (!queued || av_packet_ref(queued, packet) < 0) {
+            av_packet_free(&queued);
+            droppedPackets++;
+            return;
+        }
+        queue.push_back(queued);
+    }
+    notify();
+}
+
+void StreamOutput::stop() {
+    if (!isThreadRunning())
+        return;
+    signalThreadShouldExit();
+    notify();
+    // Give the thread time to send what is left. After that, any blocking network call is interrupted.
+    if (!waitForThreadToExit(STREAM_STOP_TIMEOUT_MS)) {
+        DBG("Stream output did not finish sending in time. Aborting.");
+        abortIO.store(true);
+        waitForThreadToExit(-1);
+    }
+    const juce::ScopedLock lock(queueLock);
+    dropQueue();
+}
+
+void StreamOutput::run() {
+    int backoffMs = STREAM_RECONNECT_MIN_MS;
+    while (!threadShouldExit()) {
+        if (!oc) {
+            if (!connect()) {
+                wait(backoffMs);
+                backoffMs = juce::jmin(backoffMs * 2, STREAM_RECONNECT_MAX_MS);
+                continue;
+            }
+            backoffMs = STREAM_RECONNECT_MIN_MS;
+        }
+
+        if (!writeNextPacket())
+            wait(100); // Woken up by push as soon as there is something to send.
+    }
+
+    // Send what is left, then close the stream properly so that the receiver sees the end of it.
+    if (oc) {
+        while (!abortIO.load() && writeNextPacket()) {}
+        disconnect(true);
+    }
+}
+
+bool StreamOutput::connect() {
+    int ret;
+    DBG("Stream output connecting to " << url << ".");
+
+    ret = avformat_alloc_output_context2(&oc, NULL, formatName, url.toRawUTF8());
+    if (ret < 0 || !oc) {
+        DBG("Stream output could not create a " << formatName << " muxer!");
+        oc = nullptr;
+        return false;
+    }
+    oc->interrupt_callback = { &interruptCallback, this };
+
+    stream = avformat_new_stream(oc, NULL);
+    if (!stream || avcodec_parameters_copy(stream->codecpar, codecParameters) < 0) {
+        disconnect(false);
+        return false;
+    }
+    stream->time_base = codecTimeBase;
+
+    if (!(oc->oformat->flags & AVFMT_NOFILE)) {
+        AVDictionary* ioOpt = NULL;
+        av_dict_set(&ioOpt, "rw_timeout", STREAM_IO_TIMEOUT_US, 0); // A dead connection fails instead of blocking forever.
+        ret = avio_open2(&oc->pb, url.toRawUTF8(), AVIO_FLAG_WRITE, &oc->interrupt_callback, &ioOpt);
+        av_dict_free(&ioOpt);
+        if (ret < 0) {
+            char errbuf[AV_ERROR_MAX_STRING_SIZE];
+            av_strerror(ret, errbuf, sizeof(errbuf));
+            DBG("Stream output could not connect: " << errbuf);
+            disconnect(false);
+            return false;
+        }
+    }
+
+    AVDictionary* muxerOpt = NULL;
+    if (juce::String(formatName) == "flv")
+        av_dict_set(&muxerOpt, "flvflags", "no_duration_filesize", 0); // The stream can't be seeked back to.
+    if (juce::String(formatName) == "hls") {
+        av_dict_set(&muxerOpt, "hls_time", "2", 0);
+        av_dict_set(&muxerOpt, "hls_list_size", "6", 0);
+        av_dict_set(&muxerOpt, "hls_flags", "delete_segments", 0);
+    }
+    ret = avformat_write_header(oc, &muxerOpt);
+    av_dict_free(&muxerOpt);
+    if (ret < 0) {
+        DBG("Stream output could not write the stream header!");
+        disconnect(false);
+        return false;
+    }
+
+    // Whatever was queued while disconnected is stale, and the receiver needs a keyframe to start decoding.
+    {
+        const juce::ScopedLock lock(queueLock);
+        dropQueue();
+    }
+    keyframeRequested.store(true);
+    connected.store(true);
+    DBG("Stream output connected to " << url << ".");
+    return true;
+}
+
+void StreamOutput::disconnect(bool writeTrailer) {
+    if (!oc)
+        return;
+    if (writeTrailer)
+        av_write_trailer(oc);
+    if (!(oc->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&oc->pb);
+    avformat_free_context(oc);
+    oc = nullptr;
+    stream = nullptr;
+    connected.store(false);
+}
+
+bool StreamOutput::writeNextPacket() {
+    AVPacket* packet = popPacket();
+    if (!packet)
+        return false;
+
+    av_packet_rescale_ts(packet, codecTimeBase, stream->time_base);
+    packet->stream_index = stream->index;
+    int ret = av_interleaved_write_frame(oc, packet);
+    recyclePacket(packet);
+
+    if (ret < 0) {
+        char errbuf[AV_ERROR_MAX_STRING_SIZE];
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        DBG("Stream output lost the connection: " << errbuf << ". Reconnecting.");
+        disconnect(false);
+        return false;
+    }
+    return true;
+}
+
+AVPacket* StreamOutput::popPacket() {
+    const juce::ScopedLock lock(queueLock);
+    if (queue.empty())
+        return nullptr;
+    AVPacket* packet = queue.front();
+    queue.pop_front();
+    return packet;
+}
+
+void StreamOutput::recyclePacket(AVPacket* packet) {
+    av_packet_unref(packet);
+    const juce::ScopedLock lock(queueLock);
+    if (sparePackets.size() < STREAM_SPARE_PACKETS)
+        sparePackets.push_back(packet);
+    else
+        av_packet_free(&packet);
+}
+
+// Must be called with queueLock held.
+void StreamOutput::dropQueue() {
+    droppedPackets += (juce::int64) queue.size();
+    for (AVPacket* packet : queue) {
+        av_packet_unref(packet);
+        if (sparePackets.size() < STREAM_SPARE_PACKETS)
+            sparePackets.push_back(packet);
+        else
+            av_packet_free(&packet);
+    }
+    queue.clear();
+    waitingForKeyframe = true;
+    keyframeRequested.store(true);
+}
+
+int StreamOutput::interruptCallback(void* opaque) {
+    return ((StreamOutput*) opaque)->abortIO.load() ? 1 : 0;
+}
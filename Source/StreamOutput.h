@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    StreamOutput.h
+    Created: 19 Oct 2026 6:16:52am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <deque>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#define STREAM_MAX_QUEUE_MS 2000 // Once this much video is waiting to be sent, the network is behind and the queue is dropped.
+#define STREAM_MAX_QUEUE_PACKETS 1024
+#define STREAM_RECONNECT_MIN_MS 500
+#define STREAM_RECONNECT_MAX_MS 8000
+#define STREAM_STOP_TIMEOUT_MS 3000
+#define STREAM_IO_TIMEOUT_US "5000000"
+#define STREAM_SPARE_PACKETS 64
+
+/*
+    Sends encoded packets to a network target: rtmp:// and rtmps:// as FLV, srt:// as MPEG-TS, and a path ending in
+    .m3u8 as HLS.
+
+    The encoding thread only queues references to its packets. Connecting, muxing and sending all happen on the
+    stream's I/O thread, so a slow or dead connection never stalls encoding. If the connection drops, the thread
+    reconnects with a growing backoff. If the queue backs up past STREAM_MAX_QUEUE_MS, the queued packets are
+    dropped and packets are skipped until the next keyframe so the receiver can decode again straight away. A
+    keyframe is requested from the encoder whenever that happens.
+*/
+class StreamOutput : private juce::Thread {
+public:
+    StreamOutput();
+    ~StreamOutput() override;
+
+    // The muxer used for a stream target, or nullptr if the target is not a stream.
+    static const char* getFormatName(const juce::String& target);
+
+    // Starts the I/O thread, which connects in the background. The codec context must already be open.
+    bool start(const juce::String& url, const AVCodecContext* codecContext);
+
+    // Queues a packet in the codec's time base. Called on the encoding thread. The packet is referenced, not copied.
+    void push(const AVPacket* packet);
+
+    // Sends whatever is still queued for up to STREAM_STOP_TIMEOUT_MS, then closes the connection.
+    void stop();
+
+    bool isConnected() {
+        return connected.load();
+    }
+
+    // Returns true once after packets were dropped or a new connection was made. The encoder should then make
+    // the next frame a keyframe.
+    bool takeKeyframeRequest() {
+        return keyframeRequested.exchange(false);
+    }
+
+    juce::int64 getDroppedPackets() {
+        return droppedPackets.load();
+    }
+
+private:
+    juce::String url;
+    const char* formatName = nullptr;
+    AVCodecParameters* codecParameters = nullptr;
+    AVRational codecTimeBase;
+
+    // Only touched on the I/O thread.
+    AVFormatContext* oc = nullptr;
+    AVStream* stream = nullptr;
+
+    juce::CriticalSection queueLock;
+    std::deque<AVPacket*> queue;
+    std::vector<AVPacket*> sparePackets;
+    bool waitingForKeyframe = true; // Guarded by queueLock.
+
+    std::atomic<bool> connected{ false };
+    std::atomic<bool> keyframeRequested{ false };
+    std::atomic<bool> abortIO{ false };
+    std::atomic<juce::int64> droppedPackets{ 0 };
+
+    void run() override;
+    bool connect();
+    void disconnect(bool writeTrailer);
+    bool writeNextPacket();
+    AVPacket* popPacket();
+    void recyclePacket(AVPacket* packet);
+    void dropQueue();
+    static int interruptCallback(void* opaque);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StreamOutput)
+};
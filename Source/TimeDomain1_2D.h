@@ -12,6 +12,7 @@
 
 #include <JuceHeader.h>
 #include "RenderState2D.h"
+#include "PresetParameters.h"
 
 class TimeDomain1_2D : public RenderState2D {
 public:
@@ -31,6 +32,8 @@ public:
     uniform float screenWidth;
     uniform float screenHeight;
     uniform float audioBufferTD[256];
+    uniform float gain;
+    uniform vec3 background;
 
     out vec4 outColour;
 
@@ -38,13 +41,13 @@ public:
         vec2 uv = gl_FragCoord.xy / vec2(screenWidth, screenHeight);
         vec2 audioBufferLocation = vec2(mix(0.0f, 255.0f, uv.x), mix(0.0f, 255.0f, uv.x));
     
-        outColour = vec4(
+        outColour = vec4(background + vec3(
             0.0f,
-            mix(0, 1, audioBufferTD[int(audioBufferLocation.x)]) * 1.5f,
-            mix(0, 1, audioBufferTD[int(audioBufferLocation.y)]) * 1.5f,
+            mix(0, 1, audioBufferTD[int(audioBufferLocation.x)]) * gain,
+            mix(0, 1, audioBufferTD[int(audioBufferLocation.y)]) * gain),
             1.0);
     }
-)")) {
+)"), getBuiltInParameterSpecs(id)) {
         renderProfile.setPresetName("TD1");
     }
 };
\ No newline at end of file
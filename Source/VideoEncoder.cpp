@@ -22,90 +22,168 @@
 
 #include "Texture.h"
 
-VideoEncoder::VideoEncoder(int width, int height) : width(width), height(height), memcopyStruct({0}) {
-    DBG("New VideoEncoder instance created. Width " << width << " Height " << height << ".");
+VideoEncoder::VideoEncoder(int width, int height, int frameRate, AVBufferRef* sharedDevice) : juce::Thread("AV Video Encoder"), width(width), height(height), frameRate(frameRate) {
+    DBG("New VideoEncoder instance created. Width " << width << " Height " << height << " at " << frameRate << "fps.");
+#if AV_USE_NVENC
+    memcopyStruct = { 0 };
+#endif
     active = false;
     texture_id = create_gl_texture_id(width, height);
+
+    // Everything that doesn't depend on the output file is set up now, so starting a recording only has to open the muxer.
+    coreReady = initialiseCore(sharedDevice);
 }
 
-bool VideoEncoder::initialiseVideo(OutputStream* ost, AVFormatContext* oc, const AVCodec** codec) {
-    AVCodecContext* codecContext;
-    int i, ret;
+VideoEncoder::~VideoEncoder() {
+    finishRecordingSession();
+    releaseVideo();
+    releaseFrames();
+    av_packet_free(&video_st.tmp_pkt);
+    av_buffer_unref(&avBufferDevice);
+    juce::gl::glDeleteTextures(1, &texture_id);
+}
 
-    // Find the encoder using the codec_id discovered from the AVOutputFormat
-    *codec = avcodec_find_encoder_by_name("h264_nvenc");
-    if (!(*codec)) {
-        DBG("Could not find encoder for '%s'\n",
-            avcodec_get_name(codec_id));
+bool VideoEncoder::initialiseCore(AVBufferRef* sharedDevice) {
+    // Prefer NVENC. Without a CUDA device, fall back to a CPU encoder so that exports still work.
+    video_codec = nullptr;
+#if AV_USE_NVENC
+    juce::String gpuName;
+    if (getDeviceName(gpuName) > 0)
+        video_codec = avcodec_find_encoder_by_name("h264_nvenc");
+    if (video_codec && !initialiseCudaDevice(sharedDevice))
+        video_codec = nullptr;
+#else
+    juce::ignoreUnused(sharedDevice);
+#endif
+    backend = video_codec ? EncoderBackend::nvenc : EncoderBackend::software;
+
+    if (backend == EncoderBackend::software) {
+        DBG("No CUDA device is available. Falling back to software encoding.");
+        video_codec = avcodec_find_encoder_by_name("libx264");
+        if (!video_codec)
+            video_codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+        if (!video_codec)
+            video_codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    }
+    if (!video_codec) {
+        DBG("Could not find a video encoder.");
         return false;
     }
 
     // Create an initial temp packet for the output stream struct.
-    ost->tmp_pkt = av_packet_alloc();
-    if (!ost->tmp_pkt) {
+    video_st.tmp_pkt = av_packet_alloc();
+    if (!video_st.tmp_pkt) {
         DBG("Could not allocate AVPacket\n");
         return false;
     }
 
-    // Create the stream (AVStream). NULL because that parameter does nothing.
-    ost->st = avformat_new_stream(oc, NULL);
-    if (!ost->st) {
-        DBG("Could not allocate stream\n");
-        return false;
-    }
+    return initialiseFrames();
+}
 
-    // Not too sure just yet why this is necessary but it is present in mux.c line 151.
-    ost->st->id = oc->nb_streams - 1;
-    ost->next_pts = 0;
+// The frames that the texture is copied into, and for NVENC the CUDA registration of the texture. These depend on
+// the size of the texture, so they are rebuilt on resize.
+bool VideoEncoder::initialiseFrames() {
+    OutputStream* ost = &video_st;
+    int codecWidth = width % 2 == 0 ? width : width - 1; // Must be a multiple of 2.
+    int codecHeight = height % 2 == 0 ? height : height - 1; // Must be a multiple of 2.
 
-    // Create the codec context (AVCodecContext)
-    codecContext = avcodec_alloc_context3(*codec);
-    if (!codecContext) {
-        DBG("Could not alloc an encoding context.");
+#if AV_USE_NVENC
+    if (backend == EncoderBackend::nvenc) {
+        if (!initialiseCudaFrames())
+            return false;
+        ost->frame = allocFrame(AV_PIX_FMT_CUDA, width, height);
+        return ost->frame != nullptr;
+    }
+#endif
+
+    ost->frame = allocSoftwareFrame(STREAM_PIX_FMT_DEFAULT, codecWidth, codecHeight);
+    // The texture is read back into tmp_frame as RGBA and then converted into frame by swscale.
+    ost->tmp_frame = allocSoftwareFrame(AV_PIX_FMT_RGBA, width, height);
+    swsContext = sws_getContext(width, height, AV_PIX_FMT_RGBA, codecWidth, codecHeight, STREAM_PIX_FMT_DEFAULT, SCALE_FLAGS, nullptr, nullptr, nullptr);
+    if (!ost->frame || !ost->tmp_frame || !swsContext) {
+        DBG("Could not initialise the software conversion context.");
         return false;
     }
-    // Assign this new codec context to the output stream struct.
-    ost->enc = codecContext;
-    if ((*codec)->type == AVMEDIA_TYPE_VIDEO) {
-        // Apply video settings to the codec context.
-        codecContext->codec_id = (*codec)->id;
-        codecContext->bit_rate = 8000000; // 8 Mbps
-        codecContext->width = width % 2 == 0 ? width : width - 1; // Must be a multiple of 2.
-        codecContext->height = height % 2 == 0 ? height : height - 1; // Must be a multiple of 2.
-        
-        ost->st->time_base = av_make_q(1, STREAM_FRAME_RATE);
-        codecContext->framerate = av_make_q(STREAM_FRAME_RATE, 1);
-        codecContext->time_base = ost->st->time_base;
-
-        // One intra frame every 12 frames. Must be set by the user.
-        codecContext->gop_size = 12; /* emit one intra frame every twelve frames at most */
-        codecContext->pix_fmt = AV_PIX_FMT_CUDA;
-        // AV_PIX_FMT_RGBA is used instead of AV_PIX_FMT_YUV420P because we want the GPU to understand that the opengl data
-        // is in RGB format and therefore should be converted from RGB to nvenc's output context format which is YUV.
-        codecContext->sw_pix_fmt = AV_PIX_FMT_RGBA;
+    return true;
+}
 
-        // Inform the codecContext to seperate stream headers if the format requires it.
-        if (oc->oformat->flags & AVFMT_GLOBALHEADER)
-            codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
-    } else {
-        // Not doing audio just yet.
-        return false;
+void VideoEncoder::releaseFrames() {
+    OutputStream* ost = &video_st;
+    releaseSourceFrames();
+    av_frame_free(&ost->frame);
+    av_frame_free(&ost->tmp_frame);
+    sws_freeContext(swsContext);
+    swsContext = nullptr;
+#if AV_USE_NVENC
+    if (cudaTextureResource) {
+        cuGraphicsUnregisterResource(cudaTextureResource);
+        cudaTextureResource = nullptr;
     }
+#endif
+    av_buffer_unref(&avBufferFrame);
+}
 
-    // Cuda related setup.
-    juce::String gpuName;
-    getDeviceName(gpuName);
-    ret = av_hwdevice_ctx_create(&avBufferDevice, AV_HWDEVICE_TYPE_CUDA, NULL, NULL, 0);
-    if (ret < 0) {
-        DBG("Could not create a AV_HWDEVICE_TYPE_CUDA instance.");
+bool VideoEncoder::resize(int newWidth, int newHeight) {
+    if (active) {
+        DBG("Cannot resize the video encoder while recording!");
         return false;
     }
+    if (newWidth == width && newHeight == height)
+        return true;
+    DBG("Resizing video encoder to Width " << newWidth << " Height " << newHeight << ".");
+
+    // The codec context and the frame pool have the size baked in. The CUDA device does not.
+    releaseVideo();
+    releaseFrames();
+    width = newWidth;
+    height = newHeight;
+
+    // Reallocating the storage keeps the texture ID, so FBO attachments don't need to be touched.
+    juce::gl::glBindTexture(juce::gl::GL_TEXTURE_2D, texture_id);
+    juce::gl::glTexImage2D(juce::gl::GL_TEXTURE_2D, 0, juce::gl::GL_RGBA, width, height, 0, juce::gl::GL_RGBA, juce::gl::GL_UNSIGNED_BYTE, 0);
+    juce::gl::glBindTexture(juce::gl::GL_TEXTURE_2D, 0);
+
+    coreReady = video_codec != nullptr && initialiseFrames();
+    return coreReady;
+}
+
+#if AV_USE_NVENC
+bool VideoEncoder::initialiseCudaDevice(AVBufferRef* sharedDevice) {
+    int ret;
+
+    // Cuda related setup. A second encoder takes a reference to the first one's device instead of creating another.
+    if (sharedDevice) {
+        avBufferDevice = av_buffer_ref(sharedDevice);
+        if (!avBufferDevice)
+            return false;
+    } else {
+        ret = av_hwdevice_ctx_create(&avBufferDevice, AV_HWDEVICE_TYPE_CUDA, NULL, NULL, 0);
+        if (ret < 0) {
+            DBG("Could not create a AV_HWDEVICE_TYPE_CUDA instance.");
+            return false;
+        }
+    }
 
     // Cast down to access cuda context.
     AVHWDeviceContext* hwDevContext = (AVHWDeviceContext*)(avBufferDevice->data);
     AVCUDADeviceContext* cudaDevCtx = (AVCUDADeviceContext*)(hwDevContext->hwctx);
     cudaContext = &(cudaDevCtx->cuda_ctx);
 
+    // Setup some cuda stuff for memcpy-ing later
+    memcopyStruct.srcXInBytes = 0;
+    memcopyStruct.srcY = 0;
+    memcopyStruct.srcMemoryType = CUmemorytype::CU_MEMORYTYPE_ARRAY;
+
+    memcopyStruct.dstXInBytes = 0;
+    memcopyStruct.dstY = 0;
+    memcopyStruct.dstMemoryType = CUmemorytype::CU_MEMORYTYPE_DEVICE;
+
+    return true;
+}
+
+bool VideoEncoder::initialiseCudaFrames() {
+    int ret;
+
     // Create the hwframe_context.
     // This is an abstraction of a cuda buffer for us. This enables us to, with one call, setup the cuda buffer and ready it for input.
     avBufferFrame = av_hwframe_ctx_alloc(avBufferDevice);
@@ -116,14 +194,10 @@ bool VideoEncoder::initialiseVideo(OutputStream* ost, AVFormatContext* oc, const
     // is in RGB format and therefore should be converted from RGB to nvenc's output context format which is YUV.
     frameCtxPtr->sw_format = AV_PIX_FMT_RGBA;
     frameCtxPtr->format = AV_PIX_FMT_CUDA;
-    //frameCtxPtr->device_ref = avBufferDevice;
-    //frameCtxPtr->device_ctx = (AVHWDeviceContext*)avBufferDevice->data;
-
 
     // Init the frame so that we can allocate a cuda buffer.
     ret = av_hwframe_ctx_init(avBufferFrame);
     if (ret < 0) {
-        av_buffer_unref(&avBufferDevice);
         av_buffer_unref(&avBufferFrame);
         DBG("Could not init a av_hwframe_ctx_init frame.");
         return false;
@@ -136,27 +210,34 @@ bool VideoEncoder::initialiseVideo(OutputStream* ost, AVFormatContext* oc, const
     res = cuCtxPushCurrent(*cudaContext);
     res = cuGraphicsGLRegisterImage(&cudaTextureResource, texture_id, juce::gl::GL_TEXTURE_2D, CU_GRAPHICS_REGISTER_FLAGS_READ_ONLY);
     if (res != CUDA_SUCCESS) {
-        av_buffer_unref(&avBufferDevice);
+        cudaTextureResource = nullptr;
         av_buffer_unref(&avBufferFrame);
-        cuCtxDestroy(*cudaContext);
+        cuCtxPopCurrent(&oldCtx);
         DBG("Could not register a cuGraphicsGLRegisterImage gl image.");
+        return false;
     }
     res = cuCtxPopCurrent(&oldCtx);
 
-    // Assign some hardware accel specific data to AvCodecContext.
-    codecContext->hw_device_ctx = av_buffer_ref(avBufferDevice);
-    codecContext->hw_frames_ctx = av_buffer_ref(avBufferFrame);
+    return true;
+}
+#endif
 
-    // Setup some cuda stuff for memcpy-ing later
-    memcopyStruct.srcXInBytes = 0;
-    memcopyStruct.srcY = 0;
-    memcopyStruct.srcMemoryType = CUmemorytype::CU_MEMORYTYPE_ARRAY;
+// Allocates a frame in system memory for the software backend - mux.c alloc_frame.
+AVFrame* VideoEncoder::allocSoftwareFrame(enum AVPixelFormat pix_fmt, int width, int height) {
+    AVFrame* frame = av_frame_alloc();
+    if (!frame)
+        return nullptr;
 
-    memcopyStruct.dstXInBytes = 0;
-    memcopyStruct.dstY = 0;
-    memcopyStruct.dstMemoryType = CUmemorytype::CU_MEMORYTYPE_DEVICE;
+    frame->format = pix_fmt;
+    frame->width = width;
+    frame->height = height;
 
-    return true;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        DBG("Could not allocate software frame data.");
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    return frame;
 }
 
 AVFrame* VideoEncoder::allocFrame(enum AVPixelFormat pix_fmt, int width, int height) {
@@ -185,137 +266,333 @@ AVFrame* VideoEncoder::allocFrame(enum AVPixelFormat pix_fmt, int width, int hei
     return frame;
 }
 
-void VideoEncoder::openVideo(AVFormatContext* oc, const AVCodec* codec, OutputStream* ost, AVDictionary* opt_arg) {
-    int ret;
-    AVCodecContext* c = ost->enc;
+// Creates and opens the codec context with the current profile. The frames the texture is copied into already exist.
+bool VideoEncoder::openVideo(bool globalHeader) {
+    OutputStream* ost = &video_st;
+    AVCodecContext* codecContext;
     AVDictionary* opt = NULL;
+    int ret;
 
-    // Copy the dictionary settings over to the codec context.
-    av_dict_copy(&opt, opt_arg, 0);
+    // Create the codec context (AVCodecContext)
+    codecContext = avcodec_alloc_context3(video_codec);
+    if (!codecContext) {
+        DBG("Could not alloc an encoding context.");
+        return false;
+    }
+    // Assign this new codec context to the output stream struct.
+    ost->enc = codecContext;
+
+    // Apply video settings to the codec context.
+    codecContext->codec_id = video_codec->id;
+    codecContext->bit_rate = (int64_t) profile.bitRateKbps * 1000;
+    codecContext->width = width % 2 == 0 ? width : width - 1; // Must be a multiple of 2.
+    codecContext->height = height % 2 == 0 ? height : height - 1; // Must be a multiple of 2.
+    codecContext->framerate = av_make_q(frameRate, 1);
+    codecContext->time_base = av_make_q(1, frameRate);
+
+    // One intra frame every keyframeSeconds. Must be set by the user.
+    codecContext->gop_size = profile.getGopSize(frameRate);
+    if (profile.isLowLatency())
+        codecContext->max_b_frames = 0; // B-frames hold frames back until the next reference frame is encoded.
 
-    // Add NVENC-specific options
-    av_dict_set(&opt, "preset", "slow", 0);  // or "slow", "medium", "fast"
-    av_dict_set(&opt, "tune", "hq", 0);
-    av_dict_set(&opt, "rc", "vbr", 0);
+    if (backend == EncoderBackend::nvenc) {
+        codecContext->pix_fmt = AV_PIX_FMT_CUDA;
+        // AV_PIX_FMT_RGBA is used instead of AV_PIX_FMT_YUV420P because we want the GPU to understand that the opengl data
+        // is in RGB format and therefore should be converted from RGB to nvenc's output context format which is YUV.
+        codecContext->sw_pix_fmt = AV_PIX_FMT_RGBA;
+        // Assign some hardware accel specific data to AvCodecContext.
+        codecContext->hw_device_ctx = av_buffer_ref(avBufferDevice);
+        codecContext->hw_frames_ctx = av_buffer_ref(avBufferFrame);
+
+        // Add NVENC-specific options
+        av_dict_set(&opt, "preset", profile.getNvencPreset(), 0);
+        av_dict_set(&opt, "tune", profile.tune.toRawUTF8(), 0);
+        av_dict_set(&opt, "rc", profile.rateControl.toRawUTF8(), 0);
+        av_dict_set(&opt, "forced-idr", "1", 0); // Frames forced to I for a stream must be IDR frames to be a recovery point.
+    } else {
+        // The software path converts from RGBA to YUV itself with swscale before the frame reaches the encoder.
+        codecContext->pix_fmt = STREAM_PIX_FMT_DEFAULT;
+        codecContext->thread_count = threadCount;
+
+        av_dict_set(&opt, "preset", profile.getSoftwarePreset(), 0);
+        if (profile.isLowLatency())
+            av_dict_set(&opt, "tune", "zerolatency", 0);
+        if (profile.rateControl == "cbr") {
+            // x264 has no rc option. Capping the rate at the bitrate with a one second buffer gives constant bitrate.
+            codecContext->rc_max_rate = codecContext->bit_rate;
+            codecContext->rc_buffer_size = (int) codecContext->bit_rate;
+            av_dict_set(&opt, "nal-hrd", "cbr", 0);
+        }
+    }
+
+    // Inform the codecContext to seperate stream headers if the format requires it.
+    if (globalHeader)
+        codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 
     // Open the codec.
-    ret = avcodec_open2(c, codec, &opt);
+    ret = avcodec_open2(codecContext, video_codec, &opt);
+    // The dictionary settings were used to open the codec, and are no longer needed.
+    av_dict_free(&opt);
     if (ret < 0) {
+        DBG("Could not open the video codec.");
         printFfmpegErr(ret);
-        av_dict_free(&opt);
-        return;
+        stats.addError(ret);
+        avcodec_free_context(&ost->enc);
+        return false;
     }
 
-    // The dictionary settings were used to open the codec, and are no longer needed.
-    av_dict_free(&opt);
+    videoGlobalHeader = globalHeader;
+    DBG("Opened the " << video_codec->name << " codec context.");
+    return true;
+}
 
-    /* allocate and init a reusable frame */
-    ost->frame = allocFrame(c->pix_fmt, c->width, c->height);
-    if (!ost->frame) {
-        DBG("Could not allocate video frame\n");
-        return;
+void VideoEncoder::releaseVideo() {
+    avcodec_free_context(&video_st.enc);
+}
+
+// Create the stream (AVStream) for this session's muxer, using the open codec context.
+bool VideoEncoder::addVideoStream(OutputStream* ost, AVFormatContext* oc) {
+    int ret;
+
+    // NULL because that parameter does nothing.
+    ost->st = avformat_new_stream(oc, NULL);
+    if (!ost->st) {
+        DBG("Could not allocate stream\n");
+        return false;
     }
 
-    ost->tmp_frame = nullptr;
+    // Not too sure just yet why this is necessary but it is present in mux.c line 151.
+    ost->st->id = oc->nb_streams - 1;
+    ost->st->time_base = ost->enc->time_base;
+    ost->next_pts = 0;
 
     // Inform the muxer of the stream. All muxing function calls such as av_write_header
     // will be aware of the stream and codec parameters. 
-    ret = avcodec_parameters_from_context(ost->st->codecpar, c);
+    ret = avcodec_parameters_from_context(ost->st->codecpar, ost->enc);
     if (ret < 0) {
         DBG("Could not copy the stream parameters\n");
-        return;
+        return false;
     }
+    return true;
 }
 
-bool VideoEncoder::startRecordingSession(const juce::String& file_name) {
+bool VideoEncoder::startRecordingSession(const juce::String& file_name, juce::int64 audioSamplePosition, double sampleRate, const RecordingOptions& options) {
     if (active)
         return false;
     if (!file_name.toRawUTF8())
         return false;
+    if (!coreReady) {
+        DBG("The video encoder failed to initialise. Cannot start a recording!");
+        return false;
+    }
     DBG("Starting Recording Session!");
-    int ret{}, i;
-    AVDictionary* opt = NULL;
+    stats.reset();
+    int ret{};
+    AVDictionary* muxerOpt = NULL; // Muxer options, passed to avformat_write_header.
     
     // Set options here. AVDictionary is a key value data structure for ffmpeg. 
     // It is used for options in this instance.
     // 
-    // av_dict_set(&opt, argv[i] + 1, argv[i + 1], 0);
+    // av_dict_set(&muxerOpt, argv[i] + 1, argv[i + 1], 0);
+
+    // The profile was validated by the settings, but never open a codec with values that weren't.
+    EncoderProfile sessionProfile = options.profile;
+    if (!sessionProfile.isValid()) {
+        DBG("The encoder profile is invalid. Using the default profile.");
+        sessionProfile = EncoderProfile();
+    }
+
+    // Network targets are muxed and sent on the stream output's thread, so there is no local muxer to open.
+    if (StreamOutput::getFormatName(file_name))
+        return startStreamingSession(file_name, audioSamplePosition, sampleRate, sessionProfile, options.encodeOnThread);
+    streaming = false;
+
+    // Fragments are an MP4 feature. Any other container is written as it always was.
+    containerMode = options.container;
+    const AVOutputFormat* containerFormat = av_guess_format(NULL, file_name.toRawUTF8(), NULL);
+    if (containerMode != ContainerMode::mp4 && !(containerFormat && juce::String(containerFormat->name).contains("mp4"))) {
+        DBG("Fragmented and segmented recordings must be written to an .mp4 file. Writing a plain file instead.");
+        containerMode = ContainerMode::mp4;
+    }
+
+    // Segments are numbered in the order they are written, next to where the single file would have gone.
+    juce::String outputName = file_name;
+    const char* formatName = NULL;
+    if (containerMode == ContainerMode::segmented) {
+        juce::File outputFile(file_name);
+        outputName = outputFile.getSiblingFile(outputFile.getFileNameWithoutExtension() + "_%05d" + outputFile.getFileExtension()).getFullPathName();
+        formatName = "segment";
+    }
 
     // Allocate the output media context (AVFormatContext and AVOutputFormat).
-    avformat_alloc_output_context2(&oc, NULL, NULL, file_name.toRawUTF8());
+    avformat_alloc_output_context2(&oc, NULL, formatName, outputName.toRawUTF8());
     if (!oc) {
         printf("Could not deduce output format from file extension: using MPEG.\n");
-        avformat_alloc_output_context2(&oc, NULL, "mpeg", file_name.toRawUTF8());
+        avformat_alloc_output_context2(&oc, NULL, "mpeg", outputName.toRawUTF8());
+    }
+    if (!oc) {
+        stats.addError(AVERROR(ENOMEM));
+        return false;
     }
-    if (!oc)
-        return 1;
 
     fmt = oc->oformat;
 
-    // Init stream and codec.
-    if (fmt->video_codec != AV_CODEC_ID_NONE) {
-        // do add video stream here
-        initialiseVideo(&video_st, oc, &video_codec);
-        have_video = 1;
-        encode_video = 1;
+    if (!prepareVideo(sessionProfile, (fmt->flags & AVFMT_GLOBALHEADER) != 0)) {
+        freeOutput();
+        return false;
     }
 
-    if (have_video)
-        openVideo(oc, video_codec, &video_st, opt);
-    // Confirm the video context actually opened.
-    ret = avcodec_is_open(video_st.enc);
-    if (!video_st.enc || !ret) {
-        DBG("Failed to open video openVideo(oc, video_codec, &video_st, opt);.");
-        printFfmpegErr(ret);
-        cleanup();
+    if (!addVideoStream(&video_st, oc)) {
+        freeOutput();
         return false;
     }
 
     // Analyse the file for debug printing.
-    av_dump_format(oc, 0, file_name.toRawUTF8(), 1);
+    av_dump_format(oc, 0, outputName.toRawUTF8(), 1);
+
+    if (containerMode == ContainerMode::fragmentedMp4) {
+        av_dict_set(&muxerOpt, "movflags", FRAGMENT_MOVFLAGS, 0);
+        av_dict_set(&muxerOpt, "min_frag_duration", FRAGMENT_MIN_DURATION_US, 0);
+    } else if (containerMode == ContainerMode::segmented) {
+        av_dict_set(&muxerOpt, "segment_time", juce::String(juce::jmax(1, options.segmentSeconds)).toRawUTF8(), 0);
+        av_dict_set(&muxerOpt, "reset_timestamps", "1", 0); // Every segment starts at 0 so it plays on its own.
+        av_dict_set(&muxerOpt, "segment_format_options", "movflags=" FRAGMENT_MOVFLAGS ":min_frag_duration=" FRAGMENT_MIN_DURATION_US, 0);
+    }
+
+    // Fragmented output never seeks back, so it is handed to the sink thread instead of being written here.
+    if (containerMode != ContainerMode::mp4) {
+        if (!fileSink)
+            fileSink = std::make_unique<AsyncFileSink>();
+        fileSink->attach(oc); // The segment muxer opens each segment through this.
+    }
 
     // Open the output file if it hasn't already been opened. Perhaps not needed for future code cleanup
     // since it will be closed onRecordingEnd. Assertion should be made there.
     if (!(fmt->flags & AVFMT_NOFILE)) {
-        ret = avio_open(&oc->pb, file_name.toRawUTF8(), AVIO_FLAG_WRITE);
+        if (containerMode == ContainerMode::fragmentedMp4)
+            ret = fileSink->open(&oc->pb, outputName);
+        else
+            ret = avio_open(&oc->pb, outputName.toRawUTF8(), AVIO_FLAG_WRITE);
         if (ret < 0) {
             DBG("Could not open the output file.\n");
+            stats.addError(ret);
+            av_dict_free(&muxerOpt);
+            freeOutput();
             return false;
         }
     }
 
     // Write the stream header.
-    ret = avformat_write_header(oc, &opt);
+    ret = avformat_write_header(oc, &muxerOpt);
+    av_dict_free(&muxerOpt);
     if (ret < 0) {
         DBG("Could not write a header to the output file.\n");
+        printFfmpegErr(ret);
+        stats.addError(ret);
+        closeOutput();
         return false;
     }
 
-    // Setup framerate control handling variables
-    delta = 0;
-    now = 0;
-    lastTime = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-    timer = 0;
+    beginSession(audioSamplePosition, sampleRate, options.encodeOnThread);
+    return true;
+}
 
-    active = true;
+bool VideoEncoder::startStreamingSession(const juce::String& url, juce::int64 audioSamplePosition, double sampleRate, const EncoderProfile& sessionProfile, bool threaded) {
+    const char* streamFormat = StreamOutput::getFormatName(url);
+    const AVOutputFormat* streamOutputFormat = av_guess_format(streamFormat, NULL, NULL);
+    if (!streamOutputFormat) {
+        DBG("This build of ffmpeg can't write " << streamFormat << ". Cannot stream to " << url << "!");
+        stats.addError(AVERROR_MUXER_NOT_FOUND);
+        return false;
+    }
+    if (!prepareVideo(sessionProfile, (streamOutputFormat->flags & AVFMT_GLOBALHEADER) != 0))
+        return false;
+
+    // The stream output connects in the background. Encoding starts straight away and packets are dropped
+    // until the connection is up.
+    if (!streamOutput)
+        streamOutput = std::make_unique<StreamOutput>();
+    if (!streamOutput->start(url, video_st.enc)) {
+        stats.addError(AVERROR(EINVAL));
+        return false;
+    }
+    streaming = true;
+    video_st.next_pts = 0;
+
+    beginSession(audioSamplePosition, sampleRate, threaded);
     return true;
 }
 
-void VideoEncoder::addVideoFrame() {
+void VideoEncoder::beginSession(juce::int64 audioSamplePosition, double sampleRate, bool threaded) {
+    // The first frame of the video lines up with the audio sample position at the time the recording started.
+    frameClock.reset(audioSamplePosition, sampleRate, frameRate);
+    recordedFrames.store(0);
+
+    active = true;
+    encodeOnThread = threaded;
+    if (encodeOnThread)
+        startThread();
+}
+
+// The codec context from the last session is reused when it was opened with the same settings and the encoder
+// can be reset with avcodec_flush_buffers. Otherwise it is reopened on the existing device and frame pool.
+bool VideoEncoder::prepareVideo(const EncoderProfile& sessionProfile, bool globalHeader) {
+    if (video_st.enc && !(sessionProfile == profile && globalHeader == videoGlobalHeader))
+        releaseVideo();
+    profile = sessionProfile;
+    return video_st.enc || openVideo(globalHeader);
+}
+
+void VideoEncoder::addVideoFrame(juce::int64 audioSamplePosition) {
     if (!active) return;
-    now = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-    delta += (now - lastTime) / timePerTick;
-    timer += now - lastTime;
-    lastTime = now;
-    if (delta < 1)
+    // Drop the frame if the audio has not moved into the next frame yet, or duplicate it if the GL thread fell behind.
+    AudioFrameClock::FrameDecision decision = frameClock.getFramesDue(audioSamplePosition);
+    if (decision.count == 0)
         return;
-    delta--;
+    if (decision.skipped > 0) {
+        DBG("Video encoder fell " << decision.skipped << " frames behind the audio clock. Skipping ahead.");
+        stats.framesDropped += decision.skipped;
+    }
+    if (decision.count > 1)
+        stats.framesDuplicated += decision.count - 1;
 
     OutputStream* ost = &video_st;
 
+    // After the stream output drops packets or reconnects, the receiver can only pick up again from a keyframe.
+    bool forceKeyframe = streaming && streamOutput->takeKeyframeRequest();
+
+    if (encodeOnThread) {
+        queueVideoFrame(decision, forceKeyframe);
+        recordedFrames.store(frameClock.getFramesElapsed());
+        return;
+    }
+
     if (av_frame_make_writable(ost->frame) < 0)
         return;
 
+#if AV_USE_NVENC
+    if (backend == EncoderBackend::nvenc)
+        copyTextureToFrame(ost->frame);
+    else
+#endif
+    {
+        readTextureToFrame(ost->tmp_frame);
+        convertToCodecFrame(ost->tmp_frame);
+    }
+
+    // The same GPU frame is sent once per frame that is due. The encoder takes its own reference to the
+    // frame on each send, so only the timestamp changes between duplicates.
+    ost->next_pts = decision.pts;
+    for (int i = 0; i < decision.count; i++) {
+        ost->frame->pts = ost->next_pts++;
+        ost->frame->pict_type = forceKeyframe && i == 0 ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+        encode(oc, ost->enc, ost->st, ost->frame, ost->tmp_pkt);
+    }
+    recordedFrames.store(frameClock.getFramesElapsed());
+}
+
+#if AV_USE_NVENC
+void VideoEncoder::copyTextureToFrame(AVFrame* frame) {
     //Perform cuda mem copy for input buffer
     CUresult cuRes;
     CUarray mappedArray;
@@ -337,20 +614,142 @@ void VideoEncoder::addVideoFrame() {
 
     //Setup for memcopy
     memcopyStruct.srcArray = mappedArray;
-    memcopyStruct.dstDevice = (CUdeviceptr)ost->frame->data[0]; // Make sure to copy devptr as it could change, upon resize
-    memcopyStruct.dstPitch = ost->frame->linesize[0];   // Linesize is generated by hwframe_context
-    memcopyStruct.WidthInBytes = ost->frame->width * 4; //* 4 needed for each pixel
-    memcopyStruct.Height = ost->frame->height;          //Vanilla height for frame
+    memcopyStruct.dstDevice = (CUdeviceptr)frame->data[0]; // Make sure to copy devptr as it could change, upon resize
+    memcopyStruct.dstPitch = frame->linesize[0];   // Linesize is generated by hwframe_context
+    memcopyStruct.WidthInBytes = frame->width * 4; //* 4 needed for each pixel
+    memcopyStruct.Height = frame->height;          //Vanilla height for frame
 
     //Do memcpy
     cuRes = cuMemcpy2D(&memcopyStruct);
 
     //release context
     cuRes = cuCtxPopCurrent(&oldCtx);
+}
+#endif
+
+// Software backend equivalent of copyTextureToFrame. The texture is read back into system memory as RGBA.
+void VideoEncoder::readTextureToFrame(AVFrame* rgbFrame) {
+    juce::gl::glBindTexture(juce::gl::GL_TEXTURE_2D, texture_id);
+    juce::gl::glPixelStorei(juce::gl::GL_PACK_ALIGNMENT, 1);
+    juce::gl::glPixelStorei(juce::gl::GL_PACK_ROW_LENGTH, rgbFrame->linesize[0] / 4); // Linesize may be padded by ffmpeg.
+    juce::gl::glGetTexImage(juce::gl::GL_TEXTURE_2D, 0, juce::gl::GL_RGBA, juce::gl::GL_UNSIGNED_BYTE, rgbFrame->data[0]);
+    juce::gl::glPixelStorei(juce::gl::GL_PACK_ROW_LENGTH, 0);
+    juce::gl::glBindTexture(juce::gl::GL_TEXTURE_2D, 0);
+}
+
+// Converts a frame read back by readTextureToFrame into the encoder's pixel format on the CPU.
+void VideoEncoder::convertToCodecFrame(AVFrame* rgbFrame) {
+    OutputStream* ost = &video_st;
+    sws_scale(swsContext, rgbFrame->data, rgbFrame->linesize, 0, height, ost->frame->data, ost->frame->linesize);
+}
+
+// Called on the GL thread. Only the texture copy has to happen here, everything else is left to the encode thread.
+void VideoEncoder::queueVideoFrame(const AudioFrameClock::FrameDecision& decision, bool forceKeyframe) {
+    AVFrame* source = takeSourceFrame();
+    if (!source) {
+        DBG("Video encoder is " << ENCODE_QUEUE_FRAMES << " frames behind. Dropping a frame.");
+        stats.framesDropped += decision.count;
+        return;
+    }
+
+#if AV_USE_NVENC
+    if (backend == EncoderBackend::nvenc)
+        copyTextureToFrame(source);
+    else
+#endif
+        readTextureToFrame(source);
+
+    {
+        const juce::ScopedLock lock(encodeQueueLock);
+        encodeQueue.push_back({ source, decision.pts, decision.count, forceKeyframe });
+        stats.queueDepth.store((int) encodeQueue.size());
+    }
+    notify();
+}
+
+void VideoEncoder::run() {
+    while (!threadShouldExit()) {
+        if (!encodeNextJob())
+            wait(100); // Woken up by queueVideoFrame.
+    }
+    // Everything that was queued before the session was stopped still goes into the recording.
+    while (encodeNextJob()) {}
+}
 
-    ost->frame->pts = ost->next_pts++;
+bool VideoEncoder::encodeNextJob() {
+    EncodeJob job;
+    {
+        const juce::ScopedLock lock(encodeQueueLock);
+        if (encodeQueue.empty())
+            return false;
+        job = encodeQueue.front();
+        encodeQueue.pop_front();
+        stats.queueDepth.store((int) encodeQueue.size());
+    }
+
+    OutputStream* ost = &video_st;
+    AVFrame* frame = job.frame;
+    if (backend == EncoderBackend::software) {
+        if (av_frame_make_writable(ost->frame) < 0) {
+            stats.framesDropped += job.count;
+            recycleSourceFrame(job.frame);
+            return true;
+        }
+        convertToCodecFrame(job.frame);
+        frame = ost->frame;
+    }
 
-    encode(oc, ost->enc, ost->st, ost->frame, ost->tmp_pkt);
+    for (int i = 0; i < job.count; i++) {
+        frame->pts = job.pts + i;
+        frame->pict_type = job.forceKeyframe && i == 0 ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+        encode(oc, ost->enc, ost->st, frame, ost->tmp_pkt);
+    }
+    recycleSourceFrame(job.frame);
+    return true;
+}
+
+// A frame for the GL thread to copy the texture into, or nullptr if ENCODE_QUEUE_FRAMES are already waiting.
+AVFrame* VideoEncoder::takeSourceFrame() {
+    const juce::ScopedLock lock(encodeQueueLock);
+    if (encodeQueue.size() >= ENCODE_QUEUE_FRAMES)
+        return nullptr;
+
+#if AV_USE_NVENC
+    // The hwframes context is a pool, so this reuses a CUDA buffer that the encoder has let go of.
+    if (backend == EncoderBackend::nvenc)
+        return allocFrame(AV_PIX_FMT_CUDA, width, height);
+#endif
+
+    if (!spareSourceFrames.empty()) {
+        AVFrame* frame = spareSourceFrames.back();
+        spareSourceFrames.pop_back();
+        return frame;
+    }
+    // One more than the queue holds, since the encode thread is working on one frame while the queue is full.
+    if (sourceFramesAllocated > ENCODE_QUEUE_FRAMES)
+        return nullptr;
+    AVFrame* frame = allocSoftwareFrame(AV_PIX_FMT_RGBA, width, height);
+    if (frame)
+        sourceFramesAllocated++;
+    return frame;
+}
+
+void VideoEncoder::recycleSourceFrame(AVFrame* frame) {
+    // The encoder holds its own reference to a CUDA frame until it is done with it.
+    if (backend == EncoderBackend::nvenc) {
+        av_frame_free(&frame);
+        return;
+    }
+    const juce::ScopedLock lock(encodeQueueLock);
+    spareSourceFrames.push_back(frame);
+}
+
+void VideoEncoder::releaseSourceFrames() {
+    const juce::ScopedLock lock(encodeQueueLock);
+    for (AVFrame* frame : spareSourceFrames)
+        av_frame_free(&frame);
+    spareSourceFrames.clear();
+    sourceFramesAllocated = 0;
 }
 
 int VideoEncoder::encode(AVFormatContext* fmt_ctx, AVCodecContext* c, AVStream* st, AVFrame* frame, AVPacket* pkt) {
@@ -358,10 +757,14 @@ int VideoEncoder::encode(AVFormatContext* fmt_ctx, AVCodecContext* c, AVStream*
         return 1;
 
     int ret;
+    juce::int64 startTicks = juce::Time::getHighResolutionTicks();
 
     // Send the frame to the encoder.
     ret = avcodec_send_frame(c, frame);
     if (ret < 0) {
+        DBG("Error sending a frame to the encoder.");
+        printFfmpegErr(ret);
+        stats.addError(ret);
         return 1;
     }
 
@@ -370,9 +773,20 @@ int VideoEncoder::encode(AVFormatContext* fmt_ctx, AVCodecContext* c, AVStream*
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
             break;
         else if (ret < 0) {
-            ("Error encoding a frame");
+            DBG("Error encoding a frame.");
+            printFfmpegErr(ret);
+            stats.addError(ret);
             return 1;
         }
+        stats.addPacket(pkt->size);
+
+        // Streams are muxed on the stream output's thread, which takes its own reference and rescales the timestamps.
+        if (streaming) {
+            streamOutput->push(pkt);
+            av_packet_unref(pkt);
+            stats.streamPacketsDropped.store(streamOutput->getDroppedPackets());
+            continue;
+        }
 
         /* rescale output packet timestamp values from codec to stream timebase */
         av_packet_rescale_ts(pkt, c->time_base, st->time_base);
@@ -386,10 +800,16 @@ int VideoEncoder::encode(AVFormatContext* fmt_ctx, AVCodecContext* c, AVStream*
          * This would be different if one used av_write_frame(). */
         if (ret < 0) {
             DBG("Error while writing output packet");
+            printFfmpegErr(ret);
+            stats.addError(ret);
             return 1;
         }
     }
 
+    // Time spent encoding and writing this frame. Frames the encoder holds back for lookahead are written by later calls.
+    if (frame)
+        stats.addEncodedFrame((juce::int64) (juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000000.0));
+
     return ret == AVERROR_EOF ? 1 : 0;
 
 }
@@ -409,30 +829,58 @@ void VideoEncoder::cleanup() {
     if (!active)
         return;
 
+    // The encode thread drains its queue before it exits, so every queued frame is encoded before the flush.
+    if (encodeOnThread) {
+        signalThreadShouldExit();
+        notify();
+        stopThread(-1);
+        encodeOnThread = false;
+    }
+
     // Flush the encoder by parsing a nullptr.
     encode(oc, video_st.enc, video_st.st, nullptr, video_st.tmp_pkt);
 
-    av_write_trailer(oc);
+    if (streaming) {
+        streamOutput->stop();
+        streaming = false;
+    } else {
+        int ret = av_write_trailer(oc);
+        if (ret < 0)
+            stats.addError(ret);
+        closeOutput();
+    }
 
-    // Free memory
-    if (have_video) {
-        OutputStream* ost = &video_st;
-        avcodec_free_context(&ost->enc);
-        av_frame_free(&ost->frame);
-        av_frame_free(&ost->tmp_frame);
-        av_packet_free(&ost->tmp_pkt);
+    // Get the codec ready for the next session. Encoders that can't be reset after being drained are reopened then.
+    if (video_codec->capabilities & AV_CODEC_CAP_ENCODER_FLUSH)
+        avcodec_flush_buffers(video_st.enc);
+    else
+        releaseVideo();
+}
 
-        av_buffer_unref(&avBufferDevice);
-        av_buffer_unref(&avBufferFrame);
-        cuGraphicsUnregisterResource(cudaTextureResource);
+// Closes the file and frees the muxer. The codec context and everything in the core is left alone.
+void VideoEncoder::closeOutput() {
+    if (oc == nullptr)
+        return;
+    // Close the file if it's still open. Segments have already been closed by the segment muxer's trailer.
+    if (!(fmt->flags & AVFMT_NOFILE)) {
+        // A failed disk write only shows up here, since the sink writes on its own thread.
+        if (containerMode == ContainerMode::fragmentedMp4) {
+            int ret = fileSink->close(&oc->pb);
+            if (ret < 0)
+                stats.addError(ret);
+        } else {
+            avio_closep(&oc->pb);
+        }
     }
 
-    // Close the file if it's still open.
-    if (!(fmt->flags & AVFMT_NOFILE))
-        avio_closep(&oc->pb);
+    freeOutput();
+}
 
-    // Free the stream attached to the output context.
+// Frees the muxer and the stream attached to it. oc is left null, so nothing can free it twice.
+void VideoEncoder::freeOutput() {
     avformat_free_context(oc);
+    oc = nullptr;
+    video_st.st = nullptr;
 }
 
 void VideoEncoder::printFfmpegErr(int ret) {
@@ -12,33 +12,83 @@
 
 #include <JuceHeader.h>
 
+#include <deque>
+#include <vector>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <chrono>
+
+#include "AudioFrameClock.h"
+#include "AsyncFileSink.h"
+#include "EncoderProfile.h"
+#include "EncoderStats.h"
+#include "StreamOutput.h"
+
+// NVENC needs the CUDA toolkit. Builds without it, such as the headless renderer on CPU only servers,
+// define AV_USE_NVENC=0 and always use the software backend.
+#ifndef AV_USE_NVENC
+ #define AV_USE_NVENC 1
+#endif
 
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavutil/opt.h>
+#if AV_USE_NVENC
 #include <libavutil/hwcontext_cuda.h>
+#endif
 #include <libavformat/avformat.h>
 #include <libswscale/swscale.h>
 }
 
+#if AV_USE_NVENC
 #include <cuda.h>
 #include <cudaGL.h>
+#endif
 
 #define STREAM_PIX_FMT_DEFAULT AV_PIX_FMT_YUV420P
 #define STREAM_FRAME_RATE 60
 
-#define MAX_RECORDING_LENGTH 1200000
+#define DEFAULT_SEGMENT_SECONDS 10
+#define FRAGMENT_MOVFLAGS "frag_keyframe+empty_moov+default_base_moof"
+#define FRAGMENT_MIN_DURATION_US "1000000" // At most a second of video is lost if the application dies mid-recording.
 
 #define SCALE_FLAGS SWS_BICUBIC
 
-class VideoEncoder {
+#define ENCODE_QUEUE_FRAMES 4 // Frames that can wait for the encode thread before the GL thread starts dropping them.
+
+class VideoEncoder : private juce::Thread {
 
 public:
 
+    // Where frames are encoded. NVENC copies the render target straight from the GL texture through CUDA.
+    // The software backend reads the texture back through OpenGL and encodes on the CPU, which allows exports on
+    // machines without an NVIDIA GPU, such as servers running a software GL driver.
+    enum class EncoderBackend {
+        nvenc,
+        software
+    };
+
+    // How the recording is laid out on disk. A plain MP4 only becomes playable once the moov atom is written when
+    // the recording finishes. Fragmented MP4 writes the moov up front followed by self contained fragments, so
+    // everything up to the last fragment survives a crash. Segmented mode writes a new fragmented MP4 every
+    // segmentSeconds. The values match the recording mode ids in the settings.
+    enum class ContainerMode {
+        mp4 = 0,
+        fragmentedMp4 = 1,
+        segmented = 2
+    };
+
+    // Options that apply to a single recording session.
+    struct RecordingOptions {
+        ContainerMode container = ContainerMode::mp4;
+        int segmentSeconds = DEFAULT_SEGMENT_SECONDS;
+        EncoderProfile profile;
+        // Encode on the encoder's own thread. The GL thread only copies the texture, and drops the frame if
+        // ENCODE_QUEUE_FRAMES are already waiting. Live recordings use this so two outputs can encode in parallel.
+        // Offline renders encode inline so that no frame is ever dropped.
+        bool encodeOnThread = false;
+    };
+
     // a wrapper around a single output AVStream - mux.c 2003
     typedef struct OutputStream {
         AVStream* st;
@@ -56,18 +106,28 @@ public:
         float t, tincr, tincr2;
     } OutputStream;
 
-    VideoEncoder(int width, int height);
+    // sharedDevice is the CUDA device of another encoder, from getDeviceContext(). Encoders on the same device share
+    // its context instead of each creating one.
+    VideoEncoder(int width, int height, int frameRate = STREAM_FRAME_RATE, AVBufferRef* sharedDevice = nullptr);
+    ~VideoEncoder() override;
     
     int encode(AVFormatContext* fmt_ctx, AVCodecContext* c, AVStream* st, AVFrame* frame, AVPacket* pkt);
     
-    void addVideoFrame();
+    void addVideoFrame(juce::int64 audioSamplePosition);
 
-    bool startRecordingSession(const juce::String& file_name);
+    // file_name may also be an rtmp://, rtmps:// or srt:// URL or an .m3u8 playlist, in which case the session is
+    // streamed instead of recorded and the container options are ignored.
+    bool startRecordingSession(const juce::String& file_name, juce::int64 audioSamplePosition, double sampleRate, const RecordingOptions& options = {});
     
     bool finishRecordingSession();
 
     void cleanup();
 
+    // Changes the size of the render target without recreating the encoder. The texture keeps its ID, so FBOs it
+    // is attached to stay valid, and the CUDA device is kept. Only the frame pool and texture registration are
+    // rebuilt. Can't be called while recording.
+    bool resize(int newWidth, int newHeight);
+
     unsigned int getTextureID() {
 		return texture_id;
     }
@@ -76,6 +136,18 @@ public:
         return active;
     }
 
+    bool isStreaming() {
+        return active && streaming;
+    }
+
+    bool isStreamConnected() {
+        return isStreaming() && streamOutput->isConnected();
+    }
+
+    EncoderBackend getBackend() {
+        return backend;
+    }
+
     int getWidth() {
         return width;
     }
@@ -84,13 +156,79 @@ public:
         return height;
     }
 
+    // Length of the current recording measured on the audio clock. Safe to call from the message thread.
+    juce::int64 getRecordedMilliseconds() {
+        return recordedFrames.load() * 1000 / frameRate;
+    }
+
+    int getFrameRate() {
+        return frameRate;
+    }
+
+    // Frames that were skipped or dropped in the current session. Reset when a session starts.
+    juce::int64 getDroppedFrames() {
+        return stats.framesDropped.load();
+    }
+
+    // Safe to read from any thread.
+    const EncoderStats& getStats() {
+        return stats;
+    }
+
+    // The CUDA device context, or nullptr on the software backend.
+    AVBufferRef* getDeviceContext() {
+        return avBufferDevice;
+    }
+
+    // Number of threads the software encoder may use. 0 lets ffmpeg decide. Applied when the next session starts.
+    void setThreadCount(int threads) {
+        threadCount = threads;
+    }
+
 private:
 
-    bool initialiseVideo(OutputStream* ost, AVFormatContext* oc, const AVCodec** codec);
-    void openVideo(AVFormatContext* oc, const AVCodec* codec, OutputStream* ost, AVDictionary* opt_arg);
+    // The encoder is split into a core that lives as long as the encoder (the codec choice, CUDA device, frame pool
+    // and texture registration) and the muxer, which is created for each session. The codec context is kept between
+    // sessions too when the encoder can be flushed and nothing it was opened with has changed.
+    bool initialiseCore(AVBufferRef* sharedDevice);
+    bool initialiseFrames();
+    void releaseFrames();
+    bool prepareVideo(const EncoderProfile& sessionProfile, bool globalHeader);
+    bool openVideo(bool globalHeader);
+    void releaseVideo();
+    bool addVideoStream(OutputStream* ost, AVFormatContext* oc);
+    void closeOutput();
+    void freeOutput();
+    bool startStreamingSession(const juce::String& url, juce::int64 audioSamplePosition, double sampleRate, const EncoderProfile& sessionProfile, bool threaded);
+    void beginSession(juce::int64 audioSamplePosition, double sampleRate, bool threaded);
     AVFrame* allocFrame(enum AVPixelFormat pix_fmt, int width, int height);
+    AVFrame* allocSoftwareFrame(enum AVPixelFormat pix_fmt, int width, int height);
+#if AV_USE_NVENC
+    bool initialiseCudaDevice(AVBufferRef* sharedDevice);
+    bool initialiseCudaFrames();
+#endif
+#if AV_USE_NVENC
+    void copyTextureToFrame(AVFrame* frame);
+#endif
+    void readTextureToFrame(AVFrame* rgbFrame);
+    void convertToCodecFrame(AVFrame* rgbFrame);
+
+    // Threaded encoding. The GL thread copies the texture into a source frame and queues it, and run() encodes it.
+    struct EncodeJob {
+        AVFrame* frame; // A CUDA frame from the hwframes pool, or an RGBA frame from spareSourceFrames.
+        int64_t pts;
+        int count; // The number of frames that were due. The same frame is encoded once for each.
+        bool forceKeyframe;
+    };
+    void run() override;
+    void queueVideoFrame(const AudioFrameClock::FrameDecision& decision, bool forceKeyframe);
+    bool encodeNextJob();
+    AVFrame* takeSourceFrame();
+    void recycleSourceFrame(AVFrame* frame);
+    void releaseSourceFrames();
     void printFfmpegErr(int ret);
     
+#if AV_USE_NVENC
     int getDeviceName(juce::String& gpuName) {
         //Setup the cuda context for hardware encoding with ffmpeg
         int iGpu = 0;
@@ -131,29 +269,53 @@ private:
         gpuName = szDeviceName;
         return 1;
     }
+#endif
 
     int width, height;
-    int have_video = 0, have_audio = 0;
-    int encode_video = 0, encode_audio = 0;
+    int frameRate;
+    int threadCount = 0;
 
-    // Frame handling
-    double timePerTick = (double) 1000000000 / STREAM_FRAME_RATE;
-    double delta = 0;
-    long now = 0;
-    long lastTime = 0;
-    long timer = 0;
+    // Frame handling. Frames are timed against the audio clock so that the video can not drift from the audio.
+    AudioFrameClock frameClock;
+    std::atomic<juce::int64> recordedFrames{ 0 };
+    EncoderStats stats;
+
+    bool encodeOnThread = false;
+    juce::CriticalSection encodeQueueLock;
+    std::deque<EncodeJob> encodeQueue;
+    std::vector<AVFrame*> spareSourceFrames; // Software backend only. The hwframes pool recycles the CUDA frames.
+    int sourceFramesAllocated = 0;
 
     OutputStream video_st = { 0 };
     const AVOutputFormat* fmt;
-    AVFormatContext* oc;
-    const AVCodec* audio_codec, * video_codec;
+    AVFormatContext* oc = nullptr;
+    const AVCodec* video_codec = nullptr;
     
+    EncoderBackend backend = EncoderBackend::nvenc;
+    bool coreReady = false;
+    bool videoGlobalHeader = false; // Whether the open codec context was opened for a format that needs global headers.
+
+    // Fragmented and segmented recordings are written to disk on the sink's thread. Kept for the lifetime of the
+    // encoder so its thread is only started once.
+    ContainerMode containerMode = ContainerMode::mp4;
+    EncoderProfile profile;
+    std::unique_ptr<AsyncFileSink> fileSink;
+
+    // Streaming sessions hand their packets to the stream output instead of a local muxer. Kept like the file sink.
+    bool streaming = false;
+    std::unique_ptr<StreamOutput> streamOutput;
+
+    // Software encoding related variables.
+    SwsContext* swsContext = nullptr;
+
     // Cuda and nvenc related variables.
-    AVBufferRef* avBufferDevice, *avBufferFrame;
-    CUcontext* cudaContext;
+    AVBufferRef* avBufferDevice = nullptr, *avBufferFrame = nullptr;
     unsigned int texture_id;
+#if AV_USE_NVENC
+    CUcontext* cudaContext;
     CUDA_MEMCPY2D memcopyStruct;
-    CUgraphicsResource cudaTextureResource;
+    CUgraphicsResource cudaTextureResource = nullptr;
+#endif
 
     bool active;
 
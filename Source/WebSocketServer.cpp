@@ -0,0 +1,375 @@
+/*
+  ==============================================================================
+
+    WebSocketServer.cpp
+    Created: 19 Oct 2026 6:32:25am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#include "WebSocketServer.h"
+
+#define WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+template <typename Type>
+static void writeBigEndian(Type value, juce::uint8* destination) {
+    value = juce::ByteOrder::swapIfLittleEndian(value);
+    memcpy(destination, &value, sizeof(value));
+}
+
+// SHA-1 of data, as required by the handshake. JUCE only ships SHA-256.
+static void sha1(const char* data, size_t size, juce::uint8 digest[20]) {
+    juce::uint32 h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    std::vector<juce::uint8> message(data, data + size);
+    message.push_back(0x80);
+    while (message.size() % 64 != 56)
+        message.push_back(0);
+    juce::uint64 bits = (juce::uint64) size * 8;
+    for (int i = 7; i >= 0; i--)
+        message.push_back((juce::uint8) (bits >> (i * 8)));
+
+    auto rotate = [](juce::uint32 value, int count) { return (value << count) | (value >> (32 - count)); };
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        juce::uint32 w[80];
+        for (int i = 0; i < 16; i++)
+            w[i] = juce::ByteOrder::bigEndianInt(message.data() + chunk + i * 4);
+        for (int i = 16; i < 80; i++)
+            w[i] = rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        juce::uint32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            juce::uint32 f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            juce::uint32 temp = rotate(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotate(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    for (int i = 0; i < 5; i++)
+        writeBigEndian(h[i], digest + i * 4);
+}
+
+WebSocketServer::WebSocketServer(SocketCueResolver& socketCueResolver, FeatureBroadcaster& featureBroadcaster)
+    : socketCueResolver(socketCueResolver), featureBroadcaster(featureBroadcaster), reactor(serverSocket, *this), alive(std::make_shared<std::atomic<bool>>(true)) {
+    if (serverSocket.createListener(WEBSOCKET_DEFAULT_PORT) || serverSocket.createListener(0)) {
+        port = serverSocket.getBoundPort();
+        DBG("WebSocket server listening on port " << port << ".");
+    } else {
+        DBG("The WebSocket server failed to create a listener.");
+    }
+    featureBroadcaster.addListener(this);
+}
+
+WebSocketServer::~WebSocketServer() {
+    destroy();
+}
+
+void WebSocketServer::startListening() {
+    if (port != -1)
+        reactor.start();
+}
+
+void WebSocketServer::destroy() {
+    alive->store(false);
+    featureBroadcaster.removeListener(this);
+    reactor.stop();
+    serverSocket.close();
+}
+
+juce::String WebSocketServer::getConnectionHandle() {
+    if (port == -1)
+        return "";
+    for (auto& address : juce::IPAddress::getAllAddresses()) {
+        if (!address.isIPv6 && address.address[0] != 127)
+            return "ws://" + address.toString() + ":" + juce::String(port);
+    }
+    return "ws://127.0.0.1:" + juce::String(port);
+}
+
+bool WebSocketServer::dataReceived(int clientId, const char* data, int size) {
+    Client* registered = clients.acquire(clientId);
+    if (registered == nullptr)
+        return false;
+    Client& client = *registered;
+    client.buffer.insert(client.buffer.end(), data, data + size);
+    if (!client.open)
+        return handshake(clientId, client);
+    return readFrames(clientId, client);
+}
+
+void WebSocketServer::clientDisconnected(int clientId) {
+    clients.release(clientId);
+    setSubscribed(clientId, false);
+}
+
+bool WebSocketServer::handshake(int clientId, Client& client) {
+    const char* end = "\r\n\r\n";
+    auto headerEnd = std::search(client.buffer.begin(), client.buffer.end(), end, end + 4);
+    if (headerEnd == client.buffer.end())
+        return client.buffer.size() <= WEBSOCKET_MAX_HANDSHAKE;
+
+    juce::StringArray lines;
+    lines.addLines(juce::String::fromUTF8(client.buffer.data(), (int) (headerEnd - client.buffer.begin())));
+    juce::String key;
+    bool upgrade = false;
+    for (auto& line : lines) {
+        juce::String name = line.upToFirstOccurrenceOf(":", false, false).trim();
+        juce::String value = line.fromFirstOccurrenceOf(":", false, false).trim();
+        if (name.equalsIgnoreCase("Sec-WebSocket-Key"))
+            key = value;
+        else if (name.equalsIgnoreCase("Upgrade"))
+            upgrade = value.equalsIgnoreCase("websocket");
+    }
+    if (!lines[0].startsWith("GET ") || !upgrade || key.isEmpty()) {
+        DBG("WebSocket client " << clientId << " sent an invalid handshake.");
+        juce::String response = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+        reactor.send(clientId, response.toRawUTF8(), (int) response.getNumBytesAsUTF8());
+        return false;
+    }
+
+    juce::String accept = key + WEBSOCKET_GUID;
+    juce::uint8 digest[20];
+    sha1(accept.toRawUTF8(), accept.getNumBytesAsUTF8(), digest);
+    juce::String response = "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: " + juce::Base64::toBase64(digest, sizeof(digest)) + "\r\n\r\n";
+    if (!reactor.send(clientId, response.toRawUTF8(), (int) response.getNumBytesAsUTF8()))
+        return false;
+
+    client.open = true;
+    client.buffer.erase(client.buffer.begin(), headerEnd + 4);
+    setSubscribed(clientId, true);
+    return readFrames(clientId, client);
+}
+
+bool WebSocketServer::readFrames(int clientId, Client& client) {
+    size_t offset = 0;
+    std::vector<char>& buffer = client.buffer;
+    while (buffer.size() - offset >= 2) {
+        auto* header = (juce::uint8*) buffer.data() + offset;
+        bool fin = (header[0] & 0x80) != 0;
+        int opcode = header[0] & 0x0F;
+        bool masked = (header[1] & 0x80) != 0;
+        juce::uint64 length = header[1] & 0x7F;
+        size_t headerSize = 2;
+        if (length == 126) {
+            if (buffer.size() - offset < 4)
+                break;
+            length = juce::ByteOrder::bigEndianShort(header + 2);
+            headerSize = 4;
+        } else if (length == 127) {
+            if (buffer.size() - offset < 10)
+                break;
+            length = juce::ByteOrder::bigEndianInt64(header + 2);
+            headerSize = 10;
+        }
+        // Clients must mask every frame.
+        if (!masked) {
+            close(clientId, WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+            return false;
+        }
+        if (length > WEBSOCKET_MAX_MESSAGE) {
+            close(clientId, WEBSOCKET_CLOSE_TOO_BIG);
+            return false;
+        }
+        headerSize += 4;
+        if (buffer.size() - offset < headerSize + length)
+            break;
+
+        // Unmask in place.
+        const juce::uint8* mask = header + headerSize - 4;
+        char* payload = buffer.data() + offset + headerSize;
+        for (juce::uint64 i = 0; i < length; i++)
+            payload[i] ^= mask[i & 3];
+        offset += headerSize + (size_t) length;
+
+        if (opcode >= WEBSOCKET_OPCODE_CLOSE) {
+            if (!fin || length > 125) {
+                close(clientId, WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+                return false;
+            }
+            if (opcode == WEBSOCKET_OPCODE_CLOSE) {
+                close(clientId, WEBSOCKET_CLOSE_NORMAL);
+                return false;
+            }
+            if (opcode == WEBSOCKET_OPCODE_PING)
+                sendFrame(clientId, WEBSOCKET_OPCODE_PONG, payload, (int) length);
+            continue;
+        }
+
+        // A continuation needs a fragmented message to continue, and no new message may start inside one
+        // (RFC 6455 5.4).
+        bool continuation = opcode == WEBSOCKET_OPCODE_CONTINUATION;
+        if (continuation != (client.messageOpcode != 0)) {
+            DBG("WebSocket client " << clientId << " interleaved its message fragments. Closing it.");
+            close(clientId, WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+            return false;
+        }
+
+        // Unfragmented messages are handled straight from the buffer. Fragments are collected first.
+        if (!continuation && fin) {
+            if (!handleMessage(clientId, opcode, payload, (int) length))
+                return false;
+            continue;
+        }
+        if (!continuation)
+            client.messageOpcode = opcode;
+        client.message.insert(client.message.end(), payload, payload + length);
+        if (client.message.size() > WEBSOCKET_MAX_MESSAGE) {
+            close(clientId, WEBSOCKET_CLOSE_TOO_BIG);
+            return false;
+        }
+        if (fin) {
+            bool handled = handleMessage(clientId, client.messageOpcode, client.message.data(), (int) client.message.size());
+            client.message.clear();
+            client.messageOpcode = 0;
+            if (!handled)
+                return false;
+        }
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + offset);
+    return true;
+}
+
+bool WebSocketServer::handleMessage(int clientId, int opcode, const char* data, int size) {
+    if (opcode == WEBSOCKET_OPCODE_BINARY)
+        return handleBinaryMessage(clientId, data, size);
+    if (opcode == WEBSOCKET_OPCODE_TEXT) {
+        handleTextMessage(clientId, juce::String::fromUTF8(data, size).trim());
+        return true;
+    }
+    close(clientId, WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+    return false;
+}
+
+// A binary message holds whole CueProtocol frames. One that doesn't is malformed.
+bool WebSocketServer::handleBinaryMessage(int clientId, const char* data, int size) {
+    int offset = 0;
+    CueFrame frame;
+    while (offset < size) {
+        int frameSize = CueProtocol::parseFrame(data + offset, (size_t) (size - offset), frame);
+        std::vector<SocketCue> cues;
+        if (frameSize <= 0 || !SocketCueResolver::readCues(frame, cues)) {
+            DBG("WebSocket client " << clientId << " sent a malformed cue frame. Closing it.");
+            juce::MemoryBlock ack = CueProtocol::makeAck(0, CUE_ACK_MALFORMED, 0);
+            sendFrame(clientId, WEBSOCKET_OPCODE_BINARY, ack.getData(), (int) ack.getSize());
+            close(clientId, WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+            return false;
+        }
+
+        if (frame.scheduled) {
+            juce::MemoryBlock ack = socketCueResolver.scheduleCues(frame, cues);
+            if (ack.getSize() > 0)
+                sendFrame(clientId, WEBSOCKET_OPCODE_BINARY, ack.getData(), (int) ack.getSize());
+        } else {
+            socketCueResolver.runCues(frame.sequence, (frame.flags & CUE_FLAG_ACK) != 0, std::move(cues), getReplies(clientId, WEBSOCKET_OPCODE_BINARY));
+        }
+        offset += frameSize;
+    }
+    return true;
+}
+
+void WebSocketServer::handleTextMessage(int clientId, const juce::String& text) {
+    int cueId, body;
+    if (SocketCueResolver::parseTextCue(text, cueId, body))
+        socketCueResolver.runTextCue(cueId, body, getReplies(clientId, WEBSOCKET_OPCODE_TEXT));
+}
+
+// Replies are sent as one message of the same type as the cues they answer.
+CueReplies WebSocketServer::getReplies(int clientId, int opcode) {
+    return { alive,
+        [this, clientId](bool subscribed) { setSubscribed(clientId, subscribed); },
+        [this, clientId, opcode](const void* data, int size) { sendFrame(clientId, opcode, data, size); } };
+}
+
+void WebSocketServer::setSubscribed(int clientId, bool subscribed) {
+    const juce::ScopedLock lock(subscribersLock);
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [clientId](const Subscriber& subscriber) {
+        return subscriber.clientId == clientId;
+    }), subscribers.end());
+    if (subscribed)
+        subscribers.push_back({ clientId, true });
+}
+
+bool WebSocketServer::wantsFeatures() {
+    const juce::ScopedLock lock(subscribersLock);
+    return !subscribers.empty();
+}
+
+void WebSocketServer::featuresReady(const AudioFeatures& features, const char* packed, int size) {
+    makeFrame(featureFrame, WEBSOCKET_OPCODE_BINARY, packed, size);
+
+    bool stateChanged = features.preset != lastPreset || features.playing != lastPlaying;
+    lastPreset = features.preset;
+    lastPlaying = features.playing;
+    juce::String state = "{\"type\":\"state\",\"preset\":" + juce::String(features.preset)
+        + ",\"playing\":" + (features.playing ? "true" : "false") + "}";
+    makeFrame(stateFrame, WEBSOCKET_OPCODE_TEXT, state.toRawUTF8(), (int) state.getNumBytesAsUTF8());
+
+    // Slow browsers lose their oldest frames in the reactor's send queue rather than holding up the others.
+    const juce::ScopedLock lock(subscribersLock);
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [&](Subscriber& subscriber) {
+        if (stateChanged || subscriber.needsState) {
+            subscriber.needsState = false;
+            if (!reactor.publish(subscriber.clientId, stateFrame.data(), (int) stateFrame.size()))
+                return true;
+        }
+        return !reactor.publish(subscriber.clientId, featureFrame.data(), (int) featureFrame.size());
+    }), subscribers.end());
+}
+
+bool WebSocketServer::sendFrame(int clientId, int opcode, const void* data, int size) {
+    std::vector<char> frame;
+    makeFrame(frame, opcode, data, size);
+    return reactor.send(clientId, frame.data(), (int) frame.size());
+}
+
+void WebSocketServer::close(int clientId, int code) {
+    juce::uint8 payload[2];
+    writeBigEndian((juce::uint16) code, payload);
+    sendFrame(clientId, WEBSOCKET_OPCODE_CLOSE, payload, sizeof(payload));
+}
+
+// Server frames are never masked or fragmented.
+void WebSocketServer::makeFrame(std::vector<char>& frame, int opcode, const void* data, int size) {
+    frame.resize(WEBSOCKET_MAX_FRAME_HEADER + (size_t) size);
+    auto* header = (juce::uint8*) frame.data();
+    header[0] = (juce::uint8) (0x80 | opcode);
+    size_t headerSize;
+    if (size < 126) {
+        header[1] = (juce::uint8) size;
+        headerSize = 2;
+    } else if (size <= 0xFFFF) {
+        header[1] = 126;
+        writeBigEndian((juce::uint16) size, header + 2);
+        headerSize = 4;
+    } else {
+        header[1] = 127;
+        writeBigEndian((juce::uint64) size, header + 2);
+        headerSize = 10;
+    }
+    memcpy(frame.data() + headerSize, data, (size_t) size);
+    frame.resize(headerSize + (size_t) size);
+}
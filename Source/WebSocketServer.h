@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    WebSocketServer.h
+    Created: 19 Oct 2026 6:32:25am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "SocketCueResolver.h"
+#include "SocketReactor.h"
+#include "ClientRegistry.h"
+#include "CueProtocol.h"
+#include "FeatureBroadcaster.h"
+
+#define WEBSOCKET_DEFAULT_PORT 9001 // Falls back to any free port if taken.
+#define WEBSOCKET_MAX_HANDSHAKE 8192
+#define WEBSOCKET_MAX_MESSAGE (CUE_PROTOCOL_HEADER_SIZE + CUE_PROTOCOL_MAX_PAYLOAD)
+#define WEBSOCKET_MAX_FRAME_HEADER 14
+
+#define WEBSOCKET_OPCODE_CONTINUATION 0x0
+#define WEBSOCKET_OPCODE_TEXT 0x1
+#define WEBSOCKET_OPCODE_BINARY 0x2
+#define WEBSOCKET_OPCODE_CLOSE 0x8
+#define WEBSOCKET_OPCODE_PING 0x9
+#define WEBSOCKET_OPCODE_PONG 0xA
+
+#define WEBSOCKET_CLOSE_NORMAL 1000
+#define WEBSOCKET_CLOSE_PROTOCOL_ERROR 1002
+#define WEBSOCKET_CLOSE_TOO_BIG 1009
+
+/*
+    A WebSocket endpoint for the web UI, remote dashboards and phones.
+
+    Takes the same cues as GlobalSocketHandler: text messages are "post:body" and binary messages hold one or
+    more CueProtocol frames, acked the same way. Every client is subscribed to audio features when it connects
+    and gets each CUE_FRAME_FEATURES frame as a binary message, plus a JSON text message whenever the preset or
+    transport changes. SOCKET_CUE_SUBSCRIBE_FEATURES with a body of 0 turns the stream off.
+
+    Runs on its own SocketReactor, so browsers never share a thread with show control. Frames are unmasked in
+    place in each client's buffer.
+*/
+class WebSocketServer : private SocketReactor::Listener, private FeatureBroadcaster::Listener {
+public:
+    WebSocketServer(SocketCueResolver& socketCueResolver, FeatureBroadcaster& featureBroadcaster);
+    ~WebSocketServer() override;
+
+    void startListening();
+    void destroy();
+
+    // ws://address:port, or empty if the server isn't listening.
+    juce::String getConnectionHandle();
+
+private:
+    SocketCueResolver& socketCueResolver;
+    FeatureBroadcaster& featureBroadcaster;
+
+    int port = -1;
+    juce::StreamingSocket serverSocket;
+    SocketReactor reactor;
+    std::shared_ptr<std::atomic<bool>> alive; // Cleared by destroy(), so cues still queued for the message thread are dropped.
+
+    // Only touched on the reactor thread.
+    struct Client {
+        bool open = false; // Set once the handshake is done.
+        std::vector<char> buffer;
+        std::vector<char> message; // A fragmented message collected so far.
+        int messageOpcode = 0; // The opcode of the fragmented message, or 0 when none is in progress.
+
+        // Keeps the buffers for the next client unless this one grew its buffer past a normal read.
+        void reset() {
+            open = false;
+            messageOpcode = 0;
+            buffer.clear();
+            message.clear();
+            if (buffer.capacity() > SOCKET_REACTOR_READ_SIZE)
+                buffer.shrink_to_fit();
+        }
+    };
+    ClientRegistry<Client> clients{ SOCKET_REACTOR_MAX_CLIENTS };
+
+    // Changed on the message and reactor threads, read on the broadcaster thread.
+    struct Subscriber {
+        int clientId;
+        bool needsState; // Sent the current state on the next tick, even if it hasn't changed.
+    };
+    juce::CriticalSection subscribersLock;
+    std::vector<Subscriber> subscribers;
+
+    // Only touched on the broadcaster thread.
+    int lastPreset = -1;
+    bool lastPlaying = false;
+    std::vector<char> featureFrame, stateFrame;
+
+    bool dataReceived(int clientId, const char* data, int size) override;
+    void clientDisconnected(int clientId) override;
+
+    bool wantsFeatures() override;
+    void featuresReady(const AudioFeatures& features, const char* packed, int size) override;
+
+    bool handshake(int clientId, Client& client);
+    bool readFrames(int clientId, Client& client);
+    bool handleMessage(int clientId, int opcode, const char* data, int size);
+    bool handleBinaryMessage(int clientId, const char* data, int size);
+    void handleTextMessage(int clientId, const juce::String& text);
+    CueReplies getReplies(int clientId, int opcode);
+    void setSubscribed(int clientId, bool subscribed);
+
+    bool sendFrame(int clientId, int opcode, const void* data, int size);
+    void close(int clientId, int code);
+    static void makeFrame(std::vector<char>& frame, int opcode, const void* data, int size);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WebSocketServer)
+};
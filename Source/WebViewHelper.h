@@ -12,9 +12,13 @@
 
 #include <JuceHeader.h>
 
+#include <list>
 #include <ranges>
+#include <unordered_map>
 #include <WebViewFiles.h>
 
+#define WEBVIEW_CACHE_BYTES 1048576 // 1MB of decompressed resources, several times the whole UI.
+
 /*
     Normalise paths to user the / file seperator convention. 
 */
@@ -57,30 +61,89 @@ inline const char* getMimeForExtension(const juce::String& extension) {
     return "";
 }
 
-inline std::vector<std::byte> getWebViewFilesAsBytes(const juce::String resourceToRetrieve) {
-    juce::MemoryInputStream zipStream{ webview_files::ui_zip, webview_files::ui_zipSize, false };
-    juce::ZipFile zipFile{ zipStream };
+/*
+    The files of the web UI, served from the ui.zip embedded in the binary.
 
-    for (const auto i : std::views::iota(0, zipFile.getNumEntries())) {
-        const auto* zipEntry = zipFile.getEntry(i);
+    The zip is opened and its entries indexed by normalised path once, so a request is a map lookup rather than
+    a scan of every entry. Decompressed files are kept in a least recently used cache of up to
+    WEBVIEW_CACHE_BYTES, so opening a window a second time doesn't decompress anything.
 
-        if (normalizePath(zipEntry->filename) == normalizePath(resourceToRetrieve)) {
-            DBG("The path " << normalizePath(zipEntry->filename) << " was found when trying to retrieve " << resourceToRetrieve);
-            const std::unique_ptr<juce::InputStream> entryStream{ zipFile.createStreamForEntry(*zipEntry) };
-            return streamToVector(*entryStream);
+    Shared through juce::SharedResourcePointer. The editor holds one for its lifetime, so the index and cache
+    outlive the windows that use them. Safe to call from any thread.
+*/
+class WebViewResources {
+public:
+    WebViewResources() : zipStream(webview_files::ui_zip, webview_files::ui_zipSize, false), zipFile(zipStream) {
+        for (const auto i : std::views::iota(0, zipFile.getNumEntries())) {
+            const auto* zipEntry = zipFile.getEntry(i);
+            if (!zipEntry->filename.endsWithChar('/'))
+                index[normalizePath(zipEntry->filename)] = i;
         }
+        DBG("Indexed " << (int) index.size() << " web view files.");
     }
-    return {};
+
+    // The bytes of a file, or nothing if ui.zip doesn't have it. The result is a copy, since
+    // WebBrowserComponent::Resource owns its data, but it is the only one made per request.
+    std::vector<std::byte> getFileAsBytes(const juce::String& resourceToRetrieve) {
+        const juce::String path = normalizePath(resourceToRetrieve);
+        const juce::ScopedLock scopedLock(lock);
+
+        auto cachedFile = cached.find(path);
+        if (cachedFile != cached.end()) {
+            recent.splice(recent.begin(), recent, cachedFile->second);
+            return cachedFile->second->bytes;
+        }
+
+        auto entry = index.find(path);
+        if (entry == index.end())
+            return {};
+        DBG("The path " << path << " was found when trying to retrieve " << resourceToRetrieve);
+        const std::unique_ptr<juce::InputStream> entryStream{ zipFile.createStreamForEntry(entry->second) };
+        if (entryStream == nullptr)
+            return {};
+        recent.push_front({ path, streamToVector(*entryStream) });
+        cached[path] = recent.begin();
+        cachedBytes += recent.front().bytes.size();
+        // The file just read is always kept, even if it is bigger than the whole cache.
+        while (cachedBytes > WEBVIEW_CACHE_BYTES && recent.size() > 1) {
+            cachedBytes -= recent.back().bytes.size();
+            cached.erase(recent.back().path);
+            recent.pop_back();
+        }
+        return recent.front().bytes;
+    }
+
+private:
+    struct CachedFile {
+        juce::String path;
+        std::vector<std::byte> bytes;
+    };
+
+    juce::MemoryInputStream zipStream;
+    juce::ZipFile zipFile;
+    std::unordered_map<juce::String, int> index; // Normalised path to zip entry.
+
+    juce::CriticalSection lock;
+    std::list<CachedFile> recent; // Most recently used first.
+    std::unordered_map<juce::String, std::list<CachedFile>::iterator> cached;
+    size_t cachedBytes = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WebViewResources)
+};
+
+inline std::vector<std::byte> getWebViewFilesAsBytes(const juce::String resourceToRetrieve) {
+    juce::SharedResourcePointer<WebViewResources> resources;
+    return resources->getFileAsBytes(resourceToRetrieve);
 }
 
 inline auto getResource(const juce::String& url) -> std::optional<juce::WebBrowserComponent::Resource> {
 
     const auto resourceToRetrieve = url == "/" ? "index.html" : url.fromFirstOccurrenceOf("/", false, false);
 
-    const auto resource = getWebViewFilesAsBytes(resourceToRetrieve);
+    auto resource = getWebViewFilesAsBytes(resourceToRetrieve);
     if (!resource.empty()) {
         const auto extension = resourceToRetrieve.fromLastOccurrenceOf(".", false, false);
         return juce::WebBrowserComponent::Resource{std::move(resource), getMimeForExtension(extension)};
     }
     return std::nullopt;
-}
\ No newline at end of file
+}
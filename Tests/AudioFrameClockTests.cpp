@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    AudioFrameClockTests.cpp
+    Created: 19 Oct 2026 7:10:21am
+    Author:  lucas
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/AudioFrameClock.h"
+
+/*
+    Steps an AudioFrameClock across a whole MAX_RECORDING_LENGTH recording, the way the GL thread does, and checks
+    that the video ends exactly where the audio does.
+*/
+class AudioFrameClockTests : public juce::UnitTest {
+public:
+    AudioFrameClockTests() : juce::UnitTest("AudioFrameClock", "Recording") {}
+
+    void runTest() override {
+        for (double sampleRate : { 44100.0, 48000.0 }) {
+            for (int frameRate : { 24, 25, 30, 50, 60, 120 }) {
+                beginTest(juce::String(sampleRate, 0) + " Hz at " + juce::String(frameRate) + " fps");
+                checkFrameBoundaries(sampleRate, frameRate);
+                checkRecording(sampleRate, frameRate, false);
+                checkRecording(sampleRate, frameRate, true);
+            }
+        }
+    }
+
+private:
+    static constexpr juce::int64 startSample = 123456; // Recordings rarely start at the first sample.
+
+    static juce::int64 getRecordingSamples(double sampleRate) {
+        return (juce::int64) MAX_RECORDING_LENGTH * (juce::int64) sampleRate / 1000;
+    }
+
+    // Every frame starts on the first sample at or after n * sampleRate / fps, however far into the recording.
+    void checkFrameBoundaries(double sampleRate, int frameRate) {
+        AudioFrameClock clock;
+        clock.reset(startSample, sampleRate, frameRate);
+        juce::int64 numFrames = getRecordingSamples(sampleRate) * frameRate / (juce::int64) sampleRate;
+        int failures = 0;
+        for (juce::int64 frame = 0; frame <= numFrames && failures < 10; frame++) {
+            juce::int64 first = (frame * (juce::int64) sampleRate + frameRate - 1) / frameRate;
+            if (clock.getFrameIndexForSample(startSample + first) != frame
+                || (first > 0 && clock.getFrameIndexForSample(startSample + first - 1) != frame - 1)) {
+                failures++;
+                expect(false, "Frame " + juce::String(frame) + " doesn't start at sample " + juce::String(first));
+            }
+        }
+        expectEquals(failures, 0);
+    }
+
+    // Feeds the clock the audio position once per GL frame, with the jitter of a ~60 Hz render loop reading a
+    // ring buffer filled in blocks, and adds up the frames it hands out.
+    void checkRecording(double sampleRate, int frameRate, bool withStalls) {
+        AudioFrameClock clock;
+        clock.reset(startSample, sampleRate, frameRate);
+        juce::Random random(frameRate * 7919 + (int) sampleRate + (withStalls ? 1 : 0));
+
+        juce::int64 end = startSample + getRecordingSamples(sampleRate);
+        juce::int64 position = startSample;
+        juce::int64 expectedPts = 0, written = 0, skipped = 0;
+        bool contiguous = true;
+        while (position < end - 1) {
+            int glFrameSamples = (int) (sampleRate / 60);
+            position = juce::jmin(end - 1, position + glFrameSamples / 2 + random.nextInt(glFrameSamples));
+            // A stall holds the GL thread up for a few frames, sometimes longer than duplicates can cover.
+            if (withStalls && random.nextInt(500) == 0)
+                position = juce::jmin(end - 1, position + (juce::int64) (sampleRate * (1 + random.nextInt(10)) / frameRate));
+
+            AudioFrameClock::FrameDecision decision = clock.getFramesDue(position);
+            if (decision.count == 0)
+                continue;
+            contiguous = contiguous && decision.pts == expectedPts + decision.skipped;
+            expectedPts = decision.pts + decision.count;
+            written += decision.count;
+            skipped += decision.skipped;
+        }
+
+        juce::int64 expectedFrames = clock.getFrameIndexForSample(end - 1) + 1;
+        expect(contiguous, "Timestamps have gaps that weren't reported as skipped");
+        expectEquals(clock.getFramesElapsed(), expectedFrames);
+        expectEquals(written + skipped, expectedFrames);
+        if (!withStalls)
+            expectEquals(skipped, (juce::int64) 0);
+
+        // Zero drift: the video is as long as the audio, to within the frame still being drawn. Compared in
+        // samples times frames, so the check itself can't round.
+        juce::int64 video = clock.getFramesElapsed() * (juce::int64) sampleRate;
+        juce::int64 audio = (end - startSample) * frameRate;
+        expect(video >= audio && video - audio < (juce::int64) sampleRate,
+            "Video is " + juce::String(video - audio) + " sample frames off the audio");
+    }
+};
+
+static AudioFrameClockTests audioFrameClockTests;
+
+int main() {
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runAllTests();
+    for (int i = 0; i < runner.getNumResults(); i++) {
+        if (runner.getResult(i)->failures > 0)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+import argparse
+import json
+import threading
+import time
+import urllib.parse
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+# A stand-in for the AudioVisualiser backend, for trying the plugin's API client without the Spring server.
+# Speaks HTTP/1.1 with keep-alive and logs each request with the connection it arrived on, so connection reuse
+# shows as several requests on the same connection. --delay-ms slows every reply to try timeouts and cancelling.
+# Bodies are sent with an ETag and answered with 304 when If-None-Match still matches. --legacy drops the list
+# endpoint, versions and ETags, like servers from before the render state cache.
+# --chunked sends lists with chunked encoding a little at a time, to watch the picker fill as a list streams in.
+# /prompt streams the shader a few characters at a time, as server-sent events to clients that accept them and as
+# JSON to ones that don't. --prompt-format forces one of sse, text (chunked plain text) or json. --delay-ms is also
+# the wait between pieces of a streamed shader, to watch it arrive and to try stopping it part way.
+# Usage: python av-api-stub.py [--port 8080] [--delay-ms 0] [--states 5] [--legacy] [--chunked] [--prompt-format sse]
+
+parser = argparse.ArgumentParser(description="AudioVisualiser API stub server")
+parser.add_argument("--port", type=int, default=8080)
+parser.add_argument("--delay-ms", type=int, default=0, help="Wait this long before every reply.")
+parser.add_argument("--states", type=int, default=5, help="Render states the stub starts with.")
+parser.add_argument("--legacy", action="store_true", help="Behave like a server without the list endpoint or ETags.")
+parser.add_argument("--chunked", action="store_true", help="Stream lists in small chunks, waiting --delay-ms between them.")
+parser.add_argument("--prompt-format", choices=["sse", "text", "json"], help="Answer /prompt this way whatever the client accepts.")
+args = parser.parse_args()
+
+SHADER = "#version 330 core\nout vec4 outColour;\nvoid main() {\n    outColour = vec4(0.2, 0.4, 0.8, 1.0);\n}\n"
+# A shader with a helper defined after main, so the first compile of it streaming in fails and a later one works.
+PROMPT_SHADER = ("#version 330 core\nuniform int time;\nuniform float leftRMS;\nout vec4 outColour;\n"
+                 "vec3 palette(float t);\nvoid main() {\n    // Pulse with the left channel.\n"
+                 "    outColour = vec4(palette(float(time) * 0.001 + leftRMS), 1.0);\n}\n"
+                 "vec3 palette(float t) {\n    return 0.5 + 0.5 * cos(6.28318 * (t + vec3(0.0, 0.33, 0.67)));\n}\n")
+
+lock = threading.Lock()
+states = {i: {"id": i, "name": "Stub state %d" % i, "renderState": SHADER, "version": 1} for i in range(1, args.states + 1)}
+next_id = args.states + 1
+connections = 0
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def setup(self):
+        global connections
+        super().setup()
+        with lock:
+            connections += 1
+            self.connection_number = connections
+        self.requests_served = 0
+
+    def reply(self, status, body, etag=None):
+        if args.delay_ms > 0:
+            time.sleep(args.delay_ms / 1000.0)
+        data = body.encode() if isinstance(body, str) else json.dumps(body).encode()
+        if args.chunked and isinstance(body, list):
+            self.reply_chunked(status, data)
+            return
+        self.send_response(status)
+        self.send_header("Content-Length", str(len(data)))
+        if etag and not args.legacy:
+            self.send_header("ETag", etag)
+        self.end_headers()
+        self.wfile.write(data)
+
+    def reply_chunked(self, status, data):
+        self.send_response(status)
+        self.send_header("Transfer-Encoding", "chunked")
+        self.end_headers()
+        for start in range(0, len(data), 256):
+            chunk = data[start:start + 256]
+            self.wfile.write(b"%x\r\n%s\r\n" % (len(chunk), chunk))
+            self.wfile.flush()
+            if args.delay_ms > 0:
+                time.sleep(args.delay_ms / 1000.0)
+        self.wfile.write(b"0\r\n\r\n")
+
+    def reply_prompt(self):
+        accept = self.headers.get("Accept", "")
+        prompt_format = args.prompt_format or ("sse" if "text/event-stream" in accept else "json")
+        if prompt_format == "json":
+            self.reply(200, {"success": True, "prompt": PROMPT_SHADER})
+            return
+        self.send_response(200)
+        self.send_header("Content-Type", "text/event-stream" if prompt_format == "sse" else "text/plain")
+        self.send_header("Transfer-Encoding", "chunked")
+        self.end_headers()
+        # Streamed like a model writes it, in a markdown fence.
+        fenced = "```glsl\n" + PROMPT_SHADER + "```\n"
+        pieces = [fenced[start:start + 12] for start in range(0, len(fenced), 12)]
+        if prompt_format == "sse":
+            # A data line can't hold a newline, so a piece with one is split across several data lines.
+            pieces = [": generating\n\n"] + ["".join("data: %s\n" % line for line in piece.split("\n")) + "\n" for piece in pieces] + ["data: [DONE]\n\n"]
+        try:
+            for piece in pieces:
+                data = piece.encode()
+                self.wfile.write(b"%x\r\n%s\r\n" % (len(data), data))
+                self.wfile.flush()
+                if args.delay_ms > 0:
+                    time.sleep(args.delay_ms / 1000.0)
+            self.wfile.write(b"0\r\n\r\n")
+        except (BrokenPipeError, ConnectionResetError):
+            print("connection %d: the client stopped the prompt" % self.connection_number, flush=True)
+            self.close_connection = True
+
+    def read_form(self):
+        length = int(self.headers.get("Content-Length", 0))
+        return urllib.parse.parse_qs(self.rfile.read(length).decode()) if length > 0 else {}
+
+    def query(self):
+        return urllib.parse.parse_qs(urllib.parse.urlparse(self.path).query)
+
+    def route(self):
+        return urllib.parse.urlparse(self.path).path
+
+    def visible(self, state):
+        return {key: value for key, value in state.items() if key != "version" or not args.legacy}
+
+    def log_message(self, format, *log_args):
+        self.requests_served += 1
+        print("connection %d request %d: %s" % (self.connection_number, self.requests_served, format % log_args), flush=True)
+
+    def do_GET(self):
+        route = self.route()
+        if route == "/renderState/getAll":
+            with lock:
+                all_states = [self.visible(state) for state in states.values()]
+            self.reply(200, all_states)
+        elif route == "/renderState/list" and not args.legacy:
+            with lock:
+                summaries = [{"id": state["id"], "name": state["name"], "version": state["version"]} for state in states.values()]
+            self.reply(200, summaries)
+        elif route == "/renderState/get":
+            state_id = int(self.query().get("id", ["0"])[0])
+            with lock:
+                state = states.get(state_id)
+            if not state:
+                self.reply(404, "")
+                return
+            etag = '"%d-%d"' % (state["id"], state["version"])
+            if not args.legacy and self.headers.get("If-None-Match") == etag:
+                self.reply(304, "", etag)
+            else:
+                self.reply(200, self.visible(state), etag)
+        else:
+            self.reply(404, "")
+
+    def do_POST(self):
+        global next_id
+        route = self.route()
+        form = self.read_form()
+        if route == "/auth/token":
+            self.reply(200, "stub-jwt")
+        elif route == "/auth/register":
+            self.reply(200, {"success": 0})
+        elif route == "/prompt":
+            self.reply_prompt()
+        elif route == "/renderState/add":
+            body = json.loads(form.get("jsonrsbody", ["{}"])[0])
+            with lock:
+                state_id = next_id
+                next_id += 1
+                states[state_id] = {"id": state_id, "name": body.get("name", ""), "renderState": body.get("renderState", ""), "version": 1}
+            self.reply(200, str(state_id))
+        else:
+            self.reply(404, "")
+
+    def do_DELETE(self):
+        route = self.route()
+        self.read_form()
+        if route == "/renderState/delete":
+            state_id = int(self.query().get("id", ["0"])[0])
+            with lock:
+                removed = states.pop(state_id, None)
+            self.reply(200, "1" if removed else "0")
+        elif route == "/renderState/deleteAll":
+            with lock:
+                states.clear()
+            self.reply(200, "1")
+        else:
+            self.reply(404, "")
+
+
+print("AudioVisualiser API stub listening on port %d" % args.port, flush=True)
+ThreadingHTTPServer(("", args.port), Handler).serve_forever()
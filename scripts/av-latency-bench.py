@@ -0,0 +1,85 @@
+import argparse
+import socket
+import statistics
+import struct
+import time
+
+# Measures the round trip time of a cue through the AudioVisualiser socket server.
+# The encoder stats query (cue 4) is used as the probe because it is the only cue that is answered.
+# The round trip covers the socket thread, the hop to the message thread and the reply.
+# With --binary the probe uses the framed protocol from Source/CueProtocol.h and waits for the ack.
+# Usage: python av-latency-bench.py --host 192.168.0.10 --port 50123 --idle-clients 32 --cues 1000 [--binary]
+
+parser = argparse.ArgumentParser(description="AudioVisualiser cue latency benchmark")
+parser.add_argument("--host", required=True)
+parser.add_argument("--port", type=int, required=True)
+parser.add_argument("--idle-clients", type=int, default=0, help="Connections that stay open without sending anything.")
+parser.add_argument("--cues", type=int, default=500)
+parser.add_argument("--binary", action="store_true", help="Send framed binary cues instead of text.")
+args = parser.parse_args()
+
+idle = []
+for i in range(args.idle_clients):
+    idle.append(socket.create_connection((args.host, args.port)))
+
+probe = socket.create_connection((args.host, args.port))
+probe.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+
+def read_reply(sock):
+    data = b""
+    while not data.endswith(b"\n"):
+        chunk = sock.recv(4096)
+        if not chunk:
+            raise ConnectionError("The server closed the connection.")
+        data += chunk
+    return data
+
+CUE_PROTOCOL_MAGIC = 0xA7
+CUE_FRAME_CUE = 1
+CUE_FRAME_ACK = 3
+CUE_FLAG_ACK = 0x0001
+CUE_VALUE_NONE = 0
+
+def recv_exactly(sock, size):
+    data = b""
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            raise ConnectionError("The server closed the connection.")
+        data += chunk
+    return data
+
+def make_cue_frame(sequence, cue_id):
+    record = struct.pack("<HBBI", cue_id, CUE_VALUE_NONE, 0, 0)
+    return struct.pack("<BBHII", CUE_PROTOCOL_MAGIC, CUE_FRAME_CUE, CUE_FLAG_ACK, len(record), sequence) + record
+
+def read_ack(sock, sequence):
+    magic, frame_type, flags, length, ack_sequence = struct.unpack("<BBHII", recv_exactly(sock, 12))
+    payload = recv_exactly(sock, length)
+    if magic != CUE_PROTOCOL_MAGIC or frame_type != CUE_FRAME_ACK or ack_sequence != sequence:
+        raise ValueError("Unexpected frame from the server.")
+    return payload
+
+samples = []
+for i in range(args.cues):
+    start = time.perf_counter()
+    if args.binary:
+        probe.sendall(make_cue_frame(i, 4))
+        read_ack(probe, i)
+    else:
+        probe.sendall(b"4:0")
+        read_reply(probe)
+    samples.append((time.perf_counter() - start) * 1000.0)
+
+samples.sort()
+print("cues: %d, idle clients: %d, %s" % (len(samples), args.idle_clients, "binary" if args.binary else "text"))
+print("min %.3fms  p50 %.3fms  p99 %.3fms  max %.3fms  mean %.3fms" % (
+    samples[0],
+    samples[len(samples) // 2],
+    samples[min(len(samples) - 1, int(len(samples) * 0.99))],
+    samples[-1],
+    statistics.mean(samples)))
+
+probe.close()
+for sock in idle:
+    sock.close()
\ No newline at end of file
@@ -31,6 +31,67 @@ document.addEventListener("DOMContentLoaded", () => {
 		}
 	});
 	
+	nativeFunctionGetSettingsHandle(4).then((result) => {
+		console.log("Getting setting SETTINGS_RECORDING_MODE and received result:");
+		console.log(result);
+		if (result != -1) {
+			document.getElementById("recordingMode").value = result;
+		}
+	});
+	
+	nativeFunctionGetSettingsHandle(5).then((result) => {
+		console.log("Getting setting SETTINGS_SEGMENT_LENGTH and received result:");
+		console.log(result);
+		if (result != -1) {
+			document.getElementById("segmentLength").value = result;
+		}
+	});
+	
+	nativeFunctionGetSettingsHandle(6).then((result) => {
+		console.log("Getting setting SETTINGS_ENCODER_PROFILE and received result:");
+		console.log(result);
+		if (result != -1) {
+			document.getElementById("encoderProfile").value = result;
+			showEncoderForm(result == 3);
+		}
+	});
+	
+	nativeFunctionGetSettingsHandle(7).then((result) => {
+		console.log("Getting setting SETTINGS_ENCODER_CUSTOM and received result:");
+		console.log(result);
+		if (result != -1) {
+			document.getElementById("bitRate").value = result.bitRateKbps;
+			document.getElementById("keyframeSeconds").value = result.keyframeSeconds;
+			document.getElementById("preset").value = result.preset;
+			document.getElementById("tune").value = result.tune;
+			document.getElementById("rateControl").value = result.rateControl;
+		}
+	});
+	
+	nativeFunctionGetSettingsHandle(8).then((result) => {
+		console.log("Getting setting SETTINGS_STREAM_URL and received result:");
+		console.log(result);
+		if (result != -1) {
+			document.getElementById("streamUrl").value = result;
+		}
+	});
+	
+	nativeFunctionGetSettingsHandle(9).then((result) => {
+		console.log("Getting setting SETTINGS_PREVIEW_OUTPUT and received result:");
+		console.log(result);
+		if (result != -1) {
+			document.getElementById("previewOutput").value = result;
+		}
+	});
+	
+	nativeFunctionGetSettingsHandle(10).then((result) => {
+		console.log("Getting setting SETTINGS_FEATURE_RATE and received result:");
+		console.log(result);
+		if (result != -1) {
+			document.getElementById("featureRate").value = result;
+		}
+	});
+	
 	var widthHeightButton = document.getElementById("nativeFunctionWidthHeightButton");
 	widthHeightButton.addEventListener("click", () => {
 		const formData = new FormData(document.getElementById("whForm"));
@@ -69,4 +130,137 @@ document.addEventListener("DOMContentLoaded", () => {
 			}
 		});
 	});
-});
\ No newline at end of file
+	
+	var recordingModeSelector = document.getElementById("recordingMode");
+	recordingModeSelector.addEventListener("change", () => {
+		const SETTINGS_RECORDING_MODE = 4;
+		
+		nativeFunctionChangeSettingsHandle(SETTINGS_RECORDING_MODE, recordingModeSelector.value).then((result) => {
+			if (!result) {
+				alert("There was an error changing this setting!");
+			}
+		});
+	});
+	
+	var segmentLengthButton = document.getElementById("nativeFunctionSegmentLengthButton");
+	segmentLengthButton.addEventListener("click", () => {
+		const segmentLength = document.getElementById("segmentLength").value;
+		
+		if (segmentLength < 2 || segmentLength > 600) {
+			segmentLengthButton.style.backgroundColor = "#faa";
+			return;
+		}
+		
+		const SETTINGS_SEGMENT_LENGTH = 5;
+		nativeFunctionChangeSettingsHandle(SETTINGS_SEGMENT_LENGTH, segmentLength).then((result) => {
+			if (!result) {
+				segmentLengthButton.style.backgroundColor = "#faa";
+				alert("There was an error changing this setting!");
+			} else {
+				segmentLengthButton.style.backgroundColor = "#afa";
+				setTimeout(() => {
+					segmentLengthButton.style.backgroundColor = "#fff";
+				}, 2000);
+			}
+		});
+	});
+	
+	var encoderProfileSelector = document.getElementById("encoderProfile");
+	encoderProfileSelector.addEventListener("change", () => {
+		const SETTINGS_ENCODER_PROFILE = 6;
+		
+		showEncoderForm(encoderProfileSelector.value == 3);
+		nativeFunctionChangeSettingsHandle(SETTINGS_ENCODER_PROFILE, encoderProfileSelector.value).then((result) => {
+			if (!result) {
+				alert("There was an error changing this setting!");
+			}
+		});
+	});
+	
+	var encoderCustomButton = document.getElementById("nativeFunctionEncoderCustomButton");
+	encoderCustomButton.addEventListener("click", () => {
+		const formData = new FormData(document.getElementById("encoderForm"));
+		const bitRate = formData.get("bitRate");
+		const keyframeSeconds = formData.get("keyframeSeconds");
+		
+		if (bitRate < 500 || bitRate > 100000 || keyframeSeconds < 0.1 || keyframeSeconds > 10) {
+			encoderCustomButton.style.backgroundColor = "#faa";
+			return;
+		}
+		
+		const SETTINGS_ENCODER_CUSTOM = 7;
+		nativeFunctionChangeSettingsHandle(SETTINGS_ENCODER_CUSTOM, bitRate, keyframeSeconds, formData.get("preset"), formData.get("tune"), formData.get("rateControl")).then((result) => {
+			if (!result) {
+				encoderCustomButton.style.backgroundColor = "#faa";
+				alert("There was an error changing this setting!");
+			} else {
+				encoderCustomButton.style.backgroundColor = "#afa";
+				setTimeout(() => {
+					encoderCustomButton.style.backgroundColor = "#fff";
+				}, 2000);
+			}
+		});
+	});
+	
+	var streamUrlButton = document.getElementById("nativeFunctionStreamUrlButton");
+	streamUrlButton.addEventListener("click", () => {
+		const streamUrl = document.getElementById("streamUrl").value.trim();
+		
+		if (!/^(rtmps?|srt):\/\/./i.test(streamUrl) && !/\.m3u8$/i.test(streamUrl)) {
+			streamUrlButton.style.backgroundColor = "#faa";
+			return;
+		}
+		
+		const SETTINGS_STREAM_URL = 8;
+		nativeFunctionChangeSettingsHandle(SETTINGS_STREAM_URL, streamUrl).then((result) => {
+			if (!result) {
+				streamUrlButton.style.backgroundColor = "#faa";
+				alert("There was an error changing this setting!");
+			} else {
+				streamUrlButton.style.backgroundColor = "#afa";
+				setTimeout(() => {
+					streamUrlButton.style.backgroundColor = "#fff";
+				}, 2000);
+			}
+		});
+	});
+	
+	var previewOutputSelector = document.getElementById("previewOutput");
+	previewOutputSelector.addEventListener("change", () => {
+		const SETTINGS_PREVIEW_OUTPUT = 9;
+		
+		nativeFunctionChangeSettingsHandle(SETTINGS_PREVIEW_OUTPUT, previewOutputSelector.value).then((result) => {
+			if (!result) {
+				alert("There was an error changing this setting!");
+			}
+		});
+	});
+	
+	var featureRateButton = document.getElementById("nativeFunctionFeatureRateButton");
+	featureRateButton.addEventListener("click", () => {
+		const featureRate = document.getElementById("featureRate").value;
+		
+		if (featureRate < 1 || featureRate > 120) {
+			featureRateButton.style.backgroundColor = "#faa";
+			return;
+		}
+		
+		const SETTINGS_FEATURE_RATE = 10;
+		nativeFunctionChangeSettingsHandle(SETTINGS_FEATURE_RATE, featureRate).then((result) => {
+			if (!result) {
+				featureRateButton.style.backgroundColor = "#faa";
+				alert("There was an error changing this setting!");
+			} else {
+				featureRateButton.style.backgroundColor = "#afa";
+				setTimeout(() => {
+					featureRateButton.style.backgroundColor = "#fff";
+				}, 2000);
+			}
+		});
+	});
+});
+
+// The custom encoder fields only apply to the custom profile.
+function showEncoderForm(show) {
+	document.getElementById("encoderForm").style.display = show ? "block" : "none";
+}
\ No newline at end of file